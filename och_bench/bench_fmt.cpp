@@ -0,0 +1,422 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <string>
+
+#include "och_matmath.h"
+#include "och_time.h"
+#include "och_timer.h"
+#include "och_fio.h"
+#include "och_err.h"
+#include "och_fmt.h"
+
+// Measures och::print, och::sprint into a range<char> and och::sprint into a utf8_string against fprintf, snprintf and
+// std::format for common argument types. Results are printed as a table and written to a CSV file. Passing the CSV of
+// an earlier run as baseline reports the change of every measurement and flags regressions.
+//
+// Usage: och_bench [results.csv [baseline.csv]]
+
+
+
+static constexpr uint32_t value_cnt = 1024; // Inputs are cycled through, so that no call sees the same argument twice in a row
+
+static constexpr uint32_t repetition_cnt = 5; // The fastest repetition is reported, as it is the least disturbed by the system
+
+static constexpr int64_t min_repetition_ns = 20'000'000;
+
+static constexpr double regression_threshold = 0.05;
+
+static constexpr uint32_t max_results = 128;
+
+static constexpr uint32_t max_name_cunits = 32;
+
+struct bench_result
+{
+	char case_name[max_name_cunits];
+
+	char impl_name[max_name_cunits];
+
+	double ns_per_op;
+
+	double bytes_per_op;
+};
+
+struct bench_inputs
+{
+	int32_t i32[value_cnt];
+
+	uint64_t u64[value_cnt];
+
+	double f64[value_cnt];
+
+	float f32[value_cnt];
+
+	const char* str[value_cnt];
+
+	och::date dates[value_cnt];
+
+	och::timespan spans[value_cnt];
+
+	och::mat4 mats[value_cnt];
+};
+
+static bench_inputs inputs;
+
+static bench_result results[max_results];
+
+static uint32_t result_cnt = 0;
+
+static volatile uint64_t byte_sink; // Keeps the optimizer from discarding formatted output
+
+static char out_buf[1024];
+
+static och::filehandle och_nul;
+
+static FILE* c_nul;
+
+
+
+static uint64_t next_random(uint64_t& state) noexcept
+{
+	state ^= state << 13;
+
+	state ^= state >> 7;
+
+	state ^= state << 17;
+
+	return state;
+}
+
+static void init_inputs() noexcept
+{
+	static const char* const words[]{ "a", "och", "format", "benchmark", "The quick brown fox jumps over the lazy dog", "utf8 \xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E", "", "logging" };
+
+	uint64_t state = 0x9E3779B97F4A7C15;
+
+	for (uint32_t i = 0; i != value_cnt; ++i)
+	{
+		const uint64_t r = next_random(state);
+
+		inputs.i32[i] = static_cast<int32_t>(r >> (r & 31));
+
+		inputs.u64[i] = next_random(state) >> (r & 63);
+
+		inputs.f64[i] = static_cast<double>(static_cast<int64_t>(next_random(state) >> 24)) / static_cast<double>(1ull << (r & 31));
+
+		inputs.f32[i] = static_cast<float>(inputs.f64[i]);
+
+		inputs.str[i] = words[r % (sizeof(words) / sizeof(*words))];
+
+		inputs.dates[i] = och::date(static_cast<uint16_t>(1970 + r % 100), static_cast<uint16_t>(1 + (r >> 8) % 12), static_cast<uint16_t>(0x8000 | (r >> 12) % 7), static_cast<uint16_t>(1 + (r >> 16) % 28), static_cast<uint16_t>((r >> 24) % 24), static_cast<uint16_t>((r >> 32) % 60), static_cast<uint16_t>((r >> 40) % 60), static_cast<uint16_t>((r >> 48) % 1000));
+
+		inputs.spans[i] = och::timespan{ static_cast<int64_t>(next_random(state) >> (20 + (r & 31))) };
+
+		for (uint32_t j = 0; j != 16; ++j)
+			inputs.mats[i].f[j] = static_cast<float>(static_cast<int32_t>(next_random(state) >> 44) - 0x8'0000) / 1024.0F;
+	}
+}
+
+
+
+// Runs op on op_cnt inputs and returns the number of bytes produced
+template<typename Fn>
+static uint64_t run(Fn& op, uint64_t op_cnt)
+{
+	uint64_t bytes = 0;
+
+	for (uint64_t i = 0; i != op_cnt; ++i)
+		bytes += op(static_cast<uint32_t>(i & (value_cnt - 1)));
+
+	byte_sink = byte_sink + bytes;
+
+	return bytes;
+}
+
+// op(i) formats the i-th input and returns the number of bytes it produced. Ops that cannot tell how much they wrote
+// return 0 and pass the size produced by another implementation of the same case as bytes_per_op.
+template<typename Fn>
+static double measure(const char* case_name, const char* impl_name, Fn&& op, double bytes_per_op = 0.0)
+{
+	uint64_t op_cnt = value_cnt;
+
+	while (true)
+	{
+		och::highres_timer timer;
+
+		run(op, op_cnt);
+
+		if (timer.read().nanoseconds() >= min_repetition_ns)
+			break;
+
+		op_cnt *= 2;
+	}
+
+	double best_ns = 0.0;
+
+	for (uint32_t i = 0; i != repetition_cnt; ++i)
+	{
+		och::highres_timer timer;
+
+		const uint64_t bytes = run(op, op_cnt);
+
+		const double ns = static_cast<double>(timer.read().nanoseconds());
+
+		if (i == 0 || ns < best_ns)
+			best_ns = ns;
+
+		if (bytes != 0)
+			bytes_per_op = static_cast<double>(bytes) / static_cast<double>(op_cnt);
+	}
+
+	if (result_cnt != max_results)
+	{
+		bench_result& result = results[result_cnt++];
+
+		strncpy_s(result.case_name, case_name, _TRUNCATE);
+
+		strncpy_s(result.impl_name, impl_name, _TRUNCATE);
+
+		result.ns_per_op = best_ns / static_cast<double>(op_cnt);
+
+		result.bytes_per_op = bytes_per_op;
+
+		och::print("{:14}{:24}{:10.1>} ns/op{:10.1>} MB/s\n", case_name, impl_name, result.ns_per_op, result.ns_per_op == 0.0 ? 0.0 : bytes_per_op * 1000.0 / result.ns_per_op);
+	}
+
+	return bytes_per_op;
+}
+
+// Measures all implementations for one kind of argument. och_args, c_args and std_args call the function they are
+// given with the arguments for the i-th input, as expected by och_format, c_format and std_format respectively. Cases
+// without a printf or std::format equivalent pass nullptr as the respective format.
+template<typename OchArgs, typename CArgs, typename StdArgs>
+static void bench_case(const char* case_name, const char* och_format, OchArgs&& och_args, const char* c_format, CArgs&& c_args, const char* std_format, StdArgs&& std_args)
+{
+	const double bytes_per_op = measure(case_name, "och::sprint range<char>", [&](uint32_t i) { return och_args(i, [&](const auto&... args) { return static_cast<uint64_t>(och::sprint(och::range<char>(out_buf), och_format, args...)); }); });
+
+	measure(case_name, "och::sprint utf8_string", [&](uint32_t i) { return och_args(i, [&](const auto&... args) { och::utf8_string str; return static_cast<uint64_t>(och::sprint(str, och_format, args...)); }); });
+
+	measure(case_name, "och::print", [&](uint32_t i) { return och_args(i, [&](const auto&... args) { och::print(och_nul, och_format, args...); return static_cast<uint64_t>(0); }); }, bytes_per_op);
+
+	if (c_format != nullptr)
+	{
+		measure(case_name, "snprintf", [&](uint32_t i) { return c_args(i, [&](const auto&... args) { return static_cast<uint64_t>(snprintf(out_buf, sizeof(out_buf), c_format, args...)); }); });
+
+		measure(case_name, "fprintf", [&](uint32_t i) { return c_args(i, [&](const auto&... args) { return static_cast<uint64_t>(fprintf(c_nul, c_format, args...)); }); });
+	}
+
+	if (std_format != nullptr)
+	{
+		measure(case_name, "std::vformat_to", [&](uint32_t i) { return std_args(i, [&](const auto&... args) { return static_cast<uint64_t>(std::vformat_to(out_buf, std_format, std::make_format_args(args...)) - out_buf); }); });
+
+		measure(case_name, "std::vformat", [&](uint32_t i) { return std_args(i, [&](const auto&... args) { return static_cast<uint64_t>(std::vformat(std_format, std::make_format_args(args...)).size()); }); });
+	}
+}
+
+static void bench_all()
+{
+	bench_case("int32",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.i32[i]); },
+		"%d\n", [](uint32_t i, auto&& f) { return f(inputs.i32[i]); },
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.i32[i]); });
+
+	bench_case("uint64",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.u64[i]); },
+		"%llu\n", [](uint32_t i, auto&& f) { return f(inputs.u64[i]); },
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.u64[i]); });
+
+	bench_case("double",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.f64[i]); },
+		"%f\n", [](uint32_t i, auto&& f) { return f(inputs.f64[i]); },
+		"{:f}\n", [](uint32_t i, auto&& f) { return f(inputs.f64[i]); });
+
+	bench_case("float",
+		"{:.3}\n", [](uint32_t i, auto&& f) { return f(inputs.f32[i]); },
+		"%.3f\n", [](uint32_t i, auto&& f) { return f(static_cast<double>(inputs.f32[i])); },
+		"{:.3f}\n", [](uint32_t i, auto&& f) { return f(inputs.f32[i]); });
+
+	bench_case("string",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.str[i]); },
+		"%s\n", [](uint32_t i, auto&& f) { return f(inputs.str[i]); },
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.str[i]); });
+
+	bench_case("log_line",
+		"[{}] {}: {} ({})\n", [](uint32_t i, auto&& f) { return f(inputs.i32[i], inputs.str[i], inputs.u64[i], inputs.f64[i]); },
+		"[%d] %s: %llu (%f)\n", [](uint32_t i, auto&& f) { return f(inputs.i32[i], inputs.str[i], inputs.u64[i], inputs.f64[i]); },
+		"[{}] {}: {} ({:f})\n", [](uint32_t i, auto&& f) { return f(inputs.i32[i], inputs.str[i], inputs.u64[i], inputs.f64[i]); });
+
+	// Date fields are passed individually to snprintf and std::format, in the layout of och's default date format
+	const auto date_fields = [](uint32_t i, auto&& f)
+		{
+			const och::date& d = inputs.dates[i];
+
+			return f(d.year(), d.month(), d.monthday(), d.hour(), d.minute(), d.second(), d.millisecond());
+		};
+
+	const auto c_date_fields = [&](uint32_t i, auto&& f)
+		{
+			return date_fields(i, [&](auto... fields) { return f(static_cast<uint32_t>(fields)...); });
+		};
+
+	bench_case("date",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.dates[i]); },
+		"%04u-%02u-%02u, %02u:%02u:%02u.%03u\n", c_date_fields,
+		"{:04}-{:02}-{:02}, {:02}:{:02}:{:02}.{:03}\n", date_fields);
+
+	// timespan has no equivalent in either; both print seconds with millisecond precision instead
+	bench_case("timespan",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.spans[i]); },
+		"%.3fs\n", [](uint32_t i, auto&& f) { return f(static_cast<double>(inputs.spans[i].val) / 1e7); },
+		"{:.3f}s\n", [](uint32_t i, auto&& f) { return f(static_cast<double>(inputs.spans[i].val) / 1e7); });
+
+	const auto mat_elements = [](uint32_t i, auto&& f)
+		{
+			const float* e = inputs.mats[i].f;
+
+			return f(e[0], e[4], e[8], e[12], e[1], e[5], e[9], e[13], e[2], e[6], e[10], e[14], e[3], e[7], e[11], e[15]);
+		};
+
+	const auto c_mat_elements = [&](uint32_t i, auto&& f)
+		{
+			return mat_elements(i, [&](auto... elements) { return f(static_cast<double>(elements)...); });
+		};
+
+	bench_case("mat4",
+		"{}\n", [](uint32_t i, auto&& f) { return f(inputs.mats[i]); },
+		"|%7.4f, %7.4f, %7.4f, %7.4f|\n|%7.4f, %7.4f, %7.4f, %7.4f|\n|%7.4f, %7.4f, %7.4f, %7.4f|\n|%7.4f, %7.4f, %7.4f, %7.4f|\n", c_mat_elements,
+		"|{:7.4f}, {:7.4f}, {:7.4f}, {:7.4f}|\n|{:7.4f}, {:7.4f}, {:7.4f}, {:7.4f}|\n|{:7.4f}, {:7.4f}, {:7.4f}, {:7.4f}|\n|{:7.4f}, {:7.4f}, {:7.4f}, {:7.4f}|\n", mat_elements);
+}
+
+
+
+static och::status write_results(const char* path) noexcept
+{
+	och::filehandle file;
+
+	check(file.create(path, och::fio::access::write, och::fio::open::truncate, och::fio::open::normal, och::fio::share::read));
+
+	och::print(file, "case,impl,ns_per_op,bytes_per_op,bytes_per_s\n");
+
+	for (uint32_t i = 0; i != result_cnt; ++i)
+	{
+		const bench_result& r = results[i];
+
+		och::print(file, "{},{},{:.3},{:.1},{:.0}\n", r.case_name, r.impl_name, r.ns_per_op, r.bytes_per_op, r.ns_per_op == 0.0 ? 0.0 : r.bytes_per_op * 1e9 / r.ns_per_op);
+	}
+
+	return {};
+}
+
+// Splits the next comma-separated field off line, replacing its terminator with '\0'
+static char* next_field(char*& line) noexcept
+{
+	char* field = line;
+
+	while (*line != ',' && *line != '\n' && *line != '\r' && *line != '\0')
+		++line;
+
+	if (*line != '\0')
+		*line++ = '\0';
+
+	return field;
+}
+
+// Returns the number of measurements that got slower than their baseline by more than regression_threshold
+static uint32_t compare_with_baseline(const char* path) noexcept
+{
+	FILE* file;
+
+	if (fopen_s(&file, path, "r") != 0)
+	{
+		och::print("Could not open baseline {}\n", path);
+
+		return 0;
+	}
+
+	och::print("\n{:14}{:24}{:12>}{:12>}{:10>}\n", "case", "impl", "baseline", "current", "change");
+
+	uint32_t regression_cnt = 0;
+
+	char line[256];
+
+	// Skip the header
+	fgets(line, sizeof(line), file);
+
+	while (fgets(line, sizeof(line), file) != nullptr)
+	{
+		char* rest = line;
+
+		const char* case_name = next_field(rest);
+
+		const char* impl_name = next_field(rest);
+
+		const double baseline_ns = strtod(next_field(rest), nullptr);
+
+		for (uint32_t i = 0; i != result_cnt; ++i)
+		{
+			const bench_result& r = results[i];
+
+			if (strcmp(r.case_name, case_name) != 0 || strcmp(r.impl_name, impl_name) != 0 || baseline_ns == 0.0)
+				continue;
+
+			const double change = r.ns_per_op / baseline_ns - 1.0;
+
+			const bool is_regression = change > regression_threshold;
+
+			regression_cnt += is_regression;
+
+			och::print("{:14}{:24}{:12.1>}{:12.1>}{:9.1>+}%{}\n", case_name, impl_name, baseline_ns, r.ns_per_op, change * 100.0, is_regression ? "  <- regression" : "");
+		}
+	}
+
+	fclose(file);
+
+	return regression_cnt;
+}
+
+int main(int argc, const char** argv)
+{
+	const char* results_path = argc > 1 ? argv[1] : "och_bench_results.csv";
+
+	const char* baseline_path = argc > 2 ? argv[2] : nullptr;
+
+	if (och::status rst = och_nul.create("NUL", och::fio::access::write, och::fio::open::normal, och::fio::open::normal, och::fio::share::read_write))
+	{
+		och::print("Could not open NUL: {}\n", rst.description());
+
+		return 1;
+	}
+
+	if (fopen_s(&c_nul, "NUL", "w") != 0)
+	{
+		och::print("Could not open NUL for fprintf\n");
+
+		return 1;
+	}
+
+	init_inputs();
+
+	och::print("{:14}{:24}{:16>}{:16>}\n", "case", "impl", "time", "throughput");
+
+	bench_all();
+
+	if (och::status rst = write_results(results_path))
+		och::print("Could not write {}: {}\n", results_path, rst.description());
+	else
+		och::print("\nResults written to {}\n", results_path);
+
+	const uint32_t regression_cnt = baseline_path != nullptr ? compare_with_baseline(baseline_path) : 0;
+
+	fclose(c_nul);
+
+	if (regression_cnt != 0)
+	{
+		och::print("\n{} measurements regressed by more than {}%\n", regression_cnt, static_cast<uint32_t>(regression_threshold * 100.0));
+
+		return 2;
+	}
+
+	return 0;
+}
@@ -10,7 +10,10 @@
 
 #include "och_err.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <intrin.h>
 
 namespace och
 {
@@ -463,6 +466,22 @@ namespace och
 		return {};
 	}
 
+	[[nodiscard]] status flush_file_array(const file_array_handle& file_array, uint64_t offset, uint64_t bytes) noexcept
+	{
+		if (!FlushViewOfFile(static_cast<const uint8_t*>(file_array.ptr()) + offset, static_cast<SIZE_T>(bytes)))
+			return to_status(HRESULT_FROM_WIN32(GetLastError()));
+
+		return {};
+	}
+
+	[[nodiscard]] status flush_file(const iohandle& file) noexcept
+	{
+		if (!FlushFileBuffers(file.get_()))
+			return to_status(HRESULT_FROM_WIN32(GetLastError()));
+
+		return {};
+	}
+
 	[[nodiscard]] status close_file_search(file_search_handle& file_search) noexcept
 	{
 		if (file_search.get_() && !FindClose(file_search.get_()))
@@ -494,6 +513,44 @@ namespace och
 		return {};
 	}
 
+	[[nodiscard]] status rename_file(const char* old_filename, const char* new_filename, bool replace_existing) noexcept
+	{
+		filename_buf wide_old_path;
+
+		wchar_t* final_old_path;
+
+		uint32_t final_old_charcnt;
+
+		check(utf8_str_to_path(old_filename, wide_old_path, &final_old_path, &final_old_charcnt));
+
+		filename_buf wide_new_path;
+
+		wchar_t* final_new_path;
+
+		uint32_t final_new_charcnt;
+
+		if (status rst = utf8_str_to_path(new_filename, wide_new_path, &final_new_path, &final_new_charcnt))
+		{
+			if (final_old_path != wide_old_path)
+				free(final_old_path);
+
+			return to_status(rst);
+		}
+
+		BOOL rst = MoveFileExW(final_old_path, final_new_path, replace_existing ? MOVEFILE_REPLACE_EXISTING : 0);
+
+		if (final_old_path != wide_old_path)
+			free(final_old_path);
+
+		if (final_new_path != wide_new_path)
+			free(final_new_path);
+
+		if (!rst)
+			return to_status(HRESULT_FROM_WIN32(GetLastError()));
+
+		return {};
+	}
+
 	[[nodiscard]] status delete_file(const iohandle& file) noexcept
 	{
 		FILE_DISPOSITION_INFO disp_info{ TRUE };
@@ -1331,259 +1388,2480 @@ namespace och
 
 
 	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*/////////////////////////////////////////////Standard I/O interop//////////////////////////////////////////////////////*/
+	/*//////////////////////////////////////////////parallel helpers/////////////////////////////////////////////////////////*/
 	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
 
-	iohandle get_stdout() noexcept
-	{
-		return iohandle(GetStdHandle(STD_OUTPUT_HANDLE));
-	}
+	struct parallel_queue;
 
-	iohandle get_stdin() noexcept
+	// Header of every work item submitted to a parallel_queue. Work items are allocated with malloc and are owned by run,
+	// which is always called exactly once, even if the queue was stopped before the item got a chance to do any work.
+	struct parallel_task
 	{
-		return iohandle(GetStdHandle(STD_INPUT_HANDLE));
-	}
+		parallel_queue* queue;
 
-	iohandle get_stderr() noexcept
+		void (*run)(parallel_task* task) noexcept;
+	};
+
+	// Fans work items out over a private Win32 threadpool. Work items may submit further work items; wait returns once all
+	// of them have run. The first error passed to fail stops the queue, after which remaining items should bail out early.
+	struct parallel_queue
 	{
-		return iohandle(GetStdHandle(STD_ERROR_HANDLE));
-	}
-}
+	private:
 
-#elif defined(__linux__)
+		PTP_POOL m_pool = nullptr;
 
-#include <unistd.h>
-#include <dirent.h>
+		TP_CALLBACK_ENVIRON m_env;
 
-namespace och
-{
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*////////////////////////////////////////////////Free functions/////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+		HANDLE m_done_event = nullptr;
 
-	int32_t interp_openmode(fio::open existing_mode, fio::open new_mode) noexcept
-	{
-		switch (existing_mode)
+		volatile long m_pending = 1;
+
+		volatile long m_stopped = 0;
+
+		SRWLOCK m_error_lock = SRWLOCK_INIT;
+
+		status m_first_error;
+
+		static void CALLBACK task_callback(PTP_CALLBACK_INSTANCE instance, void* context) noexcept
 		{
-		case fio::open::normal:
-			switch (new_mode)
-			{
-			case fio::open::normal:        return O_CREAT;
-			case fio::open::append:        return O_CREAT;
-			case fio::open::truncate:      return O_CREAT;
-			case fio::open::fail:          return 0;
-			}
-			break;
+			instance;
 
-		case fio::open::append:
-			switch (new_mode)
-			{
-			case fio::open::normal:        return O_CREAT | O_APPEND;
-			case fio::open::append:        return O_CREAT | O_APPEND;
-			case fio::open::truncate:      return O_CREAT | O_APPEND;
-			case fio::open::fail:          return O_APPEND;
-			}
-			break;
+			parallel_task* task = static_cast<parallel_task*>(context);
 
-		case fio::open::truncate:
-			switch (new_mode)
-			{
-			case fio::open::normal:        return O_CREAT | O_TRUNC;
-			case fio::open::append:        return O_CREAT | O_TRUNC;
-			case fio::open::truncate:      return O_CREAT | O_TRUNC;
-			case fio::open::fail:          return O_TRUNC;
-			}
-			break;
+			parallel_queue* queue = task->queue;
 
-		case fio::open::fail:
-			switch (new_mode)
-			{
-			case fio::open::normal:       return O_CREAT | O_EXCL;
-			case fio::open::append:       return O_CREAT | O_EXCL;
-			case fio::open::truncate:     return O_CREAT | O_EXCL;
-			case fio::open::fail:         break;
-			}
-			break;
+			task->run(task);
+
+			queue->release();
 		}
 
-		return -1;
-	}
+		void release() noexcept
+		{
+			if (InterlockedDecrement(&m_pending) == 0)
+				SetEvent(m_done_event);
+		}
 
-	int32_t access_interp_open(fio::access access_rights) noexcept
-	{
-		switch (access_rights)
+	public:
+
+		parallel_queue() noexcept
 		{
-		case och::fio::access::read:       return O_RDONLY;
-		case och::fio::access::write:      return O_WRONLY;
-		case och::fio::access::read_write: return O_RDWR;
+			InitializeThreadpoolEnvironment(&m_env);
 		}
 
-		return -1;
-	}
+		parallel_queue(const parallel_queue&) = delete;
 
-	int32_t access_interp_mmap(fio::access access_rights) noexcept
-	{
-		switch (access_rights)
+		parallel_queue(parallel_queue&&) = delete;
+
+		[[nodiscard]] status create(uint32_t max_threads) noexcept
 		{
-		case och::fio::access::read:       return PROT_READ;
-		case och::fio::access::write:      return PROT_WRITE;
-		case och::fio::access::read_write: return PROT_READ | PROT_WRITE;
+			if (max_threads == 0)
+				max_threads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+
+			m_done_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+			if (m_done_event == nullptr)
+				return status_from_lasterr;
+
+			m_pool = CreateThreadpool(nullptr);
+
+			if (m_pool == nullptr)
+				return status_from_lasterr;
+
+			SetThreadpoolThreadMaximum(m_pool, max_threads);
+
+			if (!SetThreadpoolThreadMinimum(m_pool, 1))
+				return status_from_lasterr;
+
+			SetThreadpoolCallbackPool(&m_env, m_pool);
+
+			return {};
 		}
 
-		return -1;
-	}
+		void submit(parallel_task* task) noexcept
+		{
+			task->queue = this;
 
-	[[nodiscard]] status open_file(iohandle& out_handle, const char* filename, fio::access access_rights, fio::open existing_mode, fio::open new_mode, fio::share share_mode, fio::flag flags) noexcept
-	{
-		int32_t access = access_interp_open(access_rights);
+			InterlockedIncrement(&m_pending);
 
-		int32_t openmode = interp_openmode(existing_mode, new_mode);
+			if (!TrySubmitThreadpoolCallback(task_callback, task, &m_env))
+			{
+				fail(status_from_lasterr);
 
-		int32_t fileflags = access | openmode;
+				task->run(task);
 
-		if (fileflags == -1)
-			return to_status(error::argument_invalid);
+				release();
+			}
+		}
 
-		if ((flags | fio::all_flags) != fio::all_flags)
-			return to_status(error::argument_invalid);
+		void fail(status s) noexcept
+		{
+			AcquireSRWLockExclusive(&m_error_lock);
 
-		if ((flags & fio::flag::temporary) == fio::flag::temporary)
-			fileflags |= O_TMPFILE;
+			if (!m_first_error)
+				m_first_error = s;
 
-		const char* final_filename = filename;
+			ReleaseSRWLockExclusive(&m_error_lock);
 
-		char name_buf[4096];
+			stop();
+		}
 
-		if ((flags & fio::flag::hidden) == fio::flag::hidden && filename[0] != '.')
+		void stop() noexcept
 		{
-			name_buf[0] = '.';
+			InterlockedExchange(&m_stopped, 1);
+		}
 
-			size_t i = 1;
+		[[nodiscard]] bool is_stopped() const noexcept
+		{
+			return m_stopped;
+		}
 
-			for (; i != 4095 && filename[i]; ++i)
-				name_buf[i] = filename[i - 1];
+		// Must be called exactly once, after the initial work items have been submitted.
+		[[nodiscard]] status wait() noexcept
+		{
+			release();
 
-			if (filename[i])
-				return to_status(error::argument_too_large);
+			if (WaitForSingleObject(m_done_event, INFINITE) == WAIT_FAILED)
+				return status_from_lasterr;
 
-			name_buf[i] = '\0';
+			if (m_first_error)
+				return to_status(m_first_error);
 
-			final_filename = name_buf;
+			return {};
 		}
 
-		if ((flags & fio::flag::async) == fio::flag::async)
-			return to_status(error::function_unavailable);
+		~parallel_queue() noexcept
+		{
+			if (m_pool != nullptr)
+				CloseThreadpool(m_pool);
 
-		int32_t fd = iohandle(open(final_filename, fileflags, S_IRUSR | S_IWUSR));
+			DestroyThreadpoolEnvironment(&m_env);
 
-		if (fd == -1)
-			return to_status(errno);
+			if (m_done_event != nullptr)
+				CloseHandle(m_done_event);
+		}
+	};
 
-		out_handle.set_(fd);
+	[[nodiscard]] static bool is_skippable_search_error(status s) noexcept
+	{
+		return s == error::no_more_data || s.errcode() == static_cast<uint32_t>(HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED));
+	}
 
-		return {};
+	[[nodiscard]] static bool is_traversable_directory(const file_search_result& result) noexcept
+	{
+		return result.is_directory() && !(get_fsr_data_ptr(&result)->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
 	}
 
-	[[nodiscard]] status create_file_mapper(file_mapper_handle& out_handle, const iohandle& file, uint64_t size, fio::access access_rights, const char* mapping_name = nullptr) noexcept
+	// Copies directory, followed by a backslash and name, into dst, which must provide room for the returned number of
+	// codeunits plus a terminating '\0'. dst may be nullptr to only query the required size.
+	static uint32_t join_path(char* dst, const char* directory, uint32_t directory_cunits, const utf8_string& name) noexcept
 	{
-		out_handle.set_(file.get_());
+		const uint32_t name_cunits = name.get_codeunits();
 
-		return {};
+		const uint32_t total_cunits = directory_cunits + 1 + name_cunits;
+
+		if (dst)
+		{
+			memcpy(dst, directory, directory_cunits);
+
+			dst[directory_cunits] = '\\';
+
+			memcpy(dst + directory_cunits + 1, name.raw_cbegin(), name_cunits);
+
+			dst[total_cunits] = '\0';
+		}
+
+		return total_cunits;
 	}
 
-	[[nodiscard]] status file_as_array(file_array_handle& out_handle, const file_mapper_handle& file_mapper, fio::access access_rights, uint64_t beg, uint64_t end) noexcept
+	// Copies root into a newly malloc'ed buffer, replacing forward slashes with backslashes and stripping trailing ones.
+	[[nodiscard]] static status normalize_root_path(char** out_path, uint32_t& out_cunits, const char* root) noexcept
 	{
-		out_handle.invalidate();
+		uint32_t root_cunits = 0, root_cpoints = 0;
 
-		int32_t access = access_interp_mmap(access_rights);
+		_utf8_len(root, root_cunits, root_cpoints);
 
-		if (access == -1)
+		if (root_cunits == 0)
 			return to_status(error::argument_invalid);
 
-		uint64_t len = end - beg;
+		char* path = static_cast<char*>(malloc(root_cunits + 1));
 
-		if (len == 0)
-		{
-			struct stat fs;
+		if (path == nullptr)
+			return to_status(error::no_memory);
 
-			if (fstat(file_mapper.get_(), &fs))
-				return to_status(errno);
+		for (uint32_t i = 0; i != root_cunits; ++i)
+			path[i] = root[i] == '/' ? '\\' : root[i];
 
-			len = fs.st_size;
-		}
+		while (root_cunits > 1 && path[root_cunits - 1] == '\\')
+			--root_cunits;
 
-		void* ptr = mmap(nullptr, len, access, 0, file_mapper.get_(), beg);
+		path[root_cunits] = '\0';
 
-		if (ptr == MAP_FAILED)
-			return to_status(errno);
+		*out_path = path;
 
-		out_handle.set_(ptr, len);
+		out_cunits = root_cunits;
 
 		return {};
 	}
 
-	[[nodiscard]] status create_file_search(file_search_handle& out_handle, file_search_result& out_result, const char* directory) noexcept
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////////disk_usage////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	struct disk_usage_walk
 	{
-		out_handle.invalidate_();
+		parallel_queue queue;
 
-		DIR* dir = opendir(directory);
+		SRWLOCK lock = SRWLOCK_INIT;
 
-		if (!dir)
-			return to_status(errno);
+		disk_usage_entry* entries = nullptr;
 
-		out_handle.set_(dir);
+		uint32_t entry_cnt = 0;
 
-		check(advance_file_search(out_handle, out_result));
+		uint32_t entry_capacity = 0;
 
-		return {};
-	}
+		uint32_t max_depth = 0;
 
-	[[nodiscard]] status close_file(iohandle& file) noexcept
-	{
-		if (close(file.get_()))
-			return to_status(errno);
+		uint64_t byte_budget = ~0ull;
 
-		return {};
-	}
+		std::atomic<uint64_t> total_bytes = 0;
 
-	[[nodiscard]] status close_file_mapper(file_mapper_handle& handle) noexcept
-	{
-		return {};
-	}
+		std::atomic<bool> budget_exceeded = false;
 
-	[[nodiscard]] status close_file_array(file_array_handle& file_array) noexcept
+		status first_error; // Guarded by lock
+	};
+
+	struct disk_usage_task
 	{
-		if (munmap(file_array.ptr(), file_array.bytes()))
-			return to_status(errno);
+		parallel_task header;
 
-		return {};
-	}
+		disk_usage_walk* walk;
 
-	[[nodiscard]] status close_file_search(file_search_handle& file_search) noexcept
-	{
-		if (closedir(static_cast<DIR*>(file_search.get_())))
-			return to_status(errno);
+		uint32_t owner;
 
-		file_search.invalidate_();
+		uint32_t depth;
 
-		return {};
-	}
+		uint32_t path_cunits;
 
-	[[nodiscard]] status delete_file(const char* filename) noexcept
+		char* path() noexcept
+		{
+			return reinterpret_cast<char*>(this + 1);
+		}
+	};
+
+	static void free_disk_usage_entries(disk_usage_entry* entries, uint32_t entry_cnt) noexcept
 	{
-		if (unlink(filename))
-			return to_status(errno);
+		if (entries == nullptr)
+			return;
 
-		return {};
+		for (uint32_t i = 0; i != entry_cnt; ++i)
+			free(const_cast<char*>(entries[i].path.raw_cbegin()));
+
+		free(entries);
 	}
 
-	[[nodiscard]] status delete_file(const iohandle& file) noexcept
+	// Must be called with walk.lock held exclusively. Takes ownership of path.
+	[[nodiscard]] static status add_disk_usage_entry(disk_usage_walk& walk, char* path, uint32_t depth, uint32_t parent, uint32_t& out_index) noexcept
 	{
-		char path_buf[1024];
+		if (walk.entry_cnt == walk.entry_capacity)
+		{
+			uint32_t new_capacity = walk.entry_capacity == 0 ? 64 : walk.entry_capacity * 2;
 
-		och::range buf(path_buf);
+			disk_usage_entry* tmp = static_cast<disk_usage_entry*>(realloc(walk.entries, new_capacity * sizeof(disk_usage_entry)));
 
-		och::range path;
+			if (tmp == nullptr)
+			{
+				free(path);
+
+				return to_status(error::no_memory);
+			}
+
+			walk.entries = tmp;
+
+			walk.entry_capacity = new_capacity;
+		}
+
+		out_index = walk.entry_cnt++;
+
+		walk.entries[out_index] = disk_usage_entry{ utf8_view(path), depth, parent, 0, 0, 0, 0 };
+
+		return {};
+	}
+
+	[[nodiscard]] static status create_disk_usage_task(disk_usage_task** out_task, disk_usage_walk& walk, const char* path, uint32_t path_cunits, uint32_t owner, uint32_t depth) noexcept;
+
+	static void run_disk_usage_task(parallel_task* header) noexcept;
+
+	[[nodiscard]] static status submit_disk_usage_child(disk_usage_walk& walk, const disk_usage_task* parent, char* parent_path, const utf8_string& name) noexcept
+	{
+		const uint32_t child_depth = parent->depth + 1;
+
+		const uint32_t child_cunits = join_path(nullptr, parent_path, parent->path_cunits, name);
+
+		uint32_t owner = parent->owner;
+
+		if (child_depth <= walk.max_depth)
+		{
+			char* entry_path = static_cast<char*>(malloc(child_cunits + 1));
+
+			if (entry_path == nullptr)
+				return to_status(error::no_memory);
+
+			join_path(entry_path, parent_path, parent->path_cunits, name);
+
+			AcquireSRWLockExclusive(&walk.lock);
+
+			status rst = add_disk_usage_entry(walk, entry_path, child_depth, parent->owner, owner);
+
+			ReleaseSRWLockExclusive(&walk.lock);
+
+			check(rst);
+		}
+
+		disk_usage_task* child;
+
+		check(create_disk_usage_task(&child, walk, nullptr, child_cunits, owner, child_depth));
+
+		join_path(child->path(), parent_path, parent->path_cunits, name);
+
+		walk.queue.submit(&child->header);
+
+		return {};
+	}
+
+	// Counts a directory whose contents could not be enumerated against its owning entry instead of failing the walk
+	static void record_unreadable_directory(disk_usage_walk& walk, const disk_usage_task* task, status reason) noexcept
+	{
+		AcquireSRWLockExclusive(&walk.lock);
+
+		++walk.entries[task->owner].unreadable_cnt;
+
+		if (!walk.first_error)
+			walk.first_error = reason;
+
+		ReleaseSRWLockExclusive(&walk.lock);
+	}
+
+	// Adds an entry for a subdirectory whose name could not be converted to UTF-8 and counts it as unreadable. As it
+	// cannot be opened without a name, it is recorded against its own entry if it gets one, and its parent's otherwise.
+	[[nodiscard]] static status record_unnamed_child(disk_usage_walk& walk, const disk_usage_task* parent, status reason) noexcept
+	{
+		const uint32_t child_depth = parent->depth + 1;
+
+		if (child_depth > walk.max_depth)
+		{
+			record_unreadable_directory(walk, parent, reason);
+
+			return {};
+		}
+
+		const utf8_string name("\xEF\xBF\xBD"); // U+FFFD REPLACEMENT CHARACTER
+
+		const uint32_t child_cunits = join_path(nullptr, parent->path(), parent->path_cunits, name);
+
+		char* entry_path = static_cast<char*>(malloc(child_cunits + 1));
+
+		if (entry_path == nullptr)
+			return to_status(error::no_memory);
+
+		join_path(entry_path, parent->path(), parent->path_cunits, name);
+
+		AcquireSRWLockExclusive(&walk.lock);
+
+		uint32_t owner;
+
+		status rst = add_disk_usage_entry(walk, entry_path, child_depth, parent->owner, owner);
+
+		if (!rst)
+		{
+			walk.entries[owner].unreadable_cnt = 1;
+
+			if (!walk.first_error)
+				walk.first_error = reason;
+		}
+
+		ReleaseSRWLockExclusive(&walk.lock);
+
+		return rst;
+	}
+
+	[[nodiscard]] static bool is_dot_directory(const FILE_ID_BOTH_DIR_INFO* info) noexcept
+	{
+		const uint32_t name_chars = info->FileNameLength / sizeof(wchar_t);
+
+		return info->FileName[0] == L'.' && (name_chars == 1 || (name_chars == 2 && info->FileName[1] == L'.'));
+	}
+
+	[[nodiscard]] static status scan_disk_usage_directory(disk_usage_walk& walk, disk_usage_task* task) noexcept
+	{
+		filename_buf wide_path;
+
+		wchar_t* final_path;
+
+		uint32_t final_charcnt;
+
+		if (status rst = utf8_str_to_path(task->path(), wide_path, &final_path, &final_charcnt))
+		{
+			record_unreadable_directory(walk, task, rst);
+
+			return {};
+		}
+
+		HANDLE directory = CreateFileW(final_path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+
+		if (final_path != wide_path)
+			free(final_path);
+
+		if (directory == INVALID_HANDLE_VALUE)
+		{
+			record_unreadable_directory(walk, task, status_from_lasterr);
+
+			return {};
+		}
+
+		uint64_t file_cnt = 0, apparent_bytes = 0, allocated_bytes = 0;
+
+		status rst;
+
+		alignas(8) uint8_t info_buf[16384];
+
+		while (!rst && !walk.queue.is_stopped())
+		{
+			if (!GetFileInformationByHandleEx(directory, FileIdBothDirectoryInfo, info_buf, sizeof(info_buf)))
+			{
+				if (GetLastError() != ERROR_NO_MORE_FILES)
+					record_unreadable_directory(walk, task, status_from_lasterr);
+
+				break;
+			}
+
+			const uint8_t* curr = info_buf;
+
+			while (true)
+			{
+				const FILE_ID_BOTH_DIR_INFO* info = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(curr);
+
+				if (!(info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				{
+					const uint64_t bytes = static_cast<uint64_t>(info->EndOfFile.QuadPart);
+
+					++file_cnt;
+
+					apparent_bytes += bytes;
+
+					allocated_bytes += static_cast<uint64_t>(info->AllocationSize.QuadPart);
+
+					if (walk.total_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes > walk.byte_budget)
+					{
+						walk.budget_exceeded.store(true, std::memory_order_relaxed);
+
+						walk.queue.stop();
+
+						break;
+					}
+				}
+				else if (!(info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && !is_dot_directory(info))
+				{
+					char utf8_name_buf[256 * 4 + 1];
+
+					const int cunits = WideCharToMultiByte(CP_UTF8, 0, info->FileName, static_cast<int>(info->FileNameLength / sizeof(wchar_t)), utf8_name_buf, sizeof(utf8_name_buf) - 1, nullptr, nullptr);
+
+					if (cunits == 0)
+					{
+						rst = record_unnamed_child(walk, task, status_from_lasterr);
+					}
+					else
+					{
+						utf8_name_buf[cunits] = '\0';
+
+						rst = submit_disk_usage_child(walk, task, task->path(), utf8_string(utf8_name_buf));
+					}
+
+					if (rst)
+						break;
+				}
+
+				if (info->NextEntryOffset == 0)
+					break;
+
+				curr += info->NextEntryOffset;
+			}
+		}
+
+		CloseHandle(directory);
+
+		AcquireSRWLockExclusive(&walk.lock);
+
+		disk_usage_entry& owner = walk.entries[task->owner];
+
+		owner.file_cnt += file_cnt;
+
+		owner.apparent_bytes += apparent_bytes;
+
+		owner.allocated_bytes += allocated_bytes;
+
+		ReleaseSRWLockExclusive(&walk.lock);
+
+		return rst;
+	}
+
+	[[nodiscard]] static status create_disk_usage_task(disk_usage_task** out_task, disk_usage_walk& walk, const char* path, uint32_t path_cunits, uint32_t owner, uint32_t depth) noexcept
+	{
+		disk_usage_task* task = static_cast<disk_usage_task*>(malloc(sizeof(disk_usage_task) + path_cunits + 1));
+
+		if (task == nullptr)
+			return to_status(error::no_memory);
+
+		task->header.run = run_disk_usage_task;
+
+		task->walk = &walk;
+
+		task->owner = owner;
+
+		task->depth = depth;
+
+		task->path_cunits = path_cunits;
+
+		if (path)
+		{
+			memcpy(task->path(), path, path_cunits);
+
+			task->path()[path_cunits] = '\0';
+		}
+
+		*out_task = task;
+
+		return {};
+	}
+
+	static void run_disk_usage_task(parallel_task* header) noexcept
+	{
+		disk_usage_task* task = reinterpret_cast<disk_usage_task*>(header);
+
+		disk_usage_walk& walk = *task->walk;
+
+		if (!walk.queue.is_stopped())
+			if (status rst = scan_disk_usage_directory(walk, task))
+				walk.queue.fail(rst);
+
+		free(task);
+	}
+
+	void disk_usage_result::close() noexcept
+	{
+		free_disk_usage_entries(m_entries, m_entry_cnt);
+
+		m_entries = nullptr;
+
+		m_entry_cnt = 0;
+	}
+
+	[[nodiscard]] status disk_usage(disk_usage_result& out_result, const char* root, uint32_t max_depth, uint64_t byte_budget, uint32_t max_threads) noexcept
+	{
+		out_result.close();
+
+		disk_usage_walk walk;
+
+		walk.max_depth = max_depth;
+
+		walk.byte_budget = byte_budget;
+
+		char* root_path;
+
+		uint32_t root_cunits;
+
+		check(normalize_root_path(&root_path, root_cunits, root));
+
+		uint32_t root_index;
+
+		check(add_disk_usage_entry(walk, root_path, 0, ~0u, root_index));
+
+		disk_usage_task* root_task;
+
+		if (status rst = create_disk_usage_task(&root_task, walk, root_path, root_cunits, root_index, 0))
+		{
+			free_disk_usage_entries(walk.entries, walk.entry_cnt);
+
+			return to_status(rst);
+		}
+
+		if (status rst = walk.queue.create(max_threads))
+		{
+			free(root_task);
+
+			free_disk_usage_entries(walk.entries, walk.entry_cnt);
+
+			return to_status(rst);
+		}
+
+		walk.queue.submit(&root_task->header);
+
+		if (status rst = walk.queue.wait())
+		{
+			free_disk_usage_entries(walk.entries, walk.entry_cnt);
+
+			return to_status(rst);
+		}
+
+		// Parents are always added before their children, so a single backwards pass accumulates nested totals
+		for (uint32_t i = walk.entry_cnt - 1; i != 0; --i)
+		{
+			disk_usage_entry& parent = walk.entries[walk.entries[i].parent];
+
+			parent.file_cnt += walk.entries[i].file_cnt;
+
+			parent.apparent_bytes += walk.entries[i].apparent_bytes;
+
+			parent.allocated_bytes += walk.entries[i].allocated_bytes;
+
+			parent.unreadable_cnt += walk.entries[i].unreadable_cnt;
+		}
+
+		out_result.set_(walk.entries, walk.entry_cnt, walk.budget_exceeded.load(std::memory_order_relaxed), walk.first_error);
+
+		return {};
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////content search//////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	enum class regex_quantifier : uint8_t
+	{
+		one,
+		optional,
+		star,
+		plus,
+	};
+
+	struct regex_token
+	{
+		uint32_t set[8]; // Bitmap of the bytes matched by this token
+
+		regex_quantifier quantifier;
+
+		[[nodiscard]] bool matches(char c) const noexcept
+		{
+			const uint8_t b = static_cast<uint8_t>(c);
+
+			return (set[b >> 5] >> (b & 31)) & 1;
+		}
+
+		void add(uint8_t b) noexcept
+		{
+			set[b >> 5] |= 1u << (b & 31);
+		}
+
+		void add_range(uint8_t lo, uint8_t hi) noexcept
+		{
+			for (uint32_t b = lo; b <= hi; ++b)
+				add(static_cast<uint8_t>(b));
+		}
+	};
+
+	struct compiled_pattern
+	{
+		regex_token* tokens;
+
+		uint32_t token_cnt;
+
+		bool is_regex;
+
+		bool anchored_beg;
+
+		bool anchored_end;
+
+		// Literal every match must start with. For plain patterns this is the whole pattern, so no further matching is
+		// needed once it has been found. Regex patterns without a literal prefix have to be tried on every line.
+		const char* literal;
+
+		uint32_t literal_cunits;
+	};
+
+	[[nodiscard]] static status parse_regex_escape(regex_token& token, const char*& curr) noexcept
+	{
+		const char c = *curr++;
+
+		switch (c)
+		{
+		case '\0':
+			return to_status(error::argument_invalid);
+
+		case 'd':
+			token.add_range('0', '9');
+			break;
+
+		case 'w':
+			token.add_range('0', '9');
+			token.add_range('a', 'z');
+			token.add_range('A', 'Z');
+			token.add('_');
+			break;
+
+		case 's':
+			token.add(' ');
+			token.add('\t');
+			token.add('\r');
+			token.add('\v');
+			token.add('\f');
+			break;
+
+		case 't':
+			token.add('\t');
+			break;
+
+		default:
+			token.add(static_cast<uint8_t>(c));
+			break;
+		}
+
+		return {};
+	}
+
+	[[nodiscard]] static status parse_regex_class(regex_token& token, const char*& curr) noexcept
+	{
+		bool negated = false;
+
+		if (*curr == '^')
+		{
+			negated = true;
+
+			++curr;
+		}
+
+		// A ']' directly after the opening bracket is taken literally
+		bool is_first = true;
+
+		while (*curr != ']' || is_first)
+		{
+			is_first = false;
+
+			if (*curr == '\0')
+				return to_status(error::argument_invalid);
+
+			if (*curr == '\\')
+			{
+				++curr;
+
+				check(parse_regex_escape(token, curr));
+
+				continue;
+			}
+
+			const uint8_t lo = static_cast<uint8_t>(*curr++);
+
+			if (*curr == '-' && curr[1] != ']' && curr[1] != '\0')
+			{
+				const uint8_t hi = static_cast<uint8_t>(curr[1]);
+
+				if (hi < lo)
+					return to_status(error::argument_invalid);
+
+				token.add_range(lo, hi);
+
+				curr += 2;
+			}
+			else
+			{
+				token.add(lo);
+			}
+		}
+
+		++curr;
+
+		if (negated)
+			for (uint32_t i = 0; i != 8; ++i)
+				token.set[i] = ~token.set[i];
+
+		return {};
+	}
+
+	[[nodiscard]] static status compile_regex(compiled_pattern& out_pattern, char* literal_buf, const char* pattern) noexcept
+	{
+		const char* curr = pattern;
+
+		if (*curr == '^')
+		{
+			out_pattern.anchored_beg = true;
+
+			++curr;
+		}
+
+		while (*curr != '\0')
+		{
+			const char c = *curr++;
+
+			if (c == '$' && *curr == '\0')
+			{
+				out_pattern.anchored_end = true;
+
+				break;
+			}
+
+			if (c == '*' || c == '+' || c == '?')
+			{
+				if (out_pattern.token_cnt == 0)
+					return to_status(error::argument_invalid);
+
+				regex_token& prev = out_pattern.tokens[out_pattern.token_cnt - 1];
+
+				if (prev.quantifier != regex_quantifier::one)
+					return to_status(error::argument_invalid);
+
+				prev.quantifier = c == '*' ? regex_quantifier::star : c == '+' ? regex_quantifier::plus : regex_quantifier::optional;
+
+				continue;
+			}
+
+			regex_token& token = out_pattern.tokens[out_pattern.token_cnt++];
+
+			memset(&token, 0, sizeof(token));
+
+			token.quantifier = regex_quantifier::one;
+
+			if (c == '\\')
+			{
+				check(parse_regex_escape(token, curr));
+			}
+			else if (c == '[')
+			{
+				check(parse_regex_class(token, curr));
+			}
+			else if (c == '.')
+			{
+				for (uint32_t i = 0; i != 8; ++i)
+					token.set[i] = ~0u;
+			}
+			else
+			{
+				token.add(static_cast<uint8_t>(c));
+			}
+		}
+
+		// The literal prefix is made up of the leading tokens matching exactly one specific byte exactly once
+		out_pattern.literal = literal_buf;
+
+		for (uint32_t i = 0; i != out_pattern.token_cnt; ++i)
+		{
+			const regex_token& token = out_pattern.tokens[i];
+
+			if (token.quantifier != regex_quantifier::one)
+				break;
+
+			uint32_t bit_cnt = 0;
+
+			uint32_t byte = 0;
+
+			for (uint32_t b = 0; b != 256 && bit_cnt < 2; ++b)
+				if (token.matches(static_cast<char>(b)))
+				{
+					++bit_cnt;
+
+					byte = b;
+				}
+
+			if (bit_cnt != 1)
+				break;
+
+			literal_buf[out_pattern.literal_cunits++] = static_cast<char>(byte);
+		}
+
+		return {};
+	}
+
+	[[nodiscard]] static status compile_pattern(compiled_pattern& out_pattern, const content_search_pattern& pattern) noexcept
+	{
+		out_pattern = compiled_pattern{};
+
+		if (pattern.text == nullptr)
+			return to_status(error::argument_invalid);
+
+		const size_t pattern_cunits = strlen(pattern.text);
+
+		if (pattern_cunits > UINT32_MAX || memchr(pattern.text, '\n', pattern_cunits) != nullptr)
+			return to_status(error::argument_invalid);
+
+		if (!pattern.is_regex)
+		{
+			out_pattern.literal = pattern.text;
+
+			out_pattern.literal_cunits = static_cast<uint32_t>(pattern_cunits);
+
+			return {};
+		}
+
+		// Every pattern character produces at most one token and one literal prefix byte
+		out_pattern.tokens = static_cast<regex_token*>(malloc(pattern_cunits * (sizeof(regex_token) + 1) + 1));
+
+		if (out_pattern.tokens == nullptr)
+			return to_status(error::no_memory);
+
+		out_pattern.is_regex = true;
+
+		return compile_regex(out_pattern, reinterpret_cast<char*>(out_pattern.tokens + pattern_cunits), pattern.text);
+	}
+
+	// Plain backtracking matcher. Patterns stacking several unbounded quantifiers can take polynomial time on long lines.
+	[[nodiscard]] static bool regex_matches_here(const regex_token* token, const regex_token* tokens_end, const char* text, const char* text_end, bool anchored_end) noexcept
+	{
+		for (; token != tokens_end; ++token)
+		{
+			if (token->quantifier == regex_quantifier::one)
+			{
+				if (text == text_end || !token->matches(*text))
+					return false;
+
+				++text;
+
+				continue;
+			}
+
+			const size_t max_reps = token->quantifier == regex_quantifier::optional ? 1 : ~static_cast<size_t>(0);
+
+			const char* rep_end = text;
+
+			while (rep_end != text_end && static_cast<size_t>(rep_end - text) < max_reps && token->matches(*rep_end))
+				++rep_end;
+
+			const char* min_end = token->quantifier == regex_quantifier::plus ? text + 1 : text;
+
+			if (rep_end < min_end)
+				return false;
+
+			for (const char* p = rep_end; ; --p)
+			{
+				if (regex_matches_here(token + 1, tokens_end, p, text_end, anchored_end))
+					return true;
+
+				if (p == min_end)
+					return false;
+			}
+		}
+
+		return !anchored_end || text == text_end;
+	}
+
+	[[nodiscard]] static bool regex_matches_line(const compiled_pattern& pattern, const char* line_beg, const char* line_end) noexcept
+	{
+		const regex_token* tokens_end = pattern.tokens + pattern.token_cnt;
+
+		if (pattern.anchored_beg)
+			return regex_matches_here(pattern.tokens, tokens_end, line_beg, line_end, pattern.anchored_end);
+
+		for (const char* start = line_beg; start + pattern.literal_cunits <= line_end; ++start)
+		{
+			if (pattern.literal_cunits != 0 && (*start != *pattern.literal || memcmp(start, pattern.literal, pattern.literal_cunits) != 0))
+				continue;
+
+			if (regex_matches_here(pattern.tokens + pattern.literal_cunits, tokens_end, start + pattern.literal_cunits, line_end, pattern.anchored_end))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Finds the first occurrence of needle in [beg, end), or returns nullptr.
+	// Candidates are found by comparing the first and last byte of needle against 16 positions at once.
+	[[nodiscard]] static const char* find_literal(const char* beg, const char* end, const char* needle, uint32_t needle_cunits) noexcept
+	{
+		if (needle_cunits == 0)
+			return beg;
+
+		if (static_cast<size_t>(end - beg) < needle_cunits)
+			return nullptr;
+
+		const char* last_start = end - needle_cunits;
+
+		const __m128i first_byte = _mm_set1_epi8(needle[0]);
+
+		const __m128i last_byte = _mm_set1_epi8(needle[needle_cunits - 1]);
+
+		const char* curr = beg;
+
+		while (last_start - curr >= 15)
+		{
+			const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(curr));
+
+			const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(curr + needle_cunits - 1));
+
+			unsigned long mask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first_byte), _mm_cmpeq_epi8(block_last, last_byte))));
+
+			while (mask != 0)
+			{
+				unsigned long idx;
+
+				_BitScanForward(&idx, mask);
+
+				if (memcmp(curr + idx + 1, needle + 1, needle_cunits - 1) == 0)
+					return curr + idx;
+
+				mask &= mask - 1;
+			}
+
+			curr += 16;
+		}
+
+		for (; curr <= last_start; ++curr)
+			if (*curr == needle[0] && memcmp(curr + 1, needle + 1, needle_cunits - 1) == 0)
+				return curr;
+
+		return nullptr;
+	}
+
+	[[nodiscard]] static uint64_t count_newlines(const char* beg, const char* end) noexcept
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+
+		uint64_t cnt = 0;
+
+		while (end - beg >= 16)
+		{
+			// Matching lanes are -1, so subtracting them counts newlines per lane. Flush before the lanes can overflow.
+			__m128i lane_cnts = _mm_setzero_si128();
+
+			for (uint32_t i = 0; i != 255 && end - beg >= 16; ++i, beg += 16)
+				lane_cnts = _mm_sub_epi8(lane_cnts, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(beg)), newline));
+
+			const __m128i sums = _mm_sad_epu8(lane_cnts, _mm_setzero_si128());
+
+			cnt += static_cast<uint32_t>(_mm_cvtsi128_si32(sums)) + static_cast<uint32_t>(_mm_extract_epi16(sums, 4));
+		}
+
+		for (; beg != end; ++beg)
+			cnt += *beg == '\n';
+
+		return cnt;
+	}
+
+	struct line_cursor
+	{
+		const char* beg; // nullptr once the pattern has no more matches
+
+		const char* end; // Excludes the line terminator
+	};
+
+	// Finds the first line at or after pos, which must be the start of a line, that matches pattern.
+	static void find_next_matching_line(line_cursor& cursor, const compiled_pattern& pattern, const char* pos, const char* file_end) noexcept
+	{
+		while (pos < file_end)
+		{
+			const char* line_beg = pos;
+
+			const char* hit = pos;
+
+			if (pattern.literal_cunits != 0)
+			{
+				hit = find_literal(pos, file_end, pattern.literal, pattern.literal_cunits);
+
+				if (hit == nullptr)
+					break;
+
+				line_beg = hit;
+
+				while (line_beg != pos && line_beg[-1] != '\n')
+					--line_beg;
+			}
+
+			const char* newline = static_cast<const char*>(memchr(hit, '\n', file_end - hit));
+
+			const char* line_end = newline == nullptr ? file_end : newline;
+
+			if (line_end != line_beg && line_end[-1] == '\r')
+				--line_end;
+
+			if (!pattern.is_regex || regex_matches_line(pattern, line_beg, line_end))
+			{
+				cursor.beg = line_beg;
+
+				cursor.end = line_end;
+
+				return;
+			}
+
+			if (newline == nullptr)
+				break;
+
+			pos = newline + 1;
+		}
+
+		cursor.beg = nullptr;
+	}
+
+	struct content_search_state
+	{
+		parallel_queue queue;
+
+		SRWLOCK callback_lock = SRWLOCK_INIT;
+
+		const content_search_filter* filter = nullptr;
+
+		const compiled_pattern* patterns = nullptr;
+
+		uint32_t pattern_cnt = 0;
+
+		content_search_callback callback = nullptr;
+
+		void* userdata = nullptr;
+	};
+
+	struct content_search_task
+	{
+		parallel_task header;
+
+		content_search_state* state;
+
+		uint32_t depth;
+
+		uint32_t path_cunits;
+
+		bool is_directory;
+
+		char* path() noexcept
+		{
+			return reinterpret_cast<char*>(this + 1);
+		}
+	};
+
+	static constexpr size_t BINARY_PROBE_BYTES = 4096;
+
+	[[nodiscard]] static status search_mapped_file(content_search_state& state, content_search_task* task) noexcept
+	{
+		mapped_file<char> file;
+
+		// Files that are locked or vanished since they were enumerated are not worth failing the whole search over
+		if (file.create(task->path(), fio::access::read, fio::open::normal, fio::open::fail, 0, 0, fio::share::read_write_remove))
+			return {};
+
+		const char* file_beg = file.data();
+
+		const char* file_end = file_beg + file.bytes();
+
+		if (memchr(file_beg, '\0', file.bytes() < BINARY_PROBE_BYTES ? static_cast<size_t>(file.bytes()) : BINARY_PROBE_BYTES) != nullptr)
+			return {};
+
+		line_cursor* cursors = static_cast<line_cursor*>(malloc(state.pattern_cnt * sizeof(line_cursor)));
+
+		if (cursors == nullptr)
+			return to_status(error::no_memory);
+
+		for (uint32_t i = 0; i != state.pattern_cnt; ++i)
+			find_next_matching_line(cursors[i], state.patterns[i], file_beg, file_end);
+
+		const char* counted_to = file_beg;
+
+		uint64_t line_number = 1;
+
+		const utf8_view path(task->path(), task->path_cunits, _utf8_count_codepoints(task->path(), task->path_cunits));
+
+		while (!state.queue.is_stopped())
+		{
+			uint32_t first = ~0u;
+
+			for (uint32_t i = 0; i != state.pattern_cnt; ++i)
+				if (cursors[i].beg != nullptr && (first == ~0u || cursors[i].beg < cursors[first].beg))
+					first = i;
+
+			if (first == ~0u)
+				break;
+
+			const line_cursor line = cursors[first];
+
+			line_number += count_newlines(counted_to, line.beg);
+
+			counted_to = line.beg;
+
+			const content_search_match match{ path, line_number, range<const char>(line.beg, line.end), first };
+
+			bool stop_requested = false;
+
+			AcquireSRWLockExclusive(&state.callback_lock);
+
+			if (!state.queue.is_stopped())
+				stop_requested = !state.callback(match, state.userdata);
+
+			ReleaseSRWLockExclusive(&state.callback_lock);
+
+			if (stop_requested)
+			{
+				state.queue.stop();
+
+				break;
+			}
+
+			const char* newline = static_cast<const char*>(memchr(line.end, '\n', file_end - line.end));
+
+			const char* next_line = newline == nullptr ? file_end : newline + 1;
+
+			// Advance every pattern that matched the reported line, so that each line is reported only once
+			for (uint32_t i = 0; i != state.pattern_cnt; ++i)
+				if (cursors[i].beg == line.beg)
+					find_next_matching_line(cursors[i], state.patterns[i], next_line, file_end);
+		}
+
+		free(cursors);
+
+		return {};
+	}
+
+	[[nodiscard]] static status submit_content_search_task(content_search_state& state, const char* path, uint32_t path_cunits, const utf8_string* name, uint32_t depth, bool is_directory) noexcept;
+
+	[[nodiscard]] static status search_directory_contents(content_search_state& state, content_search_task* task) noexcept
+	{
+		file_search_handle handle;
+
+		file_search_result result;
+
+		if (status rst = create_file_search(handle, result, task->path()))
+		{
+			if (is_skippable_search_error(rst))
+				return {};
+
+			return to_status(rst);
+		}
+
+		status rst;
+
+		do
+		{
+			if (state.queue.is_stopped())
+				break;
+
+			if (result.is_file())
+			{
+				const utf8_string name = result.name();
+
+				if (result.size() != 0 && state.filter->matches_(name, result.size(), result.is_hidden()))
+				{
+					rst = submit_content_search_task(state, task->path(), task->path_cunits, &name, task->depth, false);
+
+					if (rst)
+						break;
+				}
+			}
+			else if (task->depth < state.filter->max_depth() && is_traversable_directory(result) && (!result.is_hidden() || state.filter->include_hidden()))
+			{
+				const utf8_string name = result.name();
+
+				rst = submit_content_search_task(state, task->path(), task->path_cunits, &name, task->depth + 1, true);
+
+				if (rst)
+					break;
+			}
+
+			rst = advance_file_search(result, handle);
+		}
+		while (!rst);
+
+		ignore_status(close_file_search(handle));
+
+		if (rst && rst != error::no_more_data)
+			return to_status(rst);
+
+		return {};
+	}
+
+	static void run_content_search_task(parallel_task* header) noexcept
+	{
+		content_search_task* task = reinterpret_cast<content_search_task*>(header);
+
+		content_search_state& state = *task->state;
+
+		if (!state.queue.is_stopped())
+			if (status rst = task->is_directory ? search_directory_contents(state, task) : search_mapped_file(state, task))
+				state.queue.fail(rst);
+
+		free(task);
+	}
+
+	// Submits a task for directory\name, or just directory if name is nullptr.
+	[[nodiscard]] static status submit_content_search_task(content_search_state& state, const char* directory, uint32_t directory_cunits, const utf8_string* name, uint32_t depth, bool is_directory) noexcept
+	{
+		const uint32_t path_cunits = name == nullptr ? directory_cunits : join_path(nullptr, directory, directory_cunits, *name);
+
+		content_search_task* task = static_cast<content_search_task*>(malloc(sizeof(content_search_task) + path_cunits + 1));
+
+		if (task == nullptr)
+			return to_status(error::no_memory);
+
+		task->header.run = run_content_search_task;
+
+		task->state = &state;
+
+		task->depth = depth;
+
+		task->path_cunits = path_cunits;
+
+		task->is_directory = is_directory;
+
+		if (name == nullptr)
+		{
+			memcpy(task->path(), directory, directory_cunits);
+
+			task->path()[directory_cunits] = '\0';
+		}
+		else
+		{
+			join_path(task->path(), directory, directory_cunits, *name);
+		}
+
+		state.queue.submit(&task->header);
+
+		return {};
+	}
+
+	static void free_compiled_patterns(compiled_pattern* patterns, uint32_t pattern_cnt) noexcept
+	{
+		for (uint32_t i = 0; i != pattern_cnt; ++i)
+			free(patterns[i].tokens);
+
+		free(patterns);
+	}
+
+	[[nodiscard]] status search_file_contents(const char* root, const content_search_filter& filter, range<const content_search_pattern> patterns, content_search_callback callback, void* userdata, uint32_t max_threads) noexcept
+	{
+		if (patterns.len() == 0 || patterns.len() > UINT32_MAX || callback == nullptr)
+			return to_status(error::argument_invalid);
+
+		compiled_pattern* compiled = static_cast<compiled_pattern*>(calloc(patterns.len(), sizeof(compiled_pattern)));
+
+		if (compiled == nullptr)
+			return to_status(error::no_memory);
+
+		for (uint32_t i = 0; i != patterns.len(); ++i)
+			if (status rst = compile_pattern(compiled[i], patterns[i]))
+			{
+				free_compiled_patterns(compiled, static_cast<uint32_t>(patterns.len()));
+
+				return to_status(rst);
+			}
+
+		char* root_path;
+
+		uint32_t root_cunits;
+
+		if (status rst = normalize_root_path(&root_path, root_cunits, root))
+		{
+			free_compiled_patterns(compiled, static_cast<uint32_t>(patterns.len()));
+
+			return to_status(rst);
+		}
+
+		content_search_state state;
+
+		state.filter = &filter;
+
+		state.patterns = compiled;
+
+		state.pattern_cnt = static_cast<uint32_t>(patterns.len());
+
+		state.callback = callback;
+
+		state.userdata = userdata;
+
+		status rst = state.queue.create(max_threads);
+
+		if (!rst)
+		{
+			rst = submit_content_search_task(state, root_path, root_cunits, nullptr, 0, true);
+
+			if (rst)
+				state.queue.fail(rst);
+
+			rst = state.queue.wait();
+		}
+
+		free(root_path);
+
+		free_compiled_patterns(compiled, state.pattern_cnt);
+
+		if (rst)
+			return to_status(rst);
+
+		return {};
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////find_duplicates/////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	static constexpr uint32_t DUPLICATE_HEAD_BYTES = 4096;
+
+	static constexpr uint32_t DUPLICATE_READ_BUFFER_BYTES = 1 << 20;
+
+	// Streaming MurmurHash3_x64_128. Every chunk but the last must be a multiple of 16 bytes long.
+	struct content_hasher
+	{
+		static constexpr uint64_t c1 = 0x87C37B91114253D5;
+
+		static constexpr uint64_t c2 = 0x4CF5AD432745937F;
+
+		uint64_t h1 = 0;
+
+		uint64_t h2 = 0;
+
+		uint64_t total_bytes = 0;
+
+		[[nodiscard]] static uint64_t rotl(uint64_t n, uint32_t s) noexcept
+		{
+			return (n << s) | (n >> (64 - s));
+		}
+
+		[[nodiscard]] static uint64_t load(const uint8_t* data, uint32_t bytes) noexcept
+		{
+			uint64_t n = 0;
+
+			for (uint32_t i = 0; i != bytes; ++i)
+				n |= static_cast<uint64_t>(data[i]) << (i * 8);
+
+			return n;
+		}
+
+		[[nodiscard]] static uint64_t fmix(uint64_t k) noexcept
+		{
+			k ^= k >> 33;
+
+			k *= 0xFF51AFD7ED558CCD;
+
+			k ^= k >> 33;
+
+			k *= 0xC4CEB9FE1A85EC53;
+
+			k ^= k >> 33;
+
+			return k;
+		}
+
+		void update(const uint8_t* data, size_t bytes) noexcept
+		{
+			total_bytes += bytes;
+
+			const uint8_t* const blocks_end = data + (bytes & ~static_cast<size_t>(15));
+
+			for (; data != blocks_end; data += 16)
+			{
+				uint64_t k1, k2;
+
+				memcpy(&k1, data, 8);
+
+				memcpy(&k2, data + 8, 8);
+
+				h1 ^= rotl(k1 * c1, 31) * c2;
+
+				h1 = (rotl(h1, 27) + h2) * 5 + 0x52DCE729;
+
+				h2 ^= rotl(k2 * c2, 33) * c1;
+
+				h2 = (rotl(h2, 31) + h1) * 5 + 0x38495AB5;
+			}
+
+			const uint32_t tail_bytes = static_cast<uint32_t>(bytes & 15);
+
+			if (tail_bytes > 8)
+				h2 ^= rotl(load(data + 8, tail_bytes - 8) * c2, 33) * c1;
+
+			if (tail_bytes != 0)
+				h1 ^= rotl(load(data, tail_bytes < 8 ? tail_bytes : 8) * c1, 31) * c2;
+		}
+
+		void finalize(uint64_t out_hash[2]) const noexcept
+		{
+			uint64_t f1 = h1 ^ total_bytes, f2 = h2 ^ total_bytes;
+
+			f1 += f2;
+
+			f2 += f1;
+
+			f1 = fmix(f1);
+
+			f2 = fmix(f2);
+
+			f1 += f2;
+
+			f2 += f1;
+
+			out_hash[0] = f1;
+
+			out_hash[1] = f2;
+		}
+	};
+
+	struct duplicate_candidate
+	{
+		char* path;
+
+		uint64_t bytes;
+
+		uint64_t hash[2];
+
+		uint64_t volume_serial;
+
+		uint64_t file_index;
+
+		bool is_readable;
+	};
+
+	struct duplicate_hash_task
+	{
+		parallel_task header;
+
+		duplicate_candidate* candidate;
+
+		bool hash_full_contents;
+	};
+
+	// Fills buf unless the end of file is reached first, so that only the final chunk passed to content_hasher is short.
+	[[nodiscard]] static status read_chunk(uint32_t& out_bytes, const iohandle& file, uint8_t* buf, uint32_t buf_bytes) noexcept
+	{
+		out_bytes = 0;
+
+		while (out_bytes != buf_bytes)
+		{
+			range<uint8_t> read;
+
+			check(read_from_file(read, file, range<uint8_t>(buf + out_bytes, buf_bytes - out_bytes)));
+
+			if (read.len() == 0)
+				break;
+
+			out_bytes += static_cast<uint32_t>(read.len());
+		}
+
+		return {};
+	}
+
+	[[nodiscard]] static status hash_candidate(duplicate_candidate& candidate, bool hash_full_contents) noexcept
+	{
+		iohandle file;
+
+		// Files that are locked or vanished since they were enumerated simply drop out of the candidates
+		if (open_file(file, candidate.path, fio::access::read, fio::open::normal, fio::open::fail, fio::share::read_write_remove))
+		{
+			candidate.is_readable = false;
+
+			return {};
+		}
+
+		uint8_t head_buf[DUPLICATE_HEAD_BYTES];
+
+		uint8_t* buf = head_buf;
+
+		uint32_t buf_bytes = DUPLICATE_HEAD_BYTES;
+
+		if (hash_full_contents)
+		{
+			buf_bytes = candidate.bytes < DUPLICATE_READ_BUFFER_BYTES ? static_cast<uint32_t>(candidate.bytes) : DUPLICATE_READ_BUFFER_BYTES;
+
+			buf = static_cast<uint8_t*>(malloc(buf_bytes));
+
+			if (buf == nullptr)
+			{
+				ignore_status(close_file(file));
+
+				return to_status(error::no_memory);
+			}
+		}
+		else
+		{
+			BY_HANDLE_FILE_INFORMATION info;
+
+			if (GetFileInformationByHandle(file.get_(), &info))
+			{
+				candidate.volume_serial = info.dwVolumeSerialNumber;
+
+				candidate.file_index = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+			}
+		}
+
+		content_hasher hasher;
+
+		uint32_t chunk_bytes;
+
+		do
+		{
+			if (read_chunk(chunk_bytes, file, buf, buf_bytes))
+			{
+				candidate.is_readable = false;
+
+				break;
+			}
+
+			hasher.update(buf, chunk_bytes);
+		}
+		while (hash_full_contents && chunk_bytes == buf_bytes);
+
+		hasher.finalize(candidate.hash);
+
+		if (buf != head_buf)
+			free(buf);
+
+		ignore_status(close_file(file));
+
+		return {};
+	}
+
+	static void run_duplicate_hash_task(parallel_task* header) noexcept
+	{
+		duplicate_hash_task* task = reinterpret_cast<duplicate_hash_task*>(header);
+
+		if (!task->header.queue->is_stopped())
+			if (status rst = hash_candidate(*task->candidate, task->hash_full_contents))
+				task->header.queue->fail(rst);
+	}
+
+	// Hashes either the heads or the full contents of candidates on a fresh queue. Files that fit within the head are
+	// skipped when hashing full contents, since their head hash already covers everything.
+	[[nodiscard]] static status hash_duplicate_candidates(duplicate_candidate* candidates, uint32_t candidate_cnt, bool hash_full_contents, uint32_t max_io_threads) noexcept
+	{
+		// Tasks live in a single array which is only freed after all of them have run
+		duplicate_hash_task* tasks = static_cast<duplicate_hash_task*>(malloc(candidate_cnt * sizeof(duplicate_hash_task)));
+
+		if (tasks == nullptr)
+			return to_status(error::no_memory);
+
+		parallel_queue queue;
+
+		status rst = queue.create(max_io_threads);
+
+		if (!rst)
+		{
+			for (uint32_t i = 0; i != candidate_cnt; ++i)
+			{
+				if (hash_full_contents && candidates[i].bytes <= DUPLICATE_HEAD_BYTES)
+					continue;
+
+				tasks[i].header.run = run_duplicate_hash_task;
+
+				tasks[i].candidate = candidates + i;
+
+				tasks[i].hash_full_contents = hash_full_contents;
+
+				queue.submit(&tasks[i].header);
+			}
+
+			rst = queue.wait();
+		}
+
+		free(tasks);
+
+		if (rst)
+			return to_status(rst);
+
+		return {};
+	}
+
+	static int compare_candidate_sizes(const void* l, const void* r) noexcept
+	{
+		const duplicate_candidate* lc = static_cast<const duplicate_candidate*>(l);
+
+		const duplicate_candidate* rc = static_cast<const duplicate_candidate*>(r);
+
+		if (lc->bytes != rc->bytes)
+			return lc->bytes < rc->bytes ? -1 : 1;
+
+		return 0;
+	}
+
+	static int compare_candidate_contents(const void* l, const void* r) noexcept
+	{
+		const duplicate_candidate* lc = static_cast<const duplicate_candidate*>(l);
+
+		const duplicate_candidate* rc = static_cast<const duplicate_candidate*>(r);
+
+		// Unreadable candidates sort to the end, so they never end up in a run with readable ones
+		if (lc->is_readable != rc->is_readable)
+			return lc->is_readable ? -1 : 1;
+
+		if (int cmp = compare_candidate_sizes(l, r))
+			return cmp;
+
+		if (lc->hash[0] != rc->hash[0])
+			return lc->hash[0] < rc->hash[0] ? -1 : 1;
+
+		if (lc->hash[1] != rc->hash[1])
+			return lc->hash[1] < rc->hash[1] ? -1 : 1;
+
+		return 0;
+	}
+
+	// Orders like compare_candidate_contents, but additionally places names of the same file next to each other
+	static int compare_candidate_identities(const void* l, const void* r) noexcept
+	{
+		if (int cmp = compare_candidate_contents(l, r))
+			return cmp;
+
+		const duplicate_candidate* lc = static_cast<const duplicate_candidate*>(l);
+
+		const duplicate_candidate* rc = static_cast<const duplicate_candidate*>(r);
+
+		if (lc->volume_serial != rc->volume_serial)
+			return lc->volume_serial < rc->volume_serial ? -1 : 1;
+
+		if (lc->file_index != rc->file_index)
+			return lc->file_index < rc->file_index ? -1 : 1;
+
+		return 0;
+	}
+
+	[[nodiscard]] static bool is_same_file(const duplicate_candidate& l, const duplicate_candidate& r) noexcept
+	{
+		return l.file_index != 0 && l.volume_serial == r.volume_serial && l.file_index == r.file_index;
+	}
+
+	// Sorts candidates and keeps only runs of at least two readable, distinct files comparing equal under run_compare,
+	// freeing the paths of all other candidates. sort_compare must order candidates consistently with run_compare.
+	// Returns the number of remaining candidates and optionally assigns every run a group index.
+	[[nodiscard]] static uint32_t keep_duplicate_runs(duplicate_candidate* candidates, uint32_t candidate_cnt, int (*sort_compare)(const void*, const void*) noexcept, int (*run_compare)(const void*, const void*) noexcept, uint32_t* out_group_cnt) noexcept
+	{
+		qsort(candidates, candidate_cnt, sizeof(duplicate_candidate), sort_compare);
+
+		uint32_t kept_cnt = 0;
+
+		uint32_t group_cnt = 0;
+
+		uint32_t run_beg = 0;
+
+		while (run_beg != candidate_cnt)
+		{
+			uint32_t run_end = run_beg + 1;
+
+			while (run_end != candidate_cnt && run_compare(candidates + run_beg, candidates + run_end) == 0)
+				++run_end;
+
+			const uint32_t run_kept_beg = kept_cnt;
+
+			for (uint32_t i = run_beg; i != run_end; ++i)
+			{
+				const bool is_duplicate_name = i != run_beg && is_same_file(candidates[i - 1], candidates[i]);
+
+				if (candidates[i].is_readable && !is_duplicate_name)
+					candidates[kept_cnt++] = candidates[i];
+				else
+					free(candidates[i].path);
+			}
+
+			if (kept_cnt - run_kept_beg < 2)
+			{
+				for (uint32_t i = run_kept_beg; i != kept_cnt; ++i)
+					free(candidates[i].path);
+
+				kept_cnt = run_kept_beg;
+			}
+			else if (out_group_cnt != nullptr)
+			{
+				// Group indices are stashed in file_index, which is no longer needed once runs have been formed
+				for (uint32_t i = run_kept_beg; i != kept_cnt; ++i)
+					candidates[i].file_index = group_cnt;
+
+				++group_cnt;
+			}
+
+			run_beg = run_end;
+		}
+
+		if (out_group_cnt != nullptr)
+			*out_group_cnt = group_cnt;
+
+		return kept_cnt;
+	}
+
+	[[nodiscard]] static status add_duplicate_candidate(duplicate_candidate** candidates, uint32_t& candidate_cnt, uint32_t& candidate_capacity, const utf8_string& path, uint64_t bytes) noexcept
+	{
+		if (candidate_cnt == candidate_capacity)
+		{
+			uint32_t new_capacity = candidate_capacity == 0 ? 256 : candidate_capacity * 2;
+
+			duplicate_candidate* tmp = static_cast<duplicate_candidate*>(realloc(*candidates, new_capacity * sizeof(duplicate_candidate)));
+
+			if (tmp == nullptr)
+				return to_status(error::no_memory);
+
+			*candidates = tmp;
+
+			candidate_capacity = new_capacity;
+		}
+
+		char* path_copy = static_cast<char*>(malloc(path.get_codeunits() + 1));
+
+		if (path_copy == nullptr)
+			return to_status(error::no_memory);
+
+		memcpy(path_copy, path.raw_cbegin(), path.get_codeunits() + 1);
+
+		(*candidates)[candidate_cnt++] = duplicate_candidate{ path_copy, bytes, { 0, 0 }, 0, 0, true };
+
+		return {};
+	}
+
+	[[nodiscard]] static status collect_duplicate_candidates(duplicate_candidate** candidates, uint32_t& candidate_cnt, uint32_t& candidate_capacity, const char* root, uint64_t min_bytes) noexcept
+	{
+		recursive_file_search search;
+
+		check(search.create(root, fio::search::files, nullptr, recursive_file_search::MAX_RECURSION_DEPTH));
+
+		while (search.has_more())
+		{
+			if (search.curr_size() >= min_bytes)
+				check(add_duplicate_candidate(candidates, candidate_cnt, candidate_capacity, search.curr_path(), search.curr_size()));
+
+			check(search.advance());
+		}
+
+		return {};
+	}
+
+	static void free_duplicate_candidates(duplicate_candidate* candidates, uint32_t candidate_cnt) noexcept
+	{
+		for (uint32_t i = 0; i != candidate_cnt; ++i)
+			free(candidates[i].path);
+
+		free(candidates);
+	}
+
+	[[nodiscard]] static status find_duplicate_candidates(duplicate_candidate* candidates, uint32_t& candidate_cnt, uint32_t& out_group_cnt, uint32_t max_io_threads) noexcept
+	{
+		candidate_cnt = keep_duplicate_runs(candidates, candidate_cnt, compare_candidate_sizes, compare_candidate_sizes, nullptr);
+
+		if (candidate_cnt == 0)
+			return {};
+
+		check(hash_duplicate_candidates(candidates, candidate_cnt, false, max_io_threads));
+
+		candidate_cnt = keep_duplicate_runs(candidates, candidate_cnt, compare_candidate_identities, compare_candidate_contents, nullptr);
+
+		if (candidate_cnt == 0)
+			return {};
+
+		check(hash_duplicate_candidates(candidates, candidate_cnt, true, max_io_threads));
+
+		candidate_cnt = keep_duplicate_runs(candidates, candidate_cnt, compare_candidate_identities, compare_candidate_contents, &out_group_cnt);
+
+		return {};
+	}
+
+	void duplicate_result::close() noexcept
+	{
+		if (m_files == nullptr)
+			return;
+
+		for (uint32_t i = 0; i != m_file_cnt; ++i)
+			free(const_cast<char*>(m_files[i].path.raw_cbegin()));
+
+		free(m_files);
+
+		m_files = nullptr;
+
+		m_file_cnt = 0;
+
+		m_group_cnt = 0;
+	}
+
+	[[nodiscard]] status find_duplicates(duplicate_result& out_result, range<const char* const> roots, uint64_t min_bytes, uint32_t max_io_threads) noexcept
+	{
+		out_result.close();
+
+		if (min_bytes == 0)
+			min_bytes = 1;
+
+		duplicate_candidate* candidates = nullptr;
+
+		uint32_t candidate_cnt = 0;
+
+		uint32_t candidate_capacity = 0;
+
+		uint32_t group_cnt = 0;
+
+		status rst;
+
+		for (uint32_t i = 0; i != roots.len() && !rst; ++i)
+			rst = collect_duplicate_candidates(&candidates, candidate_cnt, candidate_capacity, roots[i], min_bytes);
+
+		if (!rst)
+			rst = find_duplicate_candidates(candidates, candidate_cnt, group_cnt, max_io_threads);
+
+		if (rst)
+		{
+			free_duplicate_candidates(candidates, candidate_cnt);
+
+			return to_status(rst);
+		}
+
+		duplicate_file* files = nullptr;
+
+		if (candidate_cnt != 0)
+		{
+			files = static_cast<duplicate_file*>(malloc(candidate_cnt * sizeof(duplicate_file)));
+
+			if (files == nullptr)
+			{
+				free_duplicate_candidates(candidates, candidate_cnt);
+
+				return to_status(error::no_memory);
+			}
+		}
+
+		for (uint32_t i = 0; i != candidate_cnt; ++i)
+			files[i] = duplicate_file{ utf8_view(candidates[i].path), candidates[i].bytes, static_cast<uint32_t>(candidates[i].file_index) };
+
+		free(candidates);
+
+		out_result.set_(files, candidate_cnt, group_cnt);
+
+		return {};
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////persistent_ring/////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	// Head and tail are kept on separate cache lines, as readers poll head while the writer only rarely touches tail.
+	// The writer publishes magic and head with release stores that readers pair with acquire loads. Readers copy a
+	// record without synchronization and only trust the copy if tail has not passed it afterwards, like a seqlock.
+	struct persistent_ring_header
+	{
+		std::atomic<uint64_t> magic;
+
+		uint64_t capacity;
+
+		uint8_t unused_0[48];
+
+		std::atomic<uint64_t> head; // Position directly after the newest record
+
+		uint8_t unused_1[56];
+
+		std::atomic<uint64_t> tail; // Position of the oldest record
+	};
+
+	static_assert(sizeof(persistent_ring_header) <= persistent_ring_writer::HEADER_BYTES);
+
+	// The header is shared with other processes through a file mapping, which only works for lock-free atomics
+	static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+	static constexpr uint64_t PERSISTENT_RING_MAGIC = 0x31474E4952484F43ull; // "OCHRING1"
+
+	// Each record is preceded by its size in the low half and the complement thereof in the high half of an eight-byte
+	// header, letting readers reject garbage. Records are padded to a multiple of eight bytes, so headers never wrap.
+	static uint64_t persistent_ring_record_header(uint32_t record_bytes) noexcept
+	{
+		return static_cast<uint64_t>(record_bytes) | (static_cast<uint64_t>(~record_bytes) << 32);
+	}
+
+	static uint64_t persistent_ring_stride(uint64_t record_bytes) noexcept
+	{
+		return (persistent_ring_writer::RECORD_HEADER_BYTES + record_bytes + 7) & ~7ull;
+	}
+
+	static bool persistent_ring_capacity_valid(uint64_t capacity) noexcept
+	{
+		return capacity >= 4096 && capacity <= 0x80000000ull && (capacity & (capacity - 1)) == 0;
+	}
+
+	[[nodiscard]] status persistent_ring_writer::create(const char* filename, uint64_t capacity) noexcept
+	{
+		if (!persistent_ring_capacity_valid(capacity))
+			return to_status(error::argument_invalid);
+
+		check(m_file.create(filename, fio::access::read_write, fio::open::normal, fio::open::normal, 0, HEADER_BYTES + capacity, fio::share::read_write));
+
+		persistent_ring_header* header = reinterpret_cast<persistent_ring_header*>(m_file.data());
+
+		if (header->magic.load(std::memory_order_acquire) == PERSISTENT_RING_MAGIC)
+		{
+			const uint64_t head = header->head.load(std::memory_order_relaxed);
+
+			const uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+			if (header->capacity != capacity || tail > head || head - tail > capacity)
+			{
+				close();
+
+				return to_status(error::argument_invalid);
+			}
+		}
+		else
+		{
+			header->capacity = capacity;
+
+			header->head.store(0, std::memory_order_relaxed);
+
+			header->tail.store(0, std::memory_order_relaxed);
+
+			// Readers only trust the header once they see the magic
+			header->magic.store(PERSISTENT_RING_MAGIC, std::memory_order_release);
+		}
+
+		m_capacity = capacity;
+
+		return {};
+	}
+
+	[[nodiscard]] status persistent_ring_writer::write(range<const uint8_t> record) noexcept
+	{
+		if (record.len() > max_record_bytes())
+			return to_status(error::argument_too_large);
+
+		persistent_ring_header* header = reinterpret_cast<persistent_ring_header*>(m_file.data());
+
+		uint8_t* data = m_file.data() + HEADER_BYTES;
+
+		const uint64_t mask = m_capacity - 1;
+
+		const uint64_t head = header->head.load(std::memory_order_relaxed);
+
+		const uint64_t new_head = head + persistent_ring_stride(record.len());
+
+		uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+		if (new_head - tail > m_capacity)
+		{
+			do
+			{
+				const uint32_t dropped_bytes = static_cast<uint32_t>(*reinterpret_cast<const uint64_t*>(data + (tail & mask)));
+
+				tail += persistent_ring_stride(dropped_bytes);
+			}
+			while (new_head - tail > m_capacity);
+
+			// Readers check tail after copying a record, so it has to be advanced before the dropped records are overwritten
+			header->tail.store(tail, std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		*reinterpret_cast<uint64_t*>(data + (head & mask)) = persistent_ring_record_header(static_cast<uint32_t>(record.len()));
+
+		const uint64_t payload_offset = (head + RECORD_HEADER_BYTES) & mask;
+
+		const uint64_t first_bytes = record.len() < m_capacity - payload_offset ? record.len() : m_capacity - payload_offset;
+
+		memcpy(data + payload_offset, record.beg, first_bytes);
+
+		memcpy(data, record.beg + first_bytes, record.len() - first_bytes);
+
+		header->head.store(new_head, std::memory_order_release);
+
+		return {};
+	}
+
+	[[nodiscard]] status persistent_ring_writer::flush() const noexcept
+	{
+		check(m_file.flush());
+
+		return {};
+	}
+
+	void persistent_ring_writer::close() noexcept
+	{
+		m_file.close();
+
+		m_capacity = 0;
+	}
+
+	[[nodiscard]] status persistent_ring_reader::create(const char* filename, bool from_oldest) noexcept
+	{
+		check(m_file.create(filename, fio::access::read, fio::open::fail, fio::open::fail, 0, 0, fio::share::read_write));
+
+		const persistent_ring_header* header = reinterpret_cast<const persistent_ring_header*>(m_file.data());
+
+		if (m_file.bytes() < persistent_ring_writer::HEADER_BYTES || header->magic.load(std::memory_order_acquire) != PERSISTENT_RING_MAGIC)
+		{
+			close();
+
+			return to_status(error::argument_invalid);
+		}
+
+		const uint64_t capacity = header->capacity;
+
+		if (!persistent_ring_capacity_valid(capacity) || m_file.bytes() < persistent_ring_writer::HEADER_BYTES + capacity)
+		{
+			close();
+
+			return to_status(error::argument_invalid);
+		}
+
+		m_capacity = capacity;
+
+		m_pos = from_oldest ? header->tail.load(std::memory_order_acquire) : header->head.load(std::memory_order_acquire);
+
+		m_lost_bytes = 0;
+
+		return {};
+	}
+
+	[[nodiscard]] status persistent_ring_reader::read(range<uint8_t>& out_record, range<uint8_t> buf) noexcept
+	{
+		const persistent_ring_header* header = reinterpret_cast<const persistent_ring_header*>(m_file.data());
+
+		const uint8_t* data = m_file.data() + persistent_ring_writer::HEADER_BYTES;
+
+		const uint64_t mask = m_capacity - 1;
+
+		while (true)
+		{
+			const uint64_t head = header->head.load(std::memory_order_acquire);
+
+			const uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+			if (m_pos < tail)
+			{
+				m_lost_bytes += tail - m_pos;
+
+				m_pos = tail;
+			}
+
+			if (m_pos == head)
+				return to_status(error::no_more_data);
+
+			// tail was loaded after head and may already be past it
+			if (m_pos > head)
+				continue;
+
+			uint64_t record_header;
+
+			memcpy(&record_header, data + (m_pos & mask), sizeof(record_header));
+
+			const uint32_t record_bytes = static_cast<uint32_t>(record_header);
+
+			const bool is_valid = record_header == persistent_ring_record_header(record_bytes) && record_bytes <= max_record_bytes();
+
+			const bool is_fitting = record_bytes <= buf.len();
+
+			if (is_valid && is_fitting)
+			{
+				const uint64_t payload_offset = (m_pos + persistent_ring_writer::RECORD_HEADER_BYTES) & mask;
+
+				const uint64_t first_bytes = record_bytes < m_capacity - payload_offset ? record_bytes : m_capacity - payload_offset;
+
+				memcpy(buf.beg, data + payload_offset, first_bytes);
+
+				memcpy(buf.beg + first_bytes, data, record_bytes - first_bytes);
+			}
+
+			// Pairs with the writer's fence after advancing tail, so that a copy of overwritten data is always followed by
+			// seeing the tail that dropped it
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// The writer dropped the record while it was being read, so the copy cannot be trusted
+			if (header->tail.load(std::memory_order_relaxed) > m_pos)
+				continue;
+
+			if (!is_valid)
+				return to_status(error::argument_invalid);
+
+			if (!is_fitting)
+				return to_status(error::insufficient_buffer);
+
+			out_record = range<uint8_t>(buf.beg, record_bytes);
+
+			m_pos += persistent_ring_stride(record_bytes);
+
+			return {};
+		}
+	}
+
+	void persistent_ring_reader::close() noexcept
+	{
+		m_file.close();
+
+		m_capacity = 0;
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////Standard I/O interop//////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	iohandle get_stdout() noexcept
+	{
+		return iohandle(GetStdHandle(STD_OUTPUT_HANDLE));
+	}
+
+	iohandle get_stdin() noexcept
+	{
+		return iohandle(GetStdHandle(STD_INPUT_HANDLE));
+	}
+
+	iohandle get_stderr() noexcept
+	{
+		return iohandle(GetStdHandle(STD_ERROR_HANDLE));
+	}
+}
+
+#elif defined(__linux__)
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <cstdio>
+
+namespace och
+{
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*////////////////////////////////////////////////Free functions/////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	int32_t interp_openmode(fio::open existing_mode, fio::open new_mode) noexcept
+	{
+		switch (existing_mode)
+		{
+		case fio::open::normal:
+			switch (new_mode)
+			{
+			case fio::open::normal:        return O_CREAT;
+			case fio::open::append:        return O_CREAT;
+			case fio::open::truncate:      return O_CREAT;
+			case fio::open::fail:          return 0;
+			}
+			break;
+
+		case fio::open::append:
+			switch (new_mode)
+			{
+			case fio::open::normal:        return O_CREAT | O_APPEND;
+			case fio::open::append:        return O_CREAT | O_APPEND;
+			case fio::open::truncate:      return O_CREAT | O_APPEND;
+			case fio::open::fail:          return O_APPEND;
+			}
+			break;
+
+		case fio::open::truncate:
+			switch (new_mode)
+			{
+			case fio::open::normal:        return O_CREAT | O_TRUNC;
+			case fio::open::append:        return O_CREAT | O_TRUNC;
+			case fio::open::truncate:      return O_CREAT | O_TRUNC;
+			case fio::open::fail:          return O_TRUNC;
+			}
+			break;
+
+		case fio::open::fail:
+			switch (new_mode)
+			{
+			case fio::open::normal:       return O_CREAT | O_EXCL;
+			case fio::open::append:       return O_CREAT | O_EXCL;
+			case fio::open::truncate:     return O_CREAT | O_EXCL;
+			case fio::open::fail:         break;
+			}
+			break;
+		}
+
+		return -1;
+	}
+
+	int32_t access_interp_open(fio::access access_rights) noexcept
+	{
+		switch (access_rights)
+		{
+		case och::fio::access::read:       return O_RDONLY;
+		case och::fio::access::write:      return O_WRONLY;
+		case och::fio::access::read_write: return O_RDWR;
+		}
+
+		return -1;
+	}
+
+	int32_t access_interp_mmap(fio::access access_rights) noexcept
+	{
+		switch (access_rights)
+		{
+		case och::fio::access::read:       return PROT_READ;
+		case och::fio::access::write:      return PROT_WRITE;
+		case och::fio::access::read_write: return PROT_READ | PROT_WRITE;
+		}
+
+		return -1;
+	}
+
+	[[nodiscard]] status open_file(iohandle& out_handle, const char* filename, fio::access access_rights, fio::open existing_mode, fio::open new_mode, fio::share share_mode, fio::flag flags) noexcept
+	{
+		int32_t access = access_interp_open(access_rights);
+
+		int32_t openmode = interp_openmode(existing_mode, new_mode);
+
+		int32_t fileflags = access | openmode;
+
+		if (fileflags == -1)
+			return to_status(error::argument_invalid);
+
+		if ((flags | fio::all_flags) != fio::all_flags)
+			return to_status(error::argument_invalid);
+
+		if ((flags & fio::flag::temporary) == fio::flag::temporary)
+			fileflags |= O_TMPFILE;
+
+		const char* final_filename = filename;
+
+		char name_buf[4096];
+
+		if ((flags & fio::flag::hidden) == fio::flag::hidden && filename[0] != '.')
+		{
+			name_buf[0] = '.';
+
+			size_t i = 1;
+
+			for (; i != 4095 && filename[i]; ++i)
+				name_buf[i] = filename[i - 1];
+
+			if (filename[i])
+				return to_status(error::argument_too_large);
+
+			name_buf[i] = '\0';
+
+			final_filename = name_buf;
+		}
+
+		if ((flags & fio::flag::async) == fio::flag::async)
+			return to_status(error::function_unavailable);
+
+		int32_t fd = iohandle(open(final_filename, fileflags, S_IRUSR | S_IWUSR));
+
+		if (fd == -1)
+			return to_status(errno);
+
+		out_handle.set_(fd);
+
+		return {};
+	}
+
+	[[nodiscard]] status create_file_mapper(file_mapper_handle& out_handle, const iohandle& file, uint64_t size, fio::access access_rights, const char* mapping_name = nullptr) noexcept
+	{
+		out_handle.set_(file.get_());
+
+		return {};
+	}
+
+	[[nodiscard]] status file_as_array(file_array_handle& out_handle, const file_mapper_handle& file_mapper, fio::access access_rights, uint64_t beg, uint64_t end) noexcept
+	{
+		out_handle.invalidate();
+
+		int32_t access = access_interp_mmap(access_rights);
+
+		if (access == -1)
+			return to_status(error::argument_invalid);
+
+		uint64_t len = end - beg;
+
+		if (len == 0)
+		{
+			struct stat fs;
+
+			if (fstat(file_mapper.get_(), &fs))
+				return to_status(errno);
+
+			len = fs.st_size;
+		}
+
+		void* ptr = mmap(nullptr, len, access, 0, file_mapper.get_(), beg);
+
+		if (ptr == MAP_FAILED)
+			return to_status(errno);
+
+		out_handle.set_(ptr, len);
+
+		return {};
+	}
+
+	[[nodiscard]] status create_file_search(file_search_handle& out_handle, file_search_result& out_result, const char* directory) noexcept
+	{
+		out_handle.invalidate_();
+
+		DIR* dir = opendir(directory);
+
+		if (!dir)
+			return to_status(errno);
+
+		out_handle.set_(dir);
+
+		check(advance_file_search(out_handle, out_result));
+
+		return {};
+	}
+
+	[[nodiscard]] status close_file(iohandle& file) noexcept
+	{
+		if (close(file.get_()))
+			return to_status(errno);
+
+		return {};
+	}
+
+	[[nodiscard]] status close_file_mapper(file_mapper_handle& handle) noexcept
+	{
+		return {};
+	}
+
+	[[nodiscard]] status close_file_array(file_array_handle& file_array) noexcept
+	{
+		if (munmap(file_array.ptr(), file_array.bytes()))
+			return to_status(errno);
+
+		return {};
+	}
+
+	[[nodiscard]] status flush_file_array(const file_array_handle& file_array, uint64_t offset, uint64_t bytes) noexcept
+	{
+		// msync requires a page-aligned address
+		const uint64_t aligned_offset = offset & ~static_cast<uint64_t>(sysconf(_SC_PAGESIZE) - 1);
+
+		const uint64_t aligned_bytes = bytes == 0 ? file_array.bytes() - aligned_offset : bytes + offset - aligned_offset;
+
+		if (msync(static_cast<uint8_t*>(file_array.ptr()) + aligned_offset, aligned_bytes, MS_SYNC))
+			return to_status(errno);
+
+		return {};
+	}
+
+	[[nodiscard]] status flush_file(const iohandle& file) noexcept
+	{
+		if (fsync(file.get_()))
+			return to_status(errno);
+
+		return {};
+	}
+
+	[[nodiscard]] status close_file_search(file_search_handle& file_search) noexcept
+	{
+		if (closedir(static_cast<DIR*>(file_search.get_())))
+			return to_status(errno);
+
+		file_search.invalidate_();
+
+		return {};
+	}
+
+	[[nodiscard]] status delete_file(const char* filename) noexcept
+	{
+		if (unlink(filename))
+			return to_status(errno);
+
+		return {};
+	}
+
+	[[nodiscard]] status rename_file(const char* old_filename, const char* new_filename, bool replace_existing) noexcept
+	{
+		if (!replace_existing && access(new_filename, F_OK) == 0)
+			return to_status(EEXIST);
+
+		if (rename(old_filename, new_filename))
+			return to_status(errno);
+
+		return {};
+	}
+
+	[[nodiscard]] status delete_file(const iohandle& file) noexcept
+	{
+		char path_buf[1024];
+
+		och::range buf(path_buf);
+
+		och::range path;
 
 		check(get_filepath(path, file, buf));
 
@@ -2016,6 +4294,120 @@ namespace och
 
 
 
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////////disk_usage////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void disk_usage_result::close() noexcept
+	{
+		if (m_entries == nullptr)
+			return;
+
+		for (uint32_t i = 0; i != m_entry_cnt; ++i)
+			free(const_cast<char*>(m_entries[i].path.raw_cbegin()));
+
+		free(m_entries);
+
+		m_entries = nullptr;
+
+		m_entry_cnt = 0;
+	}
+
+	[[nodiscard]] status disk_usage(disk_usage_result& out_result, const char* root, uint32_t max_depth, uint64_t byte_budget, uint32_t max_threads) noexcept
+	{
+		out_result.close();
+
+		return to_status(error::function_unavailable);
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////content search//////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	[[nodiscard]] status search_file_contents(const char* root, const content_search_filter& filter, range<const content_search_pattern> patterns, content_search_callback callback, void* userdata, uint32_t max_threads) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////find_duplicates/////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void duplicate_result::close() noexcept
+	{
+		if (m_files == nullptr)
+			return;
+
+		for (uint32_t i = 0; i != m_file_cnt; ++i)
+			free(const_cast<char*>(m_files[i].path.raw_cbegin()));
+
+		free(m_files);
+
+		m_files = nullptr;
+
+		m_file_cnt = 0;
+
+		m_group_cnt = 0;
+	}
+
+	[[nodiscard]] status find_duplicates(duplicate_result& out_result, range<const char* const> roots, uint64_t min_bytes, uint32_t max_io_threads) noexcept
+	{
+		out_result.close();
+
+		return to_status(error::function_unavailable);
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////persistent_ring/////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	[[nodiscard]] status persistent_ring_writer::create(const char* filename, uint64_t capacity) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status persistent_ring_writer::write(range<const uint8_t> record) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status persistent_ring_writer::flush() const noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	void persistent_ring_writer::close() noexcept
+	{
+		m_file.close();
+
+		m_capacity = 0;
+	}
+
+	[[nodiscard]] status persistent_ring_reader::create(const char* filename, bool from_oldest) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status persistent_ring_reader::read(range<uint8_t>& out_record, range<uint8_t> buf) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	void persistent_ring_reader::close() noexcept
+	{
+		m_file.close();
+
+		m_capacity = 0;
+	}
+
+
+
 	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
 	/*/////////////////////////////////////////////Standard I/O interop//////////////////////////////////////////////////////*/
 	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
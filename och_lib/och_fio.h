@@ -295,12 +295,21 @@ namespace och
 
 	[[nodiscard]] status close_file_array(file_array_handle& file_array) noexcept;
 
+	// Writes the dirty pages of bytes bytes starting offset bytes into file_array back to its file. If bytes is 0, the
+	// whole mapping starting at offset is written back. This does not wait for the device's cache to be flushed.
+	[[nodiscard]] status flush_file_array(const file_array_handle& file_array, uint64_t offset = 0, uint64_t bytes = 0) noexcept;
+
+	[[nodiscard]] status flush_file(const iohandle& file) noexcept;
+
 	[[nodiscard]] status close_file_search(file_search_handle& file_search) noexcept;
 
 	[[nodiscard]] status delete_file(const char* filename) noexcept;
 
 	[[nodiscard]] status delete_file(const iohandle& file) noexcept;
 
+	// Fails if a file named new_filename already exists, unless replace_existing is true.
+	[[nodiscard]] status rename_file(const char* old_filename, const char* new_filename, bool replace_existing = false) noexcept;
+
 	[[nodiscard]] status read_from_file(och::range<uint8_t>& out_read, const iohandle& file, och::range<uint8_t> buf) noexcept;
 
 	[[nodiscard]] status write_to_file(uint32_t& out_written, const iohandle& file, const och::range<const uint8_t> buf) noexcept;
@@ -496,6 +505,16 @@ namespace och
 			return {};
 		}
 
+		// Writes back the elements [beg, beg + cnt) (or all elements from beg if cnt is 0) and waits for them to reach the device.
+		[[nodiscard]] status flush(uint64_t beg = 0, uint64_t cnt = 0) const noexcept
+		{
+			check(flush_file_array(m_data, beg * sizeof(T), cnt * sizeof(T)));
+
+			check(flush_file(m_file));
+
+			return {};
+		}
+
 		[[nodiscard]] uint64_t size() const noexcept
 		{
 			return m_bytes / sizeof(T);
@@ -514,6 +533,103 @@ namespace och
 
 
 
+	// Crash-durable ring of variable-sized records living in a memory-mapped file, intended as a flight recorder.
+	// The first 4 KiB of the file hold a header with the ring's capacity as well as its head and tail positions, which
+	// increase monotonically and are reduced modulo the capacity only when accessing the data following the header.
+	// Once the ring is full, writing a record discards as many of the oldest records as necessary to make room for it.
+	// Since records are published by a plain store after being copied into the mapping, everything written before a
+	// crash of the writing process is preserved by the system. Use flush to also survive a crash of the system itself.
+	// There must be at most one writer per file at a time, which may be in a different process than any of the readers.
+	struct persistent_ring_writer
+	{
+		static constexpr uint64_t HEADER_BYTES = 4096;
+
+		static constexpr uint64_t RECORD_HEADER_BYTES = 8;
+
+	private:
+
+		mapped_file<uint8_t> m_file;
+
+		uint64_t m_capacity = 0;
+
+	public:
+
+		persistent_ring_writer() noexcept = default;
+
+		persistent_ring_writer(const persistent_ring_writer&) = delete;
+
+		persistent_ring_writer(persistent_ring_writer&&) = delete;
+
+		// Opens the ring in filename, creating it if it does not exist yet. Records already present are kept, in which case
+		// capacity must match the one the ring was created with. capacity must be a power of two and at least 4 KiB.
+		[[nodiscard]] status create(const char* filename, uint64_t capacity) noexcept;
+
+		// Records larger than max_record_bytes() cause error::argument_too_large.
+		[[nodiscard]] status write(range<const uint8_t> record) noexcept;
+
+		template<typename T>
+		[[nodiscard]] status write(range<const T> record) noexcept
+		{
+			return write(range<const uint8_t>(reinterpret_cast<const uint8_t*>(record.beg), reinterpret_cast<const uint8_t*>(record.end)));
+		}
+
+		// Waits until all records written so far have reached the device.
+		[[nodiscard]] status flush() const noexcept;
+
+		void close() noexcept;
+
+		[[nodiscard]] uint64_t max_record_bytes() const noexcept
+		{
+			return m_capacity - RECORD_HEADER_BYTES;
+		}
+	};
+
+	// Follows the records of a persistent_ring_writer, possibly from another process. After attaching, reading does not
+	// involve any system calls, so polling read is cheap. Records that are overwritten before they could be read are
+	// skipped and accounted for in lost_bytes.
+	struct persistent_ring_reader
+	{
+	private:
+
+		mapped_file<uint8_t> m_file;
+
+		uint64_t m_capacity = 0;
+
+		uint64_t m_pos = 0;
+
+		uint64_t m_lost_bytes = 0;
+
+	public:
+
+		persistent_ring_reader() noexcept = default;
+
+		persistent_ring_reader(const persistent_ring_reader&) = delete;
+
+		persistent_ring_reader(persistent_ring_reader&&) = delete;
+
+		// Attaches to the ring in filename, starting at its oldest record if from_oldest is true, or after its newest one otherwise.
+		[[nodiscard]] status create(const char* filename, bool from_oldest = true) noexcept;
+
+		// Copies the next record to buf and points out_record at the copy. If no new record has been written,
+		// error::no_more_data is returned. If buf is smaller than the record, error::insufficient_buffer is returned and
+		// the record is left unread. A buffer of max_record_bytes() bytes is always sufficient.
+		[[nodiscard]] status read(range<uint8_t>& out_record, range<uint8_t> buf) noexcept;
+
+		void close() noexcept;
+
+		[[nodiscard]] uint64_t max_record_bytes() const noexcept
+		{
+			return m_capacity - persistent_ring_writer::RECORD_HEADER_BYTES;
+		}
+
+		[[nodiscard]] uint64_t lost_bytes() const noexcept
+		{
+			return m_lost_bytes;
+		}
+	};
+
+
+
 	struct file_search
 	{
 		static constexpr size_t MAX_EXTENSION_FILTER_CNT = 4;
@@ -634,7 +750,304 @@ namespace och
 		~recursive_file_search() noexcept;
 	};
 
-	
+
+
+	struct disk_usage_entry
+	{
+		utf8_view path;
+
+		uint32_t depth;
+
+		uint32_t parent; // Index of the enclosing directory's entry, or ~0u for the root. Parents always precede their children.
+
+		uint64_t file_cnt;
+
+		uint64_t apparent_bytes;
+
+		uint64_t allocated_bytes; // As reported by the file system, so compressed, sparse and deduplicated files count what they occupy
+
+		uint64_t unreadable_cnt; // Directories whose contents are missing from the totals because they could not be enumerated
+	};
+
+	struct disk_usage_result
+	{
+	private:
+
+		disk_usage_entry* m_entries = nullptr;
+
+		uint32_t m_entry_cnt = 0;
+
+		bool m_budget_exceeded = false;
+
+		status m_first_error;
+
+	public:
+
+		disk_usage_result() noexcept = default;
+
+		disk_usage_result(const disk_usage_result&) = delete;
+
+		disk_usage_result(disk_usage_result&&) = delete;
+
+		[[nodiscard]] range<const disk_usage_entry> entries() const noexcept
+		{
+			return range<const disk_usage_entry>(m_entries, m_entry_cnt);
+		}
+
+		// Totals are incomplete if this is true, as the walk was stopped as soon as the budget passed to disk_usage was exceeded.
+		[[nodiscard]] bool budget_exceeded() const noexcept
+		{
+			return m_budget_exceeded;
+		}
+
+		// Reason the first unreadable directory could not be enumerated, if any entry has a non-zero unreadable_cnt
+		[[nodiscard]] status first_error() const noexcept
+		{
+			return m_first_error;
+		}
+
+		void close() noexcept;
+
+		void set_(disk_usage_entry* entries, uint32_t entry_cnt, bool budget_exceeded, status first_error) noexcept
+		{
+			close();
+
+			m_entries = entries;
+
+			m_entry_cnt = entry_cnt;
+
+			m_budget_exceeded = budget_exceeded;
+
+			m_first_error = first_error;
+		}
+
+		~disk_usage_result() noexcept
+		{
+			close();
+		}
+	};
+
+	// Sums up the files below root for every directory at most max_depth levels below it, similar to du -d.
+	// Subdirectories are enumerated in parallel on up to max_threads threads (0 uses one per logical processor).
+	// The walk stops early once more than byte_budget apparent bytes have been found. Directories that cannot be
+	// enumerated are counted in unreadable_cnt instead of failing the walk.
+	// Reparse points (symbolic links and junctions) are not followed. Unlike du, sizes are counted per name, so a file
+	// with several hard links below root is counted once for each of them.
+	[[nodiscard]] status disk_usage(disk_usage_result& out_result, const char* root, uint32_t max_depth, uint64_t byte_budget = ~0ull, uint32_t max_threads = 0) noexcept;
+
+
+
+	struct content_search_filter
+	{
+		static constexpr size_t MAX_EXTENSION_FILTER_CNT = 8;
+
+		static constexpr size_t MAX_EXTENSION_FILTER_CUNITS = 8;
+
+	private:
+
+		char m_ext_filters[MAX_EXTENSION_FILTER_CNT][MAX_EXTENSION_FILTER_CUNITS + 1]{};
+
+		uint32_t m_ext_filter_cnt = 0;
+
+		uint32_t m_max_depth = ~0u;
+
+		uint64_t m_max_file_bytes = ~0ull;
+
+		bool m_include_hidden = false;
+
+		[[nodiscard]] static char to_lower_(char c) noexcept
+		{
+			return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+		}
+
+	public:
+
+		// ext_filters is a list of extensions such as ".log.txt", or nullptr to search files regardless of extension.
+		// Extensions are compared ignoring ASCII case. max_depth limits how many levels of subdirectories are descended.
+		[[nodiscard]] status create(const char* ext_filters, uint32_t max_depth = ~0u, uint64_t max_file_bytes = ~0ull, bool include_hidden = false) noexcept
+		{
+			m_ext_filter_cnt = 0;
+
+			m_max_depth = max_depth;
+
+			m_max_file_bytes = max_file_bytes;
+
+			m_include_hidden = include_hidden;
+
+			if (ext_filters == nullptr)
+				return {};
+
+			const char* curr = ext_filters;
+
+			if (*curr == '.')
+				++curr;
+
+			while (*curr != '\0')
+			{
+				if (m_ext_filter_cnt == MAX_EXTENSION_FILTER_CNT)
+					return to_status(error::argument_too_large);
+
+				uint32_t len = 0;
+
+				while (*curr != '.' && *curr != '\0')
+				{
+					if (len == MAX_EXTENSION_FILTER_CUNITS)
+						return to_status(error::argument_too_large);
+
+					m_ext_filters[m_ext_filter_cnt][len++] = to_lower_(*curr++);
+				}
+
+				m_ext_filters[m_ext_filter_cnt][len] = '\0';
+
+				if (len != 0)
+					++m_ext_filter_cnt;
+
+				if (*curr == '.')
+					++curr;
+			}
+
+			return {};
+		}
+
+		[[nodiscard]] uint32_t max_depth() const noexcept
+		{
+			return m_max_depth;
+		}
+
+		[[nodiscard]] bool include_hidden() const noexcept
+		{
+			return m_include_hidden;
+		}
+
+		[[nodiscard]] bool matches_(const utf8_string& name, uint64_t bytes, bool is_hidden) const noexcept
+		{
+			if (bytes > m_max_file_bytes || (is_hidden && !m_include_hidden))
+				return false;
+
+			if (m_ext_filter_cnt == 0)
+				return true;
+
+			const char* name_beg = name.raw_cbegin();
+
+			const char* ext = name_beg + name.get_codeunits();
+
+			while (ext != name_beg && ext[-1] != '.')
+				--ext;
+
+			if (ext == name_beg)
+				return false;
+
+			for (uint32_t i = 0; i != m_ext_filter_cnt; ++i)
+			{
+				uint32_t j = 0;
+
+				while (m_ext_filters[i][j] != '\0' && m_ext_filters[i][j] == to_lower_(ext[j]))
+					++j;
+
+				if (m_ext_filters[i][j] == '\0' && ext[j] == '\0')
+					return true;
+			}
+
+			return false;
+		}
+	};
+
+	struct content_search_pattern
+	{
+		const char* text;
+
+		// Regex patterns support ^ $ . * + ? \ and bracketed classes such as [a-z] or [^0-9], as well as \d \w and \s.
+		// Patterns never match across line boundaries.
+		bool is_regex;
+	};
+
+	struct content_search_match
+	{
+		utf8_view path;
+
+		uint64_t line_number; // One-based
+
+		range<const char> line; // Excludes the line terminator. The contents are not guaranteed to be valid UTF-8.
+
+		uint32_t pattern_index; // Index of the first pattern matching the line
+	};
+
+	// Return false to stop the search. The referenced path and line are only valid for the duration of the call.
+	using content_search_callback = bool (*)(const content_search_match& match, void* userdata) noexcept;
+
+	// Searches the contents of all files below root that pass filter for lines matching any of patterns, similar to grep -rn.
+	// Files are scanned in parallel on up to max_threads threads (0 uses one per logical processor), but calls to callback
+	// are serialized. Within each file, lines are reported once, in ascending order. Files that cannot be opened as well as
+	// files containing a '\0' in their first 4 KiB are skipped.
+	[[nodiscard]] status search_file_contents(const char* root, const content_search_filter& filter, range<const content_search_pattern> patterns, content_search_callback callback, void* userdata = nullptr, uint32_t max_threads = 0) noexcept;
+
+
+
+	struct duplicate_file
+	{
+		utf8_view path;
+
+		uint64_t bytes;
+
+		uint32_t group; // Files with the same group have identical contents. Files are sorted by group.
+	};
+
+	struct duplicate_result
+	{
+	private:
+
+		duplicate_file* m_files = nullptr;
+
+		uint32_t m_file_cnt = 0;
+
+		uint32_t m_group_cnt = 0;
+
+	public:
+
+		duplicate_result() noexcept = default;
+
+		duplicate_result(const duplicate_result&) = delete;
+
+		duplicate_result(duplicate_result&&) = delete;
+
+		[[nodiscard]] range<const duplicate_file> files() const noexcept
+		{
+			return range<const duplicate_file>(m_files, m_file_cnt);
+		}
+
+		[[nodiscard]] uint32_t group_cnt() const noexcept
+		{
+			return m_group_cnt;
+		}
+
+		void close() noexcept;
+
+		void set_(duplicate_file* files, uint32_t file_cnt, uint32_t group_cnt) noexcept
+		{
+			close();
+
+			m_files = files;
+
+			m_file_cnt = file_cnt;
+
+			m_group_cnt = group_cnt;
+		}
+
+		~duplicate_result() noexcept
+		{
+			close();
+		}
+	};
+
+	// Finds groups of files with identical contents below any of roots, ignoring files smaller than min_bytes.
+	// Files are grouped by size first, then by a hash of their first 4 KiB and finally by a hash of their full contents,
+	// so only files surviving one stage are read in the next. Reads are spread over up to max_io_threads threads
+	// (0 uses one per logical processor). Names referring to the same file, such as hard links, are only reported once.
+	// Contents are compared by 128-bit non-cryptographic hash only, so verify files byte-by-byte before deleting them
+	// if their contents may have been crafted.
+	[[nodiscard]] status find_duplicates(duplicate_result& out_result, range<const char* const> roots, uint64_t min_bytes = 1, uint32_t max_io_threads = 0) noexcept;
+
+
 
 	[[nodiscard]] iohandle get_stdout() noexcept;
 
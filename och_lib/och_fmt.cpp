@@ -1,6 +1,8 @@
 ﻿#include "och_fmt.h"
 
+#include <atomic>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <cassert>
 #include <intrin.h>
@@ -21,227 +23,204 @@ namespace och
 		return context.flags & 4;
 	}
 
+	bool is_display_width(const parsed_context& context)
+	{
+		return context.flags & 32;
+	}
+
+	// Width of v as measured by pad; terminal columns if context asks for them, codepoints otherwise
+	uint32_t h_text_width(const och::stringview& v, const parsed_context& context) noexcept
+	{
+		return is_display_width(context) ? _utf8_display_width(v.raw_cbegin(), v.get_codeunits()) : v.get_codepoints();
+	}
+
 	struct output_buffer
 	{
-		static constexpr uint64_t file_buffer_capacity = 1024;
+		const fmt_sink& sink;
 
-		och::range<char> buffer;
+		och::range<char> buffer; // Unused part of the range most recently returned by sink.reserve
 
-		union
-		{
-			och::iohandle backing_file;
-			och::utf8_string* backing_string;
-		};
+		char* window_beg = nullptr;
+
+		uint64_t committed_count = 0;
 
 		uint64_t overrun_count = 0;
 
-		output_buffer(och::range<char> buffer, void* backing_file) : buffer{ buffer }, backing_string{ reinterpret_cast<och::utf8_string*>(backing_file) } {}
-		
-		bool has_file() const noexcept
-		{
-			return buffer.beg;
-		}
+		bool is_truncated = false;
+
+		explicit output_buffer(const fmt_sink& sink) noexcept : sink{ sink }, buffer{ nullptr, nullptr } {}
 
-		char* reserve(uint32_t codeunits)
+		void commit() noexcept
 		{
-			if (buffer.beg)
-			{
-				if (buffer.len() >= codeunits)
-				{
-					char* retval = buffer.beg;
+			if (buffer.beg == window_beg)
+				return;
 
-					buffer.beg += codeunits;
+			sink.commit(sink.userdata, och::range<char>(window_beg, buffer.beg));
 
-					return retval;
-				}
-				else if (backing_file)
-				{
-					flush_to_file();
+			committed_count += buffer.beg - window_beg;
 
-					if (codeunits <= file_buffer_capacity)
-						return buffer.beg;
-				}
-				else
-				{
-					overrun_count += codeunits - buffer.len();
+			window_beg = buffer.beg;
+		}
 
-					buffer.beg = buffer.end;
-				}
-			}
-			else if (backing_string->reserve(backing_string->get_codeunits() + codeunits))
-			{
-					char* ret = backing_string->raw_end();
+		// Hands the filled part of the current window to the sink and asks it for a new one
+		bool refill(uint32_t min_cunits) noexcept
+		{
+			commit();
 
-					backing_string->fmt_prepare_for_raw_write(codeunits);
+			buffer = sink.reserve(sink.userdata, min_cunits);
 
-					return ret;
-			}
+			window_beg = buffer.beg;
 
-			return nullptr;
+			return buffer.len() >= min_cunits;
 		}
 
-		void flush_to_file()
+		// Once the sink runs out of space, everything following is only counted, so that output never has gaps
+		void truncate(uint64_t dropped_cunits) noexcept
 		{
-			uint32_t bytes_written;
+			is_truncated = true;
 
-			ignore_status(och::write_to_file(bytes_written, backing_file, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(buffer.end - file_buffer_capacity), reinterpret_cast<const uint8_t*>(buffer.beg))));
-			
-			buffer.beg = buffer.end - file_buffer_capacity;
+			overrun_count += dropped_cunits;
+
+			buffer.end = buffer.beg;
 		}
 
-		void put(utf8_char c)
+		char* reserve(uint32_t codeunits) noexcept
 		{
-			if (buffer.beg)
+			if (buffer.len() < codeunits && (is_truncated || !refill(codeunits)))
 			{
-				if (buffer.len() < c.get_codeunits())
-				{
-					if (backing_file)
-						flush_to_file();
-					else
-					{
-						overrun_count += c.get_codeunits() - buffer.len();
+				truncate(codeunits);
+
+				return nullptr;
+			}
 
-						buffer.beg = buffer.end;
+			char* ret = buffer.beg;
 
-						return;
-					}
-				}
+			buffer.beg += codeunits;
 
-				for (uint32_t i = 0; i != c.get_codeunits(); ++i)
-					*buffer.beg++ = c.cbegin()[i];
-			}
-			else
-			{
-				backing_string->operator+=(c);
-			}
+			return ret;
 		}
 
-		void put(const och::stringview& v)
+		void put(const char* data, uint32_t codeunits) noexcept
 		{
-			if (buffer.beg)
+			while (buffer.len() < codeunits)
 			{
-				if (buffer.len() < v.get_codeunits())
-				{
-					if (backing_file)
-					{
-						flush_to_file();
-
-						uint32_t bytes_written;
-						ignore_status(och::write_to_file(bytes_written, backing_file, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(v.raw_cbegin()), reinterpret_cast<const uint8_t*>(v.raw_cend()))));
-					}
-					else
-					{
-						overrun_count += v.get_codeunits() - buffer.len();
+				const uint32_t part = static_cast<uint32_t>(buffer.len());
 
-						buffer.beg = buffer.end;
-					}
-				}
-				else
-				{
-					for (uint32_t i = 0; i != v.get_codeunits(); ++i)
-						*buffer.beg++ = v.raw_cbegin()[i];
-				}
-			}
-			else
-			{
-				backing_string->operator+=(v);
-			}
-		}
+				if (part != 0)
+					memcpy(buffer.beg, data, part);
 
-		void pad(uint32_t text_codepoints, const och::parsed_context& context)
-		{
-			int32_t filler_cpoints = context.width - text_codepoints;
+				buffer.beg += part;
 
-			if (filler_cpoints < 0)
-				return;
+				data += part;
 
-			uint32_t filler_cunits = static_cast<uint32_t>(filler_cpoints) * context.filler.get_codeunits();
+				codeunits -= part;
 
-			utf8_char c = context.filler;
+				if (is_truncated || !refill(1))
+				{
+					truncate(codeunits);
 
-			if (buffer.beg)
-			{
-				if (filler_cunits > buffer.len())
-					if (backing_file)
-					{
-						uint32_t bytes_written;
-						ignore_status(och::write_to_file(bytes_written, backing_file, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(buffer.end - file_buffer_capacity), reinterpret_cast<const uint8_t*>(buffer.beg))));
+					return;
+				}
+			}
 
-						buffer.beg = buffer.end - file_buffer_capacity;
+			memcpy(buffer.beg, data, codeunits);
 
-						buffer.beg = buffer.end - file_buffer_capacity;
+			buffer.beg += codeunits;
+		}
 
-						while (filler_cunits >= file_buffer_capacity)
-						{
-							uint32_t i = 0;
+		void put(utf8_char c) noexcept
+		{
+			put(c.cbegin(), c.get_codeunits());
+		}
 
-							for (i = 0; i <= file_buffer_capacity - c.get_codeunits(); i += c.get_codeunits())
-								for (uint32_t j = 0; j != c.get_codeunits(); ++j)
-									buffer[static_cast<ptrdiff_t>(i) + j] = c.cbegin()[i];
+		void put(const och::stringview& v) noexcept
+		{
+			put(v.raw_cbegin(), v.get_codeunits());
+		}
 
-							filler_cunits -= i;
+		void pad(uint32_t text_codepoints, const och::parsed_context& context) noexcept
+		{
+			if (context.width <= text_codepoints)
+				return;
 
-							ignore_status(och::write_to_file(bytes_written, backing_file, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(buffer.beg), reinterpret_cast<const uint8_t*>(buffer.beg + i))));
+			uint32_t filler_cpoints = context.width - text_codepoints;
 
-							buffer.beg = buffer.end - file_buffer_capacity;
-						}
-					}
-					else
-					{
-						overrun_count += filler_cunits - buffer.len();
+			const utf8_char c = context.filler;
 
-						buffer.beg = buffer.end;
+			const uint32_t filler_cunits = c.get_codeunits();
 
-						return;
-					}
+			// In display-width mode text_codepoints counts columns, so a wide filler covers two of them. Any odd column left over
+			// is filled with a space.
+			if (is_display_width(context) && filler_cunits != 1 && _codepoint_display_width(c.codepoint()) == 2)
+			{
+				if (filler_cpoints & 1)
+					put(' ');
 
-				for (uint32_t i = 0; i != filler_cunits; i += c.get_codeunits())
-					for (uint32_t j = 0; j != c.get_codeunits(); ++j)
-						*buffer.beg++ = c.cbegin()[j];
+				filler_cpoints /= 2;
 			}
-			else
+
+			if (filler_cunits == 1 && buffer.len() >= filler_cpoints)
 			{
-				backing_string->reserve(backing_string->get_codeunits() + filler_cunits);
+				memset(buffer.beg, *c.cbegin(), filler_cpoints);
 
-				for (int32_t i = 0; i != filler_cpoints; ++i)
-					backing_string->operator+=(c);
+				buffer.beg += filler_cpoints;
+
+				return;
 			}
+
+			for (uint32_t i = 0; i != filler_cpoints; ++i)
+				put(c.cbegin(), filler_cunits);
 		}
 
-		void put_padded(utf8_char c, const parsed_context& context)
+		void put_padded(utf8_char c, const parsed_context& context) noexcept
 		{
+			const uint32_t text_width = is_display_width(context) ? _codepoint_display_width(c.codepoint()) : 1;
+
 			if (is_rightadj(context))
-				pad(1, context);
+				pad(text_width, context);
 
 			put(c);
 
 			if (!is_rightadj(context))
-				pad(1, context);
+				pad(text_width, context);
 		}
 
-		void put_padded(const och::stringview& v, const parsed_context& context)
+		void put_padded(const och::stringview& v, const parsed_context& context) noexcept
 		{
+			const uint32_t text_width = context.width == 0 ? 0 : h_text_width(v, context);
+
 			if (is_rightadj(context))
-				pad(v.get_codepoints(), context);
+				pad(text_width, context);
 
 			put(v);
 
 			if (!is_rightadj(context))
-				pad(v.get_codepoints(), context);
+				pad(text_width, context);
 		}
 
-		void finalize()
+		// Returns the number of cunits formatted, including those the sink had no space for
+		uint32_t finalize() noexcept
 		{
-			if (buffer.beg && backing_file && buffer.len() != file_buffer_capacity)
-				flush_to_file();
-			else if (buffer.beg)
-				put(utf8_char('\0'));
-			else
-				backing_string += '\0';
+			commit();
+
+			if (sink.flush != nullptr)
+				sink.flush(sink.userdata);
+
+			return static_cast<uint32_t>(committed_count + overrun_count);
 		}
 	};
 
-	constexpr const char* hex_lower_upper = "0123456789abcdef0123456789ABCDEF";
+	constexpr const char* two_digit_lut =
+		"00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839" "40414243444546474849"
+		"50515253545556575859" "60616263646566676869" "70717273747576777879" "80818283848586878889" "90919293949596979899";
+
+	// decimal_thresholds[i] is the smallest value with i + 1 decimal digits, except for i == 0
+	constexpr uint64_t decimal_thresholds[20]
+	{
+		0, 10, 100, 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000, 1'000'000'000, 10'000'000'000, 100'000'000'000,
+		1'000'000'000'000, 10'000'000'000'000, 100'000'000'000'000, 1'000'000'000'000'000, 10'000'000'000'000'000,
+		100'000'000'000'000'000, 1'000'000'000'000'000'000, 10'000'000'000'000'000'000u,
+	};
 
 	constexpr och::stringview invalid_specifier_msg("[[Invalid format-specifier]]");
 
@@ -250,130 +229,674 @@ namespace och
 	constexpr const char* months = "January\0\0\0"    "February\0\0"   "March\0\0\0\0\0" "April\0\0\0\0\0" "May\0\0\0\0\0\0\0" "June\0\0\0\0\0\0"
 		                           "July\0\0\0\0\0\0" "August\0\0\0\0" "September\0"     "October\0\0\0"   "November\0\0"      "December\0";
 
+	struct quantity_format
+	{
+		bool is_binary; // Units are powers of 1024 with prefixes Ki, Mi, ... instead of powers of 1000 with k, M, ...
+
+		const char* suffix;
+
+		uint32_t suffix_cunits;
+	};
+
+	// Indexed by och::quantity
+	constexpr quantity_format quantity_formats[]
+	{
+		{ true, "B", 1 }, { false, "B", 1 }, { true, "B/s", 3 }, { false, "B/s", 3 }, { false, "ops/s", 5 },
+	};
+
+	constexpr const char* binary_unit_prefixes = "KMGTPE";
+
+	constexpr const char* decimal_unit_prefixes = "kMGTPE";
+
+	constexpr uint32_t MAX_QUANTITY_UNIT = 6;
+
+	constexpr uint32_t MAX_QUANTITY_PRECISION = 3;
+
+	// Significands of 10^k for k in [POW10_MIN_EXPONENT, POW10_MAX_EXPONENT], normalized to 128 bits and rounded up, as
+	// { high, low }. Entry k is floor(10^k * 2^(127 - floor(log2(10^k)))) + 1.
+	constexpr int32_t POW10_MIN_EXPONENT = -292;
+
+	constexpr int32_t POW10_MAX_EXPONENT = 326;
+
+	constexpr uint64_t pow10_significands[POW10_MAX_EXPONENT - POW10_MIN_EXPONENT + 1][2]
+	{
+		{ 0xFF77B1FCBEBCDC4F, 0x25E8E89C13BB0F7B }, { 0x9FAACF3DF73609B1, 0x77B191618C54E9AD },
+		{ 0xC795830D75038C1D, 0xD59DF5B9EF6A2418 }, { 0xF97AE3D0D2446F25, 0x4B0573286B44AD1E },
+		{ 0x9BECCE62836AC577, 0x4EE367F9430AEC33 }, { 0xC2E801FB244576D5, 0x229C41F793CDA740 },
+		{ 0xF3A20279ED56D48A, 0x6B43527578C11110 }, { 0x9845418C345644D6, 0x830A13896B78AAAA },
+		{ 0xBE5691EF416BD60C, 0x23CC986BC656D554 }, { 0xEDEC366B11C6CB8F, 0x2CBFBE86B7EC8AA9 },
+		{ 0x94B3A202EB1C3F39, 0x7BF7D71432F3D6AA }, { 0xB9E08A83A5E34F07, 0xDAF5CCD93FB0CC54 },
+		{ 0xE858AD248F5C22C9, 0xD1B3400F8F9CFF69 }, { 0x91376C36D99995BE, 0x23100809B9C21FA2 },
+		{ 0xB58547448FFFFB2D, 0xABD40A0C2832A78B }, { 0xE2E69915B3FFF9F9, 0x16C90C8F323F516D },
+		{ 0x8DD01FAD907FFC3B, 0xAE3DA7D97F6792E4 }, { 0xB1442798F49FFB4A, 0x99CD11CFDF41779D },
+		{ 0xDD95317F31C7FA1D, 0x40405643D711D584 }, { 0x8A7D3EEF7F1CFC52, 0x482835EA666B2573 },
+		{ 0xAD1C8EAB5EE43B66, 0xDA3243650005EED0 }, { 0xD863B256369D4A40, 0x90BED43E40076A83 },
+		{ 0x873E4F75E2224E68, 0x5A7744A6E804A292 }, { 0xA90DE3535AAAE202, 0x711515D0A205CB37 },
+		{ 0xD3515C2831559A83, 0x0D5A5B44CA873E04 }, { 0x8412D9991ED58091, 0xE858790AFE9486C3 },
+		{ 0xA5178FFF668AE0B6, 0x626E974DBE39A873 }, { 0xCE5D73FF402D98E3, 0xFB0A3D212DC81290 },
+		{ 0x80FA687F881C7F8E, 0x7CE66634BC9D0B9A }, { 0xA139029F6A239F72, 0x1C1FFFC1EBC44E81 },
+		{ 0xC987434744AC874E, 0xA327FFB266B56221 }, { 0xFBE9141915D7A922, 0x4BF1FF9F0062BAA9 },
+		{ 0x9D71AC8FADA6C9B5, 0x6F773FC3603DB4AA }, { 0xC4CE17B399107C22, 0xCB550FB4384D21D4 },
+		{ 0xF6019DA07F549B2B, 0x7E2A53A146606A49 }, { 0x99C102844F94E0FB, 0x2EDA7444CBFC426E },
+		{ 0xC0314325637A1939, 0xFA911155FEFB5309 }, { 0xF03D93EEBC589F88, 0x793555AB7EBA27CB },
+		{ 0x96267C7535B763B5, 0x4BC1558B2F3458DF }, { 0xBBB01B9283253CA2, 0x9EB1AAEDFB016F17 },
+		{ 0xEA9C227723EE8BCB, 0x465E15A979C1CADD }, { 0x92A1958A7675175F, 0x0BFACD89EC191ECA },
+		{ 0xB749FAED14125D36, 0xCEF980EC671F667C }, { 0xE51C79A85916F484, 0x82B7E12780E7401B },
+		{ 0x8F31CC0937AE58D2, 0xD1B2ECB8B0908811 }, { 0xB2FE3F0B8599EF07, 0x861FA7E6DCB4AA16 },
+		{ 0xDFBDCECE67006AC9, 0x67A791E093E1D49B }, { 0x8BD6A141006042BD, 0xE0C8BB2C5C6D24E1 },
+		{ 0xAECC49914078536D, 0x58FAE9F773886E19 }, { 0xDA7F5BF590966848, 0xAF39A475506A899F },
+		{ 0x888F99797A5E012D, 0x6D8406C952429604 }, { 0xAAB37FD7D8F58178, 0xC8E5087BA6D33B84 },
+		{ 0xD5605FCDCF32E1D6, 0xFB1E4A9A90880A65 }, { 0x855C3BE0A17FCD26, 0x5CF2EEA09A550680 },
+		{ 0xA6B34AD8C9DFC06F, 0xF42FAA48C0EA481F }, { 0xD0601D8EFC57B08B, 0xF13B94DAF124DA27 },
+		{ 0x823C12795DB6CE57, 0x76C53D08D6B70859 }, { 0xA2CB1717B52481ED, 0x54768C4B0C64CA6F },
+		{ 0xCB7DDCDDA26DA268, 0xA9942F5DCF7DFD0A }, { 0xFE5D54150B090B02, 0xD3F93B35435D7C4D },
+		{ 0x9EFA548D26E5A6E1, 0xC47BC5014A1A6DB0 }, { 0xC6B8E9B0709F109A, 0x359AB6419CA1091C },
+		{ 0xF867241C8CC6D4C0, 0xC30163D203C94B63 }, { 0x9B407691D7FC44F8, 0x79E0DE63425DCF1E },
+		{ 0xC21094364DFB5636, 0x985915FC12F542E5 }, { 0xF294B943E17A2BC4, 0x3E6F5B7B17B2939E },
+		{ 0x979CF3CA6CEC5B5A, 0xA705992CEECF9C43 }, { 0xBD8430BD08277231, 0x50C6FF782A838354 },
+		{ 0xECE53CEC4A314EBD, 0xA4F8BF5635246429 }, { 0x940F4613AE5ED136, 0x871B7795E136BE9A },
+		{ 0xB913179899F68584, 0x28E2557B59846E40 }, { 0xE757DD7EC07426E5, 0x331AEADA2FE589D0 },
+		{ 0x9096EA6F3848984F, 0x3FF0D2C85DEF7622 }, { 0xB4BCA50B065ABE63, 0x0FED077A756B53AA },
+		{ 0xE1EBCE4DC7F16DFB, 0xD3E8495912C62895 }, { 0x8D3360F09CF6E4BD, 0x64712DD7ABBBD95D },
+		{ 0xB080392CC4349DEC, 0xBD8D794D96AACFB4 }, { 0xDCA04777F541C567, 0xECF0D7A0FC5583A1 },
+		{ 0x89E42CAAF9491B60, 0xF41686C49DB57245 }, { 0xAC5D37D5B79B6239, 0x311C2875C522CED6 },
+		{ 0xD77485CB25823AC7, 0x7D633293366B828C }, { 0x86A8D39EF77164BC, 0xAE5DFF9C02033198 },
+		{ 0xA8530886B54DBDEB, 0xD9F57F830283FDFD }, { 0xD267CAA862A12D66, 0xD072DF63C324FD7C },
+		{ 0x8380DEA93DA4BC60, 0x4247CB9E59F71E6E }, { 0xA46116538D0DEB78, 0x52D9BE85F074E609 },
+		{ 0xCD795BE870516656, 0x67902E276C921F8C }, { 0x806BD9714632DFF6, 0x00BA1CD8A3DB53B7 },
+		{ 0xA086CFCD97BF97F3, 0x80E8A40ECCD228A5 }, { 0xC8A883C0FDAF7DF0, 0x6122CD128006B2CE },
+		{ 0xFAD2A4B13D1B5D6C, 0x796B805720085F82 }, { 0x9CC3A6EEC6311A63, 0xCBE3303674053BB1 },
+		{ 0xC3F490AA77BD60FC, 0xBEDBFC4411068A9D }, { 0xF4F1B4D515ACB93B, 0xEE92FB5515482D45 },
+		{ 0x991711052D8BF3C5, 0x751BDD152D4D1C4B }, { 0xBF5CD54678EEF0B6, 0xD262D45A78A0635E },
+		{ 0xEF340A98172AACE4, 0x86FB897116C87C35 }, { 0x9580869F0E7AAC0E, 0xD45D35E6AE3D4DA1 },
+		{ 0xBAE0A846D2195712, 0x8974836059CCA10A }, { 0xE998D258869FACD7, 0x2BD1A438703FC94C },
+		{ 0x91FF83775423CC06, 0x7B6306A34627DDD0 }, { 0xB67F6455292CBF08, 0x1A3BC84C17B1D543 },
+		{ 0xE41F3D6A7377EECA, 0x20CABA5F1D9E4A94 }, { 0x8E938662882AF53E, 0x547EB47B7282EE9D },
+		{ 0xB23867FB2A35B28D, 0xE99E619A4F23AA44 }, { 0xDEC681F9F4C31F31, 0x6405FA00E2EC94D5 },
+		{ 0x8B3C113C38F9F37E, 0xDE83BC408DD3DD05 }, { 0xAE0B158B4738705E, 0x9624AB50B148D446 },
+		{ 0xD98DDAEE19068C76, 0x3BADD624DD9B0958 }, { 0x87F8A8D4CFA417C9, 0xE54CA5D70A80E5D7 },
+		{ 0xA9F6D30A038D1DBC, 0x5E9FCF4CCD211F4D }, { 0xD47487CC8470652B, 0x7647C32000696720 },
+		{ 0x84C8D4DFD2C63F3B, 0x29ECD9F40041E074 }, { 0xA5FB0A17C777CF09, 0xF468107100525891 },
+		{ 0xCF79CC9DB955C2CC, 0x7182148D4066EEB5 }, { 0x81AC1FE293D599BF, 0xC6F14CD848405531 },
+		{ 0xA21727DB38CB002F, 0xB8ADA00E5A506A7D }, { 0xCA9CF1D206FDC03B, 0xA6D90811F0E4851D },
+		{ 0xFD442E4688BD304A, 0x908F4A166D1DA664 }, { 0x9E4A9CEC15763E2E, 0x9A598E4E043287FF },
+		{ 0xC5DD44271AD3CDBA, 0x40EFF1E1853F29FE }, { 0xF7549530E188C128, 0xD12BEE59E68EF47D },
+		{ 0x9A94DD3E8CF578B9, 0x82BB74F8301958CF }, { 0xC13A148E3032D6E7, 0xE36A52363C1FAF02 },
+		{ 0xF18899B1BC3F8CA1, 0xDC44E6C3CB279AC2 }, { 0x96F5600F15A7B7E5, 0x29AB103A5EF8C0BA },
+		{ 0xBCB2B812DB11A5DE, 0x7415D448F6B6F0E8 }, { 0xEBDF661791D60F56, 0x111B495B3464AD22 },
+		{ 0x936B9FCEBB25C995, 0xCAB10DD900BEEC35 }, { 0xB84687C269EF3BFB, 0x3D5D514F40EEA743 },
+		{ 0xE65829B3046B0AFA, 0x0CB4A5A3112A5113 }, { 0x8FF71A0FE2C2E6DC, 0x47F0E785EABA72AC },
+		{ 0xB3F4E093DB73A093, 0x59ED216765690F57 }, { 0xE0F218B8D25088B8, 0x306869C13EC3532D },
+		{ 0x8C974F7383725573, 0x1E414218C73A13FC }, { 0xAFBD2350644EEACF, 0xE5D1929EF90898FB },
+		{ 0xDBAC6C247D62A583, 0xDF45F746B74ABF3A }, { 0x894BC396CE5DA772, 0x6B8BBA8C328EB784 },
+		{ 0xAB9EB47C81F5114F, 0x066EA92F3F326565 }, { 0xD686619BA27255A2, 0xC80A537B0EFEFEBE },
+		{ 0x8613FD0145877585, 0xBD06742CE95F5F37 }, { 0xA798FC4196E952E7, 0x2C48113823B73705 },
+		{ 0xD17F3B51FCA3A7A0, 0xF75A15862CA504C6 }, { 0x82EF85133DE648C4, 0x9A984D73DBE722FC },
+		{ 0xA3AB66580D5FDAF5, 0xC13E60D0D2E0EBBB }, { 0xCC963FEE10B7D1B3, 0x318DF905079926A9 },
+		{ 0xFFBBCFE994E5C61F, 0xFDF17746497F7053 }, { 0x9FD561F1FD0F9BD3, 0xFEB6EA8BEDEFA634 },
+		{ 0xC7CABA6E7C5382C8, 0xFE64A52EE96B8FC1 }, { 0xF9BD690A1B68637B, 0x3DFDCE7AA3C673B1 },
+		{ 0x9C1661A651213E2D, 0x06BEA10CA65C084F }, { 0xC31BFA0FE5698DB8, 0x486E494FCFF30A63 },
+		{ 0xF3E2F893DEC3F126, 0x5A89DBA3C3EFCCFB }, { 0x986DDB5C6B3A76B7, 0xF89629465A75E01D },
+		{ 0xBE89523386091465, 0xF6BBB397F1135824 }, { 0xEE2BA6C0678B597F, 0x746AA07DED582E2D },
+		{ 0x94DB483840B717EF, 0xA8C2A44EB4571CDD }, { 0xBA121A4650E4DDEB, 0x92F34D62616CE414 },
+		{ 0xE896A0D7E51E1566, 0x77B020BAF9C81D18 }, { 0x915E2486EF32CD60, 0x0ACE1474DC1D122F },
+		{ 0xB5B5ADA8AAFF80B8, 0x0D819992132456BB }, { 0xE3231912D5BF60E6, 0x10E1FFF697ED6C6A },
+		{ 0x8DF5EFABC5979C8F, 0xCA8D3FFA1EF463C2 }, { 0xB1736B96B6FD83B3, 0xBD308FF8A6B17CB3 },
+		{ 0xDDD0467C64BCE4A0, 0xAC7CB3F6D05DDBDF }, { 0x8AA22C0DBEF60EE4, 0x6BCDF07A423AA96C },
+		{ 0xAD4AB7112EB3929D, 0x86C16C98D2C953C7 }, { 0xD89D64D57A607744, 0xE871C7BF077BA8B8 },
+		{ 0x87625F056C7C4A8B, 0x11471CD764AD4973 }, { 0xA93AF6C6C79B5D2D, 0xD598E40D3DD89BD0 },
+		{ 0xD389B47879823479, 0x4AFF1D108D4EC2C4 }, { 0x843610CB4BF160CB, 0xCEDF722A585139BB },
+		{ 0xA54394FE1EEDB8FE, 0xC2974EB4EE658829 }, { 0xCE947A3DA6A9273E, 0x733D226229FEEA33 },
+		{ 0x811CCC668829B887, 0x0806357D5A3F5260 }, { 0xA163FF802A3426A8, 0xCA07C2DCB0CF26F8 },
+		{ 0xC9BCFF6034C13052, 0xFC89B393DD02F0B6 }, { 0xFC2C3F3841F17C67, 0xBBAC2078D443ACE3 },
+		{ 0x9D9BA7832936EDC0, 0xD54B944B84AA4C0E }, { 0xC5029163F384A931, 0x0A9E795E65D4DF12 },
+		{ 0xF64335BCF065D37D, 0x4D4617B5FF4A16D6 }, { 0x99EA0196163FA42E, 0x504BCED1BF8E4E46 },
+		{ 0xC06481FB9BCF8D39, 0xE45EC2862F71E1D7 }, { 0xF07DA27A82C37088, 0x5D767327BB4E5A4D },
+		{ 0x964E858C91BA2655, 0x3A6A07F8D510F870 }, { 0xBBE226EFB628AFEA, 0x890489F70A55368C },
+		{ 0xEADAB0ABA3B2DBE5, 0x2B45AC74CCEA842F }, { 0x92C8AE6B464FC96F, 0x3B0B8BC90012929E },
+		{ 0xB77ADA0617E3BBCB, 0x09CE6EBB40173745 }, { 0xE55990879DDCAABD, 0xCC420A6A101D0516 },
+		{ 0x8F57FA54C2A9EAB6, 0x9FA946824A12232E }, { 0xB32DF8E9F3546564, 0x47939822DC96ABFA },
+		{ 0xDFF9772470297EBD, 0x59787E2B93BC56F8 }, { 0x8BFBEA76C619EF36, 0x57EB4EDB3C55B65B },
+		{ 0xAEFAE51477A06B03, 0xEDE622920B6B23F2 }, { 0xDAB99E59958885C4, 0xE95FAB368E45ECEE },
+		{ 0x88B402F7FD75539B, 0x11DBCB0218EBB415 }, { 0xAAE103B5FCD2A881, 0xD652BDC29F26A11A },
+		{ 0xD59944A37C0752A2, 0x4BE76D3346F04960 }, { 0x857FCAE62D8493A5, 0x6F70A4400C562DDC },
+		{ 0xA6DFBD9FB8E5B88E, 0xCB4CCD500F6BB953 }, { 0xD097AD07A71F26B2, 0x7E2000A41346A7A8 },
+		{ 0x825ECC24C873782F, 0x8ED400668C0C28C9 }, { 0xA2F67F2DFA90563B, 0x728900802F0F32FB },
+		{ 0xCBB41EF979346BCA, 0x4F2B40A03AD2FFBA }, { 0xFEA126B7D78186BC, 0xE2F610C84987BFA9 },
+		{ 0x9F24B832E6B0F436, 0x0DD9CA7D2DF4D7CA }, { 0xC6EDE63FA05D3143, 0x91503D1C79720DBC },
+		{ 0xF8A95FCF88747D94, 0x75A44C6397CE912B }, { 0x9B69DBE1B548CE7C, 0xC986AFBE3EE11ABB },
+		{ 0xC24452DA229B021B, 0xFBE85BADCE996169 }, { 0xF2D56790AB41C2A2, 0xFAE27299423FB9C4 },
+		{ 0x97C560BA6B0919A5, 0xDCCD879FC967D41B }, { 0xBDB6B8E905CB600F, 0x5400E987BBC1C921 },
+		{ 0xED246723473E3813, 0x290123E9AAB23B69 }, { 0x9436C0760C86E30B, 0xF9A0B6720AAF6522 },
+		{ 0xB94470938FA89BCE, 0xF808E40E8D5B3E6A }, { 0xE7958CB87392C2C2, 0xB60B1D1230B20E05 },
+		{ 0x90BD77F3483BB9B9, 0xB1C6F22B5E6F48C3 }, { 0xB4ECD5F01A4AA828, 0x1E38AEB6360B1AF4 },
+		{ 0xE2280B6C20DD5232, 0x25C6DA63C38DE1B1 }, { 0x8D590723948A535F, 0x579C487E5A38AD0F },
+		{ 0xB0AF48EC79ACE837, 0x2D835A9DF0C6D852 }, { 0xDCDB1B2798182244, 0xF8E431456CF88E66 },
+		{ 0x8A08F0F8BF0F156B, 0x1B8E9ECB641B5900 }, { 0xAC8B2D36EED2DAC5, 0xE272467E3D222F40 },
+		{ 0xD7ADF884AA879177, 0x5B0ED81DCC6ABB10 }, { 0x86CCBB52EA94BAEA, 0x98E947129FC2B4EA },
+		{ 0xA87FEA27A539E9A5, 0x3F2398D747B36225 }, { 0xD29FE4B18E88640E, 0x8EEC7F0D19A03AAE },
+		{ 0x83A3EEEEF9153E89, 0x1953CF68300424AD }, { 0xA48CEAAAB75A8E2B, 0x5FA8C3423C052DD8 },
+		{ 0xCDB02555653131B6, 0x3792F412CB06794E }, { 0x808E17555F3EBF11, 0xE2BBD88BBEE40BD1 },
+		{ 0xA0B19D2AB70E6ED6, 0x5B6ACEAEAE9D0EC5 }, { 0xC8DE047564D20A8B, 0xF245825A5A445276 },
+		{ 0xFB158592BE068D2E, 0xEED6E2F0F0D56713 }, { 0x9CED737BB6C4183D, 0x55464DD69685606C },
+		{ 0xC428D05AA4751E4C, 0xAA97E14C3C26B887 }, { 0xF53304714D9265DF, 0xD53DD99F4B3066A9 },
+		{ 0x993FE2C6D07B7FAB, 0xE546A8038EFE402A }, { 0xBF8FDB78849A5F96, 0xDE98520472BDD034 },
+		{ 0xEF73D256A5C0F77C, 0x963E66858F6D4441 }, { 0x95A8637627989AAD, 0xDDE7001379A44AA9 },
+		{ 0xBB127C53B17EC159, 0x5560C018580D5D53 }, { 0xE9D71B689DDE71AF, 0xAAB8F01E6E10B4A7 },
+		{ 0x9226712162AB070D, 0xCAB3961304CA70E9 }, { 0xB6B00D69BB55C8D1, 0x3D607B97C5FD0D23 },
+		{ 0xE45C10C42A2B3B05, 0x8CB89A7DB77C506B }, { 0x8EB98A7A9A5B04E3, 0x77F3608E92ADB243 },
+		{ 0xB267ED1940F1C61C, 0x55F038B237591ED4 }, { 0xDF01E85F912E37A3, 0x6B6C46DEC52F6689 },
+		{ 0x8B61313BBABCE2C6, 0x2323AC4B3B3DA016 }, { 0xAE397D8AA96C1B77, 0xABEC975E0A0D081B },
+		{ 0xD9C7DCED53C72255, 0x96E7BD358C904A22 }, { 0x881CEA14545C7575, 0x7E50D64177DA2E55 },
+		{ 0xAA242499697392D2, 0xDDE50BD1D5D0B9EA }, { 0xD4AD2DBFC3D07787, 0x955E4EC64B44E865 },
+		{ 0x84EC3C97DA624AB4, 0xBD5AF13BEF0B113F }, { 0xA6274BBDD0FADD61, 0xECB1AD8AEACDD58F },
+		{ 0xCFB11EAD453994BA, 0x67DE18EDA5814AF3 }, { 0x81CEB32C4B43FCF4, 0x80EACF948770CED8 },
+		{ 0xA2425FF75E14FC31, 0xA1258379A94D028E }, { 0xCAD2F7F5359A3B3E, 0x096EE45813A04331 },
+		{ 0xFD87B5F28300CA0D, 0x8BCA9D6E188853FD }, { 0x9E74D1B791E07E48, 0x775EA264CF55347E },
+		{ 0xC612062576589DDA, 0x95364AFE032A819E }, { 0xF79687AED3EEC551, 0x3A83DDBD83F52205 },
+		{ 0x9ABE14CD44753B52, 0xC4926A9672793543 }, { 0xC16D9A0095928A27, 0x75B7053C0F178294 },
+		{ 0xF1C90080BAF72CB1, 0x5324C68B12DD6339 }, { 0x971DA05074DA7BEE, 0xD3F6FC16EBCA5E04 },
+		{ 0xBCE5086492111AEA, 0x88F4BB1CA6BCF585 }, { 0xEC1E4A7DB69561A5, 0x2B31E9E3D06C32E6 },
+		{ 0x9392EE8E921D5D07, 0x3AFF322E62439FD0 }, { 0xB877AA3236A4B449, 0x09BEFEB9FAD487C3 },
+		{ 0xE69594BEC44DE15B, 0x4C2EBE687989A9B4 }, { 0x901D7CF73AB0ACD9, 0x0F9D37014BF60A11 },
+		{ 0xB424DC35095CD80F, 0x538484C19EF38C95 }, { 0xE12E13424BB40E13, 0x2865A5F206B06FBA },
+		{ 0x8CBCCC096F5088CB, 0xF93F87B7442E45D4 }, { 0xAFEBFF0BCB24AAFE, 0xF78F69A51539D749 },
+		{ 0xDBE6FECEBDEDD5BE, 0xB573440E5A884D1C }, { 0x89705F4136B4A597, 0x31680A88F8953031 },
+		{ 0xABCC77118461CEFC, 0xFDC20D2B36BA7C3E }, { 0xD6BF94D5E57A42BC, 0x3D32907604691B4D },
+		{ 0x8637BD05AF6C69B5, 0xA63F9A49C2C1B110 }, { 0xA7C5AC471B478423, 0x0FCF80DC33721D54 },
+		{ 0xD1B71758E219652B, 0xD3C36113404EA4A9 }, { 0x83126E978D4FDF3B, 0x645A1CAC083126EA },
+		{ 0xA3D70A3D70A3D70A, 0x3D70A3D70A3D70A4 }, { 0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCD },
+		{ 0x8000000000000000, 0x0000000000000001 }, { 0xA000000000000000, 0x0000000000000001 },
+		{ 0xC800000000000000, 0x0000000000000001 }, { 0xFA00000000000000, 0x0000000000000001 },
+		{ 0x9C40000000000000, 0x0000000000000001 }, { 0xC350000000000000, 0x0000000000000001 },
+		{ 0xF424000000000000, 0x0000000000000001 }, { 0x9896800000000000, 0x0000000000000001 },
+		{ 0xBEBC200000000000, 0x0000000000000001 }, { 0xEE6B280000000000, 0x0000000000000001 },
+		{ 0x9502F90000000000, 0x0000000000000001 }, { 0xBA43B74000000000, 0x0000000000000001 },
+		{ 0xE8D4A51000000000, 0x0000000000000001 }, { 0x9184E72A00000000, 0x0000000000000001 },
+		{ 0xB5E620F480000000, 0x0000000000000001 }, { 0xE35FA931A0000000, 0x0000000000000001 },
+		{ 0x8E1BC9BF04000000, 0x0000000000000001 }, { 0xB1A2BC2EC5000000, 0x0000000000000001 },
+		{ 0xDE0B6B3A76400000, 0x0000000000000001 }, { 0x8AC7230489E80000, 0x0000000000000001 },
+		{ 0xAD78EBC5AC620000, 0x0000000000000001 }, { 0xD8D726B7177A8000, 0x0000000000000001 },
+		{ 0x878678326EAC9000, 0x0000000000000001 }, { 0xA968163F0A57B400, 0x0000000000000001 },
+		{ 0xD3C21BCECCEDA100, 0x0000000000000001 }, { 0x84595161401484A0, 0x0000000000000001 },
+		{ 0xA56FA5B99019A5C8, 0x0000000000000001 }, { 0xCECB8F27F4200F3A, 0x0000000000000001 },
+		{ 0x813F3978F8940984, 0x4000000000000001 }, { 0xA18F07D736B90BE5, 0x5000000000000001 },
+		{ 0xC9F2C9CD04674EDE, 0xA400000000000001 }, { 0xFC6F7C4045812296, 0x4D00000000000001 },
+		{ 0x9DC5ADA82B70B59D, 0xF020000000000001 }, { 0xC5371912364CE305, 0x6C28000000000001 },
+		{ 0xF684DF56C3E01BC6, 0xC732000000000001 }, { 0x9A130B963A6C115C, 0x3C7F400000000001 },
+		{ 0xC097CE7BC90715B3, 0x4B9F100000000001 }, { 0xF0BDC21ABB48DB20, 0x1E86D40000000001 },
+		{ 0x96769950B50D88F4, 0x1314448000000001 }, { 0xBC143FA4E250EB31, 0x17D955A000000001 },
+		{ 0xEB194F8E1AE525FD, 0x5DCFAB0800000001 }, { 0x92EFD1B8D0CF37BE, 0x5AA1CAE500000001 },
+		{ 0xB7ABC627050305AD, 0xF14A3D9E40000001 }, { 0xE596B7B0C643C719, 0x6D9CCD05D0000001 },
+		{ 0x8F7E32CE7BEA5C6F, 0xE4820023A2000001 }, { 0xB35DBF821AE4F38B, 0xDDA2802C8A800001 },
+		{ 0xE0352F62A19E306E, 0xD50B2037AD200001 }, { 0x8C213D9DA502DE45, 0x4526F422CC340001 },
+		{ 0xAF298D050E4395D6, 0x9670B12B7F410001 }, { 0xDAF3F04651D47B4C, 0x3C0CDD765F114001 },
+		{ 0x88D8762BF324CD0F, 0xA5880A69FB6AC801 }, { 0xAB0E93B6EFEE0053, 0x8EEA0D047A457A01 },
+		{ 0xD5D238A4ABE98068, 0x72A4904598D6D881 }, { 0x85A36366EB71F041, 0x47A6DA2B7F864751 },
+		{ 0xA70C3C40A64E6C51, 0x999090B65F67D925 }, { 0xD0CF4B50CFE20765, 0xFFF4B4E3F741CF6E },
+		{ 0x82818F1281ED449F, 0xBFF8F10E7A8921A5 }, { 0xA321F2D7226895C7, 0xAFF72D52192B6A0E },
+		{ 0xCBEA6F8CEB02BB39, 0x9BF4F8A69F764491 }, { 0xFEE50B7025C36A08, 0x02F236D04753D5B5 },
+		{ 0x9F4F2726179A2245, 0x01D762422C946591 }, { 0xC722F0EF9D80AAD6, 0x424D3AD2B7B97EF6 },
+		{ 0xF8EBAD2B84E0D58B, 0xD2E0898765A7DEB3 }, { 0x9B934C3B330C8577, 0x63CC55F49F88EB30 },
+		{ 0xC2781F49FFCFA6D5, 0x3CBF6B71C76B25FC }, { 0xF316271C7FC3908A, 0x8BEF464E3945EF7B },
+		{ 0x97EDD871CFDA3A56, 0x97758BF0E3CBB5AD }, { 0xBDE94E8E43D0C8EC, 0x3D52EEED1CBEA318 },
+		{ 0xED63A231D4C4FB27, 0x4CA7AAA863EE4BDE }, { 0x945E455F24FB1CF8, 0x8FE8CAA93E74EF6B },
+		{ 0xB975D6B6EE39E436, 0xB3E2FD538E122B45 }, { 0xE7D34C64A9C85D44, 0x60DBBCA87196B617 },
+		{ 0x90E40FBEEA1D3A4A, 0xBC8955E946FE31CE }, { 0xB51D13AEA4A488DD, 0x6BABAB6398BDBE42 },
+		{ 0xE264589A4DCDAB14, 0xC696963C7EED2DD2 }, { 0x8D7EB76070A08AEC, 0xFC1E1DE5CF543CA3 },
+		{ 0xB0DE65388CC8ADA8, 0x3B25A55F43294BCC }, { 0xDD15FE86AFFAD912, 0x49EF0EB713F39EBF },
+		{ 0x8A2DBF142DFCC7AB, 0x6E3569326C784338 }, { 0xACB92ED9397BF996, 0x49C2C37F07965405 },
+		{ 0xD7E77A8F87DAF7FB, 0xDC33745EC97BE907 }, { 0x86F0AC99B4E8DAFD, 0x69A028BB3DED71A4 },
+		{ 0xA8ACD7C0222311BC, 0xC40832EA0D68CE0D }, { 0xD2D80DB02AABD62B, 0xF50A3FA490C30191 },
+		{ 0x83C7088E1AAB65DB, 0x792667C6DA79E0FB }, { 0xA4B8CAB1A1563F52, 0x577001B891185939 },
+		{ 0xCDE6FD5E09ABCF26, 0xED4C0226B55E6F87 }, { 0x80B05E5AC60B6178, 0x544F8158315B05B5 },
+		{ 0xA0DC75F1778E39D6, 0x696361AE3DB1C722 }, { 0xC913936DD571C84C, 0x03BC3A19CD1E38EA },
+		{ 0xFB5878494ACE3A5F, 0x04AB48A04065C724 }, { 0x9D174B2DCEC0E47B, 0x62EB0D64283F9C77 },
+		{ 0xC45D1DF942711D9A, 0x3BA5D0BD324F8395 }, { 0xF5746577930D6500, 0xCA8F44EC7EE3647A },
+		{ 0x9968BF6ABBE85F20, 0x7E998B13CF4E1ECC }, { 0xBFC2EF456AE276E8, 0x9E3FEDD8C321A67F },
+		{ 0xEFB3AB16C59B14A2, 0xC5CFE94EF3EA101F }, { 0x95D04AEE3B80ECE5, 0xBBA1F1D158724A13 },
+		{ 0xBB445DA9CA61281F, 0x2A8A6E45AE8EDC98 }, { 0xEA1575143CF97226, 0xF52D09D71A3293BE },
+		{ 0x924D692CA61BE758, 0x593C2626705F9C57 }, { 0xB6E0C377CFA2E12E, 0x6F8B2FB00C77836D },
+		{ 0xE498F455C38B997A, 0x0B6DFB9C0F956448 }, { 0x8EDF98B59A373FEC, 0x4724BD4189BD5EAD },
+		{ 0xB2977EE300C50FE7, 0x58EDEC91EC2CB658 }, { 0xDF3D5E9BC0F653E1, 0x2F2967B66737E3EE },
+		{ 0x8B865B215899F46C, 0xBD79E0D20082EE75 }, { 0xAE67F1E9AEC07187, 0xECD8590680A3AA12 },
+		{ 0xDA01EE641A708DE9, 0xE80E6F4820CC9496 }, { 0x884134FE908658B2, 0x3109058D147FDCDE },
+		{ 0xAA51823E34A7EEDE, 0xBD4B46F0599FD416 }, { 0xD4E5E2CDC1D1EA96, 0x6C9E18AC7007C91B },
+		{ 0x850FADC09923329E, 0x03E2CF6BC604DDB1 }, { 0xA6539930BF6BFF45, 0x84DB8346B786151D },
+		{ 0xCFE87F7CEF46FF16, 0xE612641865679A64 }, { 0x81F14FAE158C5F6E, 0x4FCB7E8F3F60C07F },
+		{ 0xA26DA3999AEF7749, 0xE3BE5E330F38F09E }, { 0xCB090C8001AB551C, 0x5CADF5BFD3072CC6 },
+		{ 0xFDCB4FA002162A63, 0x73D9732FC7C8F7F7 }, { 0x9E9F11C4014DDA7E, 0x2867E7FDDCDD9AFB },
+		{ 0xC646D63501A1511D, 0xB281E1FD541501B9 }, { 0xF7D88BC24209A565, 0x1F225A7CA91A4227 },
+		{ 0x9AE757596946075F, 0x3375788DE9B06959 }, { 0xC1A12D2FC3978937, 0x0052D6B1641C83AF },
+		{ 0xF209787BB47D6B84, 0xC0678C5DBD23A49B }, { 0x9745EB4D50CE6332, 0xF840B7BA963646E1 },
+		{ 0xBD176620A501FBFF, 0xB650E5A93BC3D899 }, { 0xEC5D3FA8CE427AFF, 0xA3E51F138AB4CEBF },
+		{ 0x93BA47C980E98CDF, 0xC66F336C36B10138 }, { 0xB8A8D9BBE123F017, 0xB80B0047445D4185 },
+		{ 0xE6D3102AD96CEC1D, 0xA60DC059157491E6 }, { 0x9043EA1AC7E41392, 0x87C89837AD68DB30 },
+		{ 0xB454E4A179DD1877, 0x29BABE4598C311FC }, { 0xE16A1DC9D8545E94, 0xF4296DD6FEF3D67B },
+		{ 0x8CE2529E2734BB1D, 0x1899E4A65F58660D }, { 0xB01AE745B101E9E4, 0x5EC05DCFF72E7F90 },
+		{ 0xDC21A1171D42645D, 0x76707543F4FA1F74 }, { 0x899504AE72497EBA, 0x6A06494A791C53A9 },
+		{ 0xABFA45DA0EDBDE69, 0x0487DB9D17636893 }, { 0xD6F8D7509292D603, 0x45A9D2845D3C42B7 },
+		{ 0x865B86925B9BC5C2, 0x0B8A2392BA45A9B3 }, { 0xA7F26836F282B732, 0x8E6CAC7768D7141F },
+		{ 0xD1EF0244AF2364FF, 0x3207D795430CD927 }, { 0x8335616AED761F1F, 0x7F44E6BD49E807B9 },
+		{ 0xA402B9C5A8D3A6E7, 0x5F16206C9C6209A7 }, { 0xCD036837130890A1, 0x36DBA887C37A8C10 },
+		{ 0x802221226BE55A64, 0xC2494954DA2C978A }, { 0xA02AA96B06DEB0FD, 0xF2DB9BAA10B7BD6D },
+		{ 0xC83553C5C8965D3D, 0x6F92829494E5ACC8 }, { 0xFA42A8B73ABBF48C, 0xCB772339BA1F17FA },
+		{ 0x9C69A97284B578D7, 0xFF2A760414536EFC }, { 0xC38413CF25E2D70D, 0xFEF5138519684ABB },
+		{ 0xF46518C2EF5B8CD1, 0x7EB258665FC25D6A }, { 0x98BF2F79D5993802, 0xEF2F773FFBD97A62 },
+		{ 0xBEEEFB584AFF8603, 0xAAFB550FFACFD8FB }, { 0xEEAABA2E5DBF6784, 0x95BA2A53F983CF39 },
+		{ 0x952AB45CFA97A0B2, 0xDD945A747BF26184 }, { 0xBA756174393D88DF, 0x94F971119AEEF9E5 },
+		{ 0xE912B9D1478CEB17, 0x7A37CD5601AAB85E }, { 0x91ABB422CCB812EE, 0xAC62E055C10AB33B },
+		{ 0xB616A12B7FE617AA, 0x577B986B314D600A }, { 0xE39C49765FDF9D94, 0xED5A7E85FDA0B80C },
+		{ 0x8E41ADE9FBEBC27D, 0x14588F13BE847308 }, { 0xB1D219647AE6B31C, 0x596EB2D8AE258FC9 },
+		{ 0xDE469FBD99A05FE3, 0x6FCA5F8ED9AEF3BC }, { 0x8AEC23D680043BEE, 0x25DE7BB9480D5855 },
+		{ 0xADA72CCC20054AE9, 0xAF561AA79A10AE6B }, { 0xD910F7FF28069DA4, 0x1B2BA1518094DA05 },
+		{ 0x87AA9AFF79042286, 0x90FB44D2F05D0843 }, { 0xA99541BF57452B28, 0x353A1607AC744A54 },
+		{ 0xD3FA922F2D1675F2, 0x42889B8997915CE9 }, { 0x847C9B5D7C2E09B7, 0x69956135FEBADA12 },
+		{ 0xA59BC234DB398C25, 0x43FAB9837E699096 }, { 0xCF02B2C21207EF2E, 0x94F967E45E03F4BC },
+		{ 0x8161AFB94B44F57D, 0x1D1BE0EEBAC278F6 }, { 0xA1BA1BA79E1632DC, 0x6462D92A69731733 },
+		{ 0xCA28A291859BBF93, 0x7D7B8F7503CFDCFF }, { 0xFCB2CB35E702AF78, 0x5CDA735244C3D43F },
+		{ 0x9DEFBF01B061ADAB, 0x3A0888136AFA64A8 }, { 0xC56BAEC21C7A1916, 0x088AAA1845B8FDD1 },
+		{ 0xF6C69A72A3989F5B, 0x8AAD549E57273D46 }, { 0x9A3C2087A63F6399, 0x36AC54E2F678864C },
+		{ 0xC0CB28A98FCF3C7F, 0x84576A1BB416A7DE }, { 0xF0FDF2D3F3C30B9F, 0x656D44A2A11C51D6 },
+		{ 0x969EB7C47859E743, 0x9F644AE5A4B1B326 }, { 0xBC4665B596706114, 0x873D5D9F0DDE1FEF },
+		{ 0xEB57FF22FC0C7959, 0xA90CB506D155A7EB }, { 0x9316FF75DD87CBD8, 0x09A7F12442D588F3 },
+		{ 0xB7DCBF5354E9BECE, 0x0C11ED6D538AEB30 }, { 0xE5D3EF282A242E81, 0x8F1668C8A86DA5FB },
+		{ 0x8FA475791A569D10, 0xF96E017D694487BD }, { 0xB38D92D760EC4455, 0x37C981DCC395A9AD },
+		{ 0xE070F78D3927556A, 0x85BBE253F47B1418 }, { 0x8C469AB843B89562, 0x93956D7478CCEC8F },
+		{ 0xAF58416654A6BABB, 0x387AC8D1970027B3 }, { 0xDB2E51BFE9D0696A, 0x06997B05FCC0319F },
+		{ 0x88FCF317F22241E2, 0x441FECE3BDF81F04 }, { 0xAB3C2FDDEEAAD25A, 0xD527E81CAD7626C4 },
+		{ 0xD60B3BD56A5586F1, 0x8A71E223D8D3B075 }, { 0x85C7056562757456, 0xF6872D5667844E4A },
+		{ 0xA738C6BEBB12D16C, 0xB428F8AC016561DC }, { 0xD106F86E69D785C7, 0xE13336D701BEBA53 },
+		{ 0x82A45B450226B39C, 0xECC0024661173474 }, { 0xA34D721642B06084, 0x27F002D7F95D0191 },
+		{ 0xCC20CE9BD35C78A5, 0x31EC038DF7B441F5 }, { 0xFF290242C83396CE, 0x7E67047175A15272 },
+		{ 0x9F79A169BD203E41, 0x0F0062C6E984D387 }, { 0xC75809C42C684DD1, 0x52C07B78A3E60869 },
+		{ 0xF92E0C3537826145, 0xA7709A56CCDF8A83 }, { 0x9BBCC7A142B17CCB, 0x88A66076400BB692 },
+		{ 0xC2ABF989935DDBFE, 0x6ACFF893D00EA436 }, { 0xF356F7EBF83552FE, 0x0583F6B8C4124D44 },
+		{ 0x98165AF37B2153DE, 0xC3727A337A8B704B }, { 0xBE1BF1B059E9A8D6, 0x744F18C0592E4C5D },
+		{ 0xEDA2EE1C7064130C, 0x1162DEF06F79DF74 }, { 0x9485D4D1C63E8BE7, 0x8ADDCB5645AC2BA9 },
+		{ 0xB9A74A0637CE2EE1, 0x6D953E2BD7173693 }, { 0xE8111C87C5C1BA99, 0xC8FA8DB6CCDD0438 },
+		{ 0x910AB1D4DB9914A0, 0x1D9C9892400A22A3 }, { 0xB54D5E4A127F59C8, 0x2503BEB6D00CAB4C },
+		{ 0xE2A0B5DC971F303A, 0x2E44AE64840FD61E }, { 0x8DA471A9DE737E24, 0x5CEAECFED289E5D3 },
+		{ 0xB10D8E1456105DAD, 0x7425A83E872C5F48 }, { 0xDD50F1996B947518, 0xD12F124E28F7771A },
+		{ 0x8A5296FFE33CC92F, 0x82BD6B70D99AAA70 }, { 0xACE73CBFDC0BFB7B, 0x636CC64D1001550C },
+		{ 0xD8210BEFD30EFA5A, 0x3C47F7E05401AA4F }, { 0x8714A775E3E95C78, 0x65ACFAEC34810A72 },
+		{ 0xA8D9D1535CE3B396, 0x7F1839A741A14D0E }, { 0xD31045A8341CA07C, 0x1EDE48111209A051 },
+		{ 0x83EA2B892091E44D, 0x934AED0AAB460433 }, { 0xA4E4B66B68B65D60, 0xF81DA84D56178540 },
+		{ 0xCE1DE40642E3F4B9, 0x36251260AB9D668F }, { 0x80D2AE83E9CE78F3, 0xC1D72B7C6B42601A },
+		{ 0xA1075A24E4421730, 0xB24CF65B8612F820 }, { 0xC94930AE1D529CFC, 0xDEE033F26797B628 },
+		{ 0xFB9B7CD9A4A7443C, 0x169840EF017DA3B2 }, { 0x9D412E0806E88AA5, 0x8E1F289560EE864F },
+		{ 0xC491798A08A2AD4E, 0xF1A6F2BAB92A27E3 }, { 0xF5B5D7EC8ACB58A2, 0xAE10AF696774B1DC },
+		{ 0x9991A6F3D6BF1765, 0xACCA6DA1E0A8EF2A }, { 0xBFF610B0CC6EDD3F, 0x17FD090A58D32AF4 },
+		{ 0xEFF394DCFF8A948E, 0xDDFC4B4CEF07F5B1 }, { 0x95F83D0A1FB69CD9, 0x4ABDAF101564F98F },
+		{ 0xBB764C4CA7A4440F, 0x9D6D1AD41ABE37F2 }, { 0xEA53DF5FD18D5513, 0x84C86189216DC5EE },
+		{ 0x92746B9BE2F8552C, 0x32FD3CF5B4E49BB5 }, { 0xB7118682DBB66A77, 0x3FBC8C33221DC2A2 },
+		{ 0xE4D5E82392A40515, 0x0FABAF3FEAA5334B }, { 0x8F05B1163BA6832D, 0x29CB4D87F2A7400F },
+		{ 0xB2C71D5BCA9023F8, 0x743E20E9EF511013 }, { 0xDF78E4B2BD342CF6, 0x914DA9246B255417 },
+		{ 0x8BAB8EEFB6409C1A, 0x1AD089B6C2F7548F }, { 0xAE9672ABA3D0C320, 0xA184AC2473B529B2 },
+		{ 0xDA3C0F568CC4F3E8, 0xC9E5D72D90A2741F }, { 0x8865899617FB1871, 0x7E2FA67C7A658893 },
+		{ 0xAA7EEBFB9DF9DE8D, 0xDDBB901B98FEEAB8 }, { 0xD51EA6FA85785631, 0x552A74227F3EA566 },
+		{ 0x8533285C936B35DE, 0xD53A88958F872760 }, { 0xA67FF273B8460356, 0x8A892ABAF368F138 },
+		{ 0xD01FEF10A657842C, 0x2D2B7569B0432D86 }, { 0x8213F56A67F6B29B, 0x9C3B29620E29FC74 },
+		{ 0xA298F2C501F45F42, 0x8349F3BA91B47B90 }, { 0xCB3F2F7642717713, 0x241C70A936219A74 },
+		{ 0xFE0EFB53D30DD4D7, 0xED238CD383AA0111 }, { 0x9EC95D1463E8A506, 0xF4363804324A40AB },
+		{ 0xC67BB4597CE2CE48, 0xB143C6053EDCD0D6 }, { 0xF81AA16FDC1B81DA, 0xDD94B7868E94050B },
+		{ 0x9B10A4E5E9913128, 0xCA7CF2B4191C8327 }, { 0xC1D4CE1F63F57D72, 0xFD1C2F611F63A3F1 },
+		{ 0xF24A01A73CF2DCCF, 0xBC633B39673C8CED }, { 0x976E41088617CA01, 0xD5BE0503E085D814 },
+		{ 0xBD49D14AA79DBC82, 0x4B2D8644D8A74E19 }, { 0xEC9C459D51852BA2, 0xDDF8E7D60ED1219F },
+		{ 0x93E1AB8252F33B45, 0xCABB90E5C942B504 }, { 0xB8DA1662E7B00A17, 0x3D6A751F3B936244 },
+		{ 0xE7109BFBA19C0C9D, 0x0CC512670A783AD5 }, { 0x906A617D450187E2, 0x27FB2B80668B24C6 },
+		{ 0xB484F9DC9641E9DA, 0xB1F9F660802DEDF7 }, { 0xE1A63853BBD26451, 0x5E7873F8A0396974 },
+		{ 0x8D07E33455637EB2, 0xDB0B487B6423E1E9 }, { 0xB049DC016ABC5E5F, 0x91CE1A9A3D2CDA63 },
+		{ 0xDC5C5301C56B75F7, 0x7641A140CC7810FC }, { 0x89B9B3E11B6329BA, 0xA9E904C87FCB0A9E },
+		{ 0xAC2820D9623BF429, 0x546345FA9FBDCD45 }, { 0xD732290FBACAF133, 0xA97C177947AD4096 },
+		{ 0x867F59A9D4BED6C0, 0x49ED8EABCCCC485E }, { 0xA81F301449EE8C70, 0x5C68F256BFFF5A75 },
+		{ 0xD226FC195C6A2F8C, 0x73832EEC6FFF3112 }, { 0x83585D8FD9C25DB7, 0xC831FD53C5FF7EAC },
+		{ 0xA42E74F3D032F525, 0xBA3E7CA8B77F5E56 }, { 0xCD3A1230C43FB26F, 0x28CE1BD2E55F35EC },
+		{ 0x80444B5E7AA7CF85, 0x7980D163CF5B81B4 }, { 0xA0555E361951C366, 0xD7E105BCC3326220 },
+		{ 0xC86AB5C39FA63440, 0x8DD9472BF3FEFAA8 }, { 0xFA856334878FC150, 0xB14F98F6F0FEB952 },
+		{ 0x9C935E00D4B9D8D2, 0x6ED1BF9A569F33D4 }, { 0xC3B8358109E84F07, 0x0A862F80EC4700C9 },
+		{ 0xF4A642E14C6262C8, 0xCD27BB612758C0FB }, { 0x98E7E9CCCFBD7DBD, 0x8038D51CB897789D },
+		{ 0xBF21E44003ACDD2C, 0xE0470A63E6BD56C4 }, { 0xEEEA5D5004981478, 0x1858CCFCE06CAC75 },
+		{ 0x95527A5202DF0CCB, 0x0F37801E0C43EBC9 }, { 0xBAA718E68396CFFD, 0xD30560258F54E6BB },
+		{ 0xE950DF20247C83FD, 0x47C6B82EF32A206A }, { 0x91D28B7416CDD27E, 0x4CDC331D57FA5442 },
+		{ 0xB6472E511C81471D, 0xE0133FE4ADF8E953 }, { 0xE3D8F9E563A198E5, 0x58180FDDD97723A7 },
+		{ 0x8E679C2F5E44FF8F, 0x570F09EAA7EA7649 }, { 0xB201833B35D63F73, 0x2CD2CC6551E513DB },
+		{ 0xDE81E40A034BCF4F, 0xF8077F7EA65E58D2 }, { 0x8B112E86420F6191, 0xFB04AFAF27FAF783 },
+		{ 0xADD57A27D29339F6, 0x79C5DB9AF1F9B564 }, { 0xD94AD8B1C7380874, 0x18375281AE7822BD },
+		{ 0x87CEC76F1C830548, 0x8F2293910D0B15B6 }, { 0xA9C2794AE3A3C69A, 0xB2EB3875504DDB23 },
+		{ 0xD433179D9C8CB841, 0x5FA60692A46151EC }, { 0x849FEEC281D7F328, 0xDBC7C41BA6BCD334 },
+		{ 0xA5C7EA73224DEFF3, 0x12B9B522906C0801 }, { 0xCF39E50FEAE16BEF, 0xD768226B34870A01 },
+		{ 0x81842F29F2CCE375, 0xE6A1158300D46641 }, { 0xA1E53AF46F801C53, 0x60495AE3C1097FD1 },
+		{ 0xCA5E89B18B602368, 0x385BB19CB14BDFC5 }, { 0xFCF62C1DEE382C42, 0x46729E03DD9ED7B6 },
+		{ 0x9E19DB92B4E31BA9, 0x6C07A2C26A8346D2 }, { 0xC5A05277621BE293, 0xC7098B7305241886 },
+		{ 0xF70867153AA2DB38, 0xB8CBEE4FC66D1EA8 },
+	};
+
 
 
 	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
 	/*////////////////////////////////////////////////formatting helpers/////////////////////////////////////////////////////*/
 	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
 
-	uint32_t log2(uint64_t n) noexcept
+	uint32_t h_bit_width(uint64_t n) noexcept
 	{
-		uint32_t ret = 0;
+		unsigned long idx;
 
-		do
-		{
-			n >>= 1;
-			++ret;
-		}
-		while (n);
+#ifdef _M_AMD64
+		if (!_BitScanReverse64(&idx, n))
+			return 0;
 
-		return ret;
+		return idx + 1;
+#else
+		if (_BitScanReverse(&idx, static_cast<uint32_t>(n >> 32)))
+			return idx + 33;
+
+		if (!_BitScanReverse(&idx, static_cast<uint32_t>(n)))
+			return 0;
+
+		return idx + 1;
+#endif // _M_AMD64
 	}
 
-	uint32_t log10(uint64_t n) noexcept
+	uint32_t log2(uint64_t n) noexcept
 	{
-		uint32_t log{ 0 };
-
-		while (n >= 1000)
-		{
-			log += 3;
+		return h_bit_width(n | 1);
+	}
 
-			n /= 1000;
-		}
+	uint32_t log10(uint64_t n) noexcept
+	{
+		// Estimate the digit count from the bit width (1233 / 4096 ~ log10(2)), which is exact or one too small
+		const uint32_t estimate = (h_bit_width(n | 1) * 1233) >> 12;
 
-		if (n >= 100)
-			return log + 3;
-		else if (n >= 10)
-			return log + 2;
-		else
-			return log + 1;
+		return estimate + (n >= decimal_thresholds[estimate]);
 	}
 
 	uint32_t log16(uint64_t n) noexcept
 	{
-		uint32_t ret = 1;
+		// Hexadecimal output has always had at least two digits
+		const uint32_t digits = (h_bit_width(n) + 3) >> 2;
 
-		do
+		return digits < 2 ? 2 : digits;
+	}
+
+	// Writes the decimal digits of n so that the last one is at end[-1], two at a time
+	void h_write_decimal_backwards(char* end, uint64_t n) noexcept
+	{
+		while (n >= 100)
 		{
-			n >>= 4;
-			++ret;
-		} 
-		while (n > 15);
+			const uint64_t q = n / 100;
 
-		return ret;
+			end -= 2;
+
+			memcpy(end, two_digit_lut + (n - q * 100) * 2, 2);
+
+			n = q;
+		}
+
+		if (n >= 10)
+			memcpy(end - 2, two_digit_lut + n * 2, 2);
+		else
+			end[-1] = static_cast<char>('0' + n);
 	}
 
 	void h_fmt_two_digit(output_buffer& out, uint64_t n)
 	{
-		out.put(utf8_char((char)('0' + n / 10)));
+		char* curr = out.reserve(2);
 
-		out.put(utf8_char((char)('0' + n % 10)));
+		if (curr)
+			memcpy(curr, two_digit_lut + n * 2, 2);
 	}
 
 	void h_fmt_three_digit(output_buffer& out, uint64_t n)
 	{
-		out.put((char)('0' + n / 100));
-		out.put((char)('0' + (n / 10) % 10));
-		out.put((char)('0' + n % 10));
+		char* curr = out.reserve(3);
+
+		if (curr)
+		{
+			curr[0] = static_cast<char>('0' + n / 100);
+
+			memcpy(curr + 1, two_digit_lut + (n % 100) * 2, 2);
+		}
 	}
 
 	void h_fmt_decimal(output_buffer& out, uint64_t n, int32_t digits, char sign = '\0')
 	{
-		char* curr = out.reserve(digits + (sign != 0)) + digits - (sign == 0);
+		char* curr = out.reserve(digits + (sign != 0));
 
 		if (curr)
 		{
-			while (n >= 10)
-			{
-				*curr-- = (char)('0' + n % 10);
+			if (sign)
+				*curr++ = sign;
 
-				n /= 10;
-			}
+			h_write_decimal_backwards(curr + digits, n);
+		}
+	}
+
+	// Expands all 16 nibbles of value at once, most significant first
+	void h_expand_hex(char (&dst)[16], uint64_t value, bool is_upper) noexcept
+	{
+		const uint64_t big_endian = _byteswap_uint64(value);
 
-			*curr-- = (char)('0' + n);
+		const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&big_endian));
 
-			if (sign)
-				*curr = sign;
+		const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+
+		const __m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi64(bytes, 4), nibble_mask), _mm_and_si128(bytes, nibble_mask));
+
+		// Nibbles above 9 skip the characters between '9' and 'a' (or 'A')
+		const __m128i letter_offset = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8(is_upper ? 'A' - '9' - 1 : 'a' - '9' - 1));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letter_offset));
+	}
+
+	// Expands all 64 bits of value at once, most significant first
+	void h_expand_binary(char (&dst)[64], uint64_t value) noexcept
+	{
+		const uint64_t big_endian = _byteswap_uint64(value);
+
+		const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&big_endian));
+
+		const __m128i bit_mask = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+
+		const __m128i bytes_x2 = _mm_unpacklo_epi8(bytes, bytes);
+
+		const __m128i bytes_x4_lo = _mm_unpacklo_epi16(bytes_x2, bytes_x2);
+
+		const __m128i bytes_x4_hi = _mm_unpackhi_epi16(bytes_x2, bytes_x2);
+
+		const __m128i bytes_x8[4]{
+			_mm_unpacklo_epi32(bytes_x4_lo, bytes_x4_lo),
+			_mm_unpackhi_epi32(bytes_x4_lo, bytes_x4_lo),
+			_mm_unpacklo_epi32(bytes_x4_hi, bytes_x4_hi),
+			_mm_unpackhi_epi32(bytes_x4_hi, bytes_x4_hi),
+		};
+
+		for (uint32_t i = 0; i != 4; ++i)
+		{
+			// Set bits compare equal to their mask, yielding -1, which turns '0' into '1'
+			const __m128i is_set = _mm_cmpeq_epi8(_mm_and_si128(bytes_x8[i], bit_mask), bit_mask);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 16), _mm_sub_epi8(_mm_set1_epi8('0'), is_set));
 		}
 	}
 
-	void h_fmt_hex(output_buffer& out, uint64_t value, int32_t digits, const char* hex_charset)
+	void h_fmt_hex(output_buffer& out, uint64_t value, int32_t digits, bool is_upper)
 	{
-		char* curr = out.reserve(digits) + digits - 1;
+		char* curr = out.reserve(digits);
 
 		if (curr)
 		{
-			while (--digits > 0)
-			{
-				*curr-- = hex_charset[value & 0xF];
+			char expanded[16];
 
-				value >>= 4;
-			}
+			h_expand_hex(expanded, value, is_upper);
 
-			*curr-- = hex_charset[value & 0xF];
+			memcpy(curr, expanded + 16 - digits, digits);
 		}
 	}
 
 	void h_fmt_binary(output_buffer& out, uint64_t value, int32_t digits)
 	{
-		char* curr = out.reserve(digits) + digits - 1;
+		char* curr = out.reserve(digits);
 
 		if (curr)
 		{
-			while (--digits > 0)
-			{
-				*curr-- = '0' + (value & 1);
+			char expanded[64];
 
-				value >>= 1;
-			}
+			h_expand_binary(expanded, value);
+
+			memcpy(curr, expanded + 64 - digits, digits);
+		}
+	}
+
+	struct scaled_quantity
+	{
+		uint64_t whole;
+
+		uint32_t fraction; // The first precision decimals, rounded
+
+		uint32_t unit; // 0 for plain bytes or ops, 1 for K(i), 2 for M(i), ...
+	};
+
+	// Expresses n in the given unit using only integer arithmetic
+	scaled_quantity h_scale_quantity(uint64_t n, bool is_binary, uint32_t unit, uint32_t precision) noexcept
+	{
+		if (unit == 0)
+			return { n, 0, 0 };
+
+		const uint64_t fraction_scale = precision == 0 ? 1 : decimal_thresholds[precision];
+
+		uint64_t whole;
+
+		uint64_t fraction;
+
+		if (is_binary)
+		{
+			const uint32_t shift = unit * 10;
+
+			// Dropping the lowest bits of large remainders keeps their product with fraction_scale within 64 bits. This
+			// only affects rounding once the fraction is known to more than 50 bits.
+			const uint32_t dropped = shift > 54 ? shift - 54 : 0;
+
+			const uint64_t remainder = (n & ((1ull << shift) - 1)) >> dropped;
+
+			whole = n >> shift;
+
+			fraction = (remainder * fraction_scale + (1ull << (shift - dropped - 1))) >> (shift - dropped);
+		}
+		else
+		{
+			const uint64_t divisor = decimal_thresholds[unit * 3];
+
+			const uint64_t step = divisor / fraction_scale;
+
+			whole = n / divisor;
+
+			fraction = (n - whole * divisor + step / 2) / step;
+		}
 
-			*curr-- = '0' + (value & 1);
+		if (fraction == fraction_scale)
+		{
+			++whole;
+
+			fraction = 0;
+		}
+
+		return { whole, static_cast<uint32_t>(fraction), unit };
+	}
+
+	// Expresses n in the largest unit in which it is at least 1 after rounding to precision decimals. Plain counts are
+	// written exactly, so 1023 stays 1023 B rather than becoming 1.0 KiB.
+	scaled_quantity h_scale_quantity(uint64_t n, bool is_binary, uint32_t precision) noexcept
+	{
+		const uint32_t unit = is_binary ? (h_bit_width(n | 1) - 1) / 10 : (log10(n) - 1) / 3;
+
+		// n is below one of the next unit, but may round up to it, as in 1048575 with three decimals giving 1.000 MiB
+		// instead of 1023.999 KiB. This also covers values that would otherwise round up to 1024.0 KiB.
+		if (unit != 0 && unit != MAX_QUANTITY_UNIT)
+		{
+			const scaled_quantity next = h_scale_quantity(n, is_binary, unit + 1, precision);
+
+			if (next.whole != 0)
+				return next;
+		}
+
+		return h_scale_quantity(n, is_binary, unit, precision);
+	}
+
+	uint32_t h_quantity_cunits(const scaled_quantity& q, uint32_t fraction_digits, const quantity_format& format) noexcept
+	{
+		const uint32_t prefix_cunits = q.unit == 0 ? 0 : format.is_binary ? 2 : 1;
+
+		return log10(q.whole) + (fraction_digits != 0 ? fraction_digits + 1 : 0) + 1 + prefix_cunits + format.suffix_cunits;
+	}
+
+	// Writes the h_quantity_cunits(q, fraction_digits, format) cunits of "whole[.fraction] [prefix]suffix" to dst
+	void h_write_quantity(char* dst, const scaled_quantity& q, uint32_t fraction_digits, const quantity_format& format) noexcept
+	{
+		const uint32_t whole_digits = log10(q.whole);
+
+		h_write_decimal_backwards(dst + whole_digits, q.whole);
+
+		dst += whole_digits;
+
+		if (fraction_digits != 0)
+		{
+			*dst++ = '.';
+
+			memset(dst, '0', fraction_digits);
+
+			h_write_decimal_backwards(dst + fraction_digits, q.fraction);
+
+			dst += fraction_digits;
+		}
+
+		*dst++ = ' ';
+
+		if (q.unit != 0)
+		{
+			*dst++ = (format.is_binary ? binary_unit_prefixes : decimal_unit_prefixes)[q.unit - 1];
+
+			if (format.is_binary)
+				*dst++ = 'i';
+		}
+
+		memcpy(dst, format.suffix, format.suffix_cunits);
+	}
+
+	void h_fmt_quantity(output_buffer& out, uint64_t n, quantity kind, const parsed_context& context, char sign)
+	{
+		const quantity_format& format = quantity_formats[static_cast<uint8_t>(kind)];
+
+		const uint64_t abs_n = (sign == '-' ? -(int64_t)n : n);
+
+		const uint32_t precision = context.precision == 0xFFFF ? 1 : context.precision < MAX_QUANTITY_PRECISION ? context.precision : MAX_QUANTITY_PRECISION;
+
+		const scaled_quantity q = h_scale_quantity(abs_n, format.is_binary, precision);
+
+		const uint32_t fraction_digits = q.unit == 0 ? 0 : precision;
+
+		const uint32_t cunits = h_quantity_cunits(q, fraction_digits, format) + (sign != 0);
+
+		if (is_rightadj(context))
+			out.pad(cunits, context);
+
+		char* curr = out.reserve(cunits);
+
+		if (curr)
+		{
+			if (sign)
+				*curr++ = sign;
+
+			h_write_quantity(curr, q, fraction_digits, format);
 		}
+
+		if (!is_rightadj(context))
+			out.pad(cunits, context);
 	}
 
 	void h_fmt_integer_base(output_buffer& out, uint64_t n, const parsed_context& context, uint32_t bit_width, char sign = '\0')
 	{
-		const char* hex_fmt = hex_lower_upper;
+		bool is_upper_hex = false;
 		
 		uint32_t digits;
 		uint32_t min_binary_width = 0;
@@ -395,7 +918,7 @@ namespace och
 
 		case 'X':
 			{
-				hex_fmt += 16;
+				is_upper_hex = true;
 		case 'x':
 				digits = log16(n);
 
@@ -405,7 +928,7 @@ namespace och
 				if (is_rightadj(context))
 					out.pad(digits, context);
 
-				h_fmt_hex(out, n, digits, hex_fmt);
+				h_fmt_hex(out, n, digits, is_upper_hex);
 			}
 			break;
 
@@ -427,6 +950,26 @@ namespace och
 			}
 			break;
 
+		case 'i':
+			h_fmt_quantity(out, n, quantity::iec_bytes, context, sign);
+			return;
+
+		case 'k':
+			h_fmt_quantity(out, n, quantity::si_bytes, context, sign);
+			return;
+
+		case 'I':
+			h_fmt_quantity(out, n, quantity::iec_byte_rate, context, sign);
+			return;
+
+		case 'K':
+			h_fmt_quantity(out, n, quantity::si_byte_rate, context, sign);
+			return;
+
+		case 'r':
+			h_fmt_quantity(out, n, quantity::op_rate, context, sign);
+			return;
+
 		default:
 			{
 				out.put_padded(invalid_specifier_msg, context);
@@ -460,12 +1003,48 @@ namespace och
 		return val;
 	}
 
-	uint16_t h_parse_fmt_index_relative(const char*& context, const och::range<const och::arg_wrapper> argv)
+	// Returns the value of a packed argument widened to a type_union, as the built-in formatters expect it. Wrapped
+	// arguments yield the value of their arg_wrapper.
+	type_union h_packed_value(const packed_fmt_args& args, uint32_t index) noexcept
 	{
-		bool by_arg = *context == '{';
+		const uint32_t offset = args.offsets[index];
 
-		if (by_arg)
-			++context;
+		const uint32_t bytes = args.offsets[index + 1] - offset;
+
+		type_union value(static_cast<uint64_t>(0));
+
+		memcpy(&value, args.values + offset, bytes < sizeof(value) ? bytes : sizeof(value));
+
+		return value;
+	}
+
+	uint16_t h_arg_u16(const och::range<const och::arg_wrapper>& argv, uint32_t index) noexcept
+	{
+		return argv[index].value.u16;
+	}
+
+	uint16_t h_arg_u16(const packed_fmt_args& args, uint32_t index) noexcept
+	{
+		return h_packed_value(args, index).u16;
+	}
+
+	size_t h_arg_cnt(const och::range<const och::arg_wrapper>& argv) noexcept
+	{
+		return argv.len();
+	}
+
+	size_t h_arg_cnt(const packed_fmt_args& args) noexcept
+	{
+		return args.arg_cnt;
+	}
+
+	template<typename Argv>
+	uint16_t h_parse_fmt_index_relative(const char*& context, const Argv& argv)
+	{
+		bool by_arg = *context == '{';
+
+		if (by_arg)
+			++context;
 
 		uint16_t val = h_parse_fmt_index(context);
 
@@ -475,1124 +1054,2144 @@ namespace och
 
 			++context;
 
-			assert(val < argv.len());
+			assert(val < h_arg_cnt(argv));
 
-			val = argv[val].value.u16;
+			val = h_arg_u16(argv, val);
 		}
 
 		return val;
 	}
 
-	template<size_t SZ>
-	void h_fmt_mat(type_union arg_value, const parsed_context& context) noexcept
+	uint64_t h_mul128(uint64_t a, uint64_t b, uint64_t& out_hi) noexcept
 	{
-		constexpr uint32_t ELEMS = SZ * SZ;
+#ifdef _M_AMD64
+		return _umul128(a, b, &out_hi);
+#else
+		const uint64_t ll = (a & 0xFFFF'FFFF) * (b & 0xFFFF'FFFF);
+		const uint64_t lh = (a & 0xFFFF'FFFF) * (b >> 32);
+		const uint64_t hl = (a >> 32) * (b & 0xFFFF'FFFF);
+		const uint64_t hh = (a >> 32) * (b >> 32);
 
-		uint32_t prec = context.precision;
+		const uint64_t mid = (ll >> 32) + (lh & 0xFFFF'FFFF) + (hl & 0xFFFF'FFFF);
 
-		if (prec == 0x7FFF || prec == 0xFFFF)
-			prec = 4;
-		else if (prec > 8)
-			prec = 8;
+		out_hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
 
-		uint8_t cps[ELEMS];
+		return (mid << 32) | (ll & 0xFFFF'FFFF);
+#endif // _M_AMD64
+	}
 
-		char flt_strs[ELEMS][32];
+	struct decimal_fp
+	{
+		uint64_t significand;
 
-		for (uint32_t i = 0; i != ELEMS; ++i)
-			cps[i] = static_cast<uint8_t>(och::sprint(och::range(flt_strs[i]), "{0:.{1}_}", static_cast<const float*>(arg_value.ptr)[i], prec));
+		int32_t exponent;
+	};
 
-		if (context.flags & 1)
-			for (uint32_t i = 0; i != ELEMS; ++i)
-				if (flt_strs[i][0] == ' ')
-					flt_strs[i][0] = '+';
+	int32_t h_floor_log2_pow10(int32_t e) noexcept
+	{
+		return (e * 1741647) >> 19;
+	}
 
-		uint8_t max_cps = static_cast<uint8_t>(context.width);
+	int32_t h_floor_log10_pow2(int32_t e) noexcept
+	{
+		return (e * 1262611) >> 22;
+	}
 
-		for (uint8_t i = 0; i != ELEMS; ++i)
-			if (cps[i] > max_cps)
-				max_cps = cps[i];
+	int32_t h_floor_log10_three_quarters_pow2(int32_t e) noexcept
+	{
+		return (e * 1262611 - 524031) >> 22;
+	}
 
-		for (uint32_t y = 0; y != SZ; ++y)
-		{
-			context.output.put('|');
+	uint64_t h_round_to_odd(const uint64_t (&g)[2], uint64_t cp) noexcept
+	{
+		uint64_t x_hi;
 
-			for (uint32_t x = 0; x != SZ; ++x)
-			{
-				const uint32_t i = x * SZ + y;
+		h_mul128(g[1], cp, x_hi);
 
-				for (uint8_t c = cps[i]; c != max_cps; ++c)
-					context.output.put(' ');
+		uint64_t y_hi;
 
-				context.output.put(och::stringview(flt_strs[i], cps[i], cps[i]));
+		const uint64_t y_lo = h_mul128(g[0], cp, y_hi);
 
-				if (x != SZ - 1)
-				{
-					context.output.put(',');
-					context.output.put(' ');
-				}
-			}
+		const uint64_t z = y_lo + x_hi;
 
-			context.output.put('|');
+		y_hi += z < y_lo;
 
-			if (y != SZ - 1)
-				context.output.put('\n');
-		}
+		return y_hi | (z > 1);
 	}
 
-	template<size_t SZ>
-	void h_fmt_vec(type_union arg_value, const parsed_context& context) noexcept
+	// Finds the shortest decimal that rounds to c * 2^q, choosing the closest one if there are several, using Giulietti's
+	// Schubfach algorithm. lower_boundary_is_closer is true for the smallest significand of a binade, where the next
+	// smaller value is only half as far away as the next larger one. c must not be zero.
+	decimal_fp h_shortest_decimal(uint64_t c, int32_t q, bool lower_boundary_is_closer) noexcept
 	{
-		uint32_t prec = context.precision;
+		const bool is_even = (c & 1) == 0;
 
-		if (prec == 0x7FFF || prec == 0xFFFF)
-			prec = 4;
-		else if (prec > 8)
-			prec = 8;
+		const uint64_t cbl = 4 * c - 2 + lower_boundary_is_closer;
 
-		uint8_t cps[SZ];
+		const uint64_t cb = 4 * c;
 
-		char flt_strs[SZ][32];
+		const uint64_t cbr = 4 * c + 2;
 
-		for (uint32_t i = 0; i != SZ; ++i)
-			cps[i] = static_cast<uint8_t>(och::sprint(och::range(flt_strs[i]), "{0:.{1}_}", static_cast<const float*>(arg_value.ptr)[i], prec));
+		const int32_t k = lower_boundary_is_closer ? h_floor_log10_three_quarters_pow2(q) : h_floor_log10_pow2(q);
 
-		if (context.flags & 1)
-			for (uint32_t i = 0; i != SZ; ++i)
-				if (flt_strs[i][0] == ' ')
-					flt_strs[i][0] = '+';
+		const int32_t h = q + h_floor_log2_pow10(-k) + 1;
 
-		uint8_t max_cps = static_cast<uint8_t>(context.width);
+		const uint64_t (&g)[2] = pow10_significands[-k - POW10_MIN_EXPONENT];
 
-		for (uint8_t i = 0; i != SZ; ++i)
-			if (cps[i] > max_cps)
-				max_cps = cps[i];
+		const uint64_t vbl = h_round_to_odd(g, cbl << h);
 
-		context.output.put('(');
+		const uint64_t vb = h_round_to_odd(g, cb << h);
 
-		for (uint32_t i = 0; i != SZ; ++i)
-		{
-			for (uint8_t c = cps[i]; c != max_cps; ++c)
-				context.output.put(' ');
+		const uint64_t vbr = h_round_to_odd(g, cbr << h);
 
-			context.output.put(och::stringview(flt_strs[i], cps[i], cps[i]));
+		const uint64_t lower = vbl + !is_even;
 
-			if (i != SZ - 1)
-			{
-				context.output.put(',');
-				context.output.put(' ');
-			}
-		}
+		const uint64_t upper = vbr - !is_even;
 
-		context.output.put(')');
-	}
+		const uint64_t s = vb >> 2;
 
+		decimal_fp ret;
 
+		bool is_found = false;
 
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////formatting functions////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+		if (s >= 10)
+		{
+			const uint64_t sp = s / 10;
 
-	void fmt_uint64(type_union arg_value, const parsed_context& context) noexcept
-	{
-		uint64_t value = arg_value.u64;
+			const bool up_inside = lower <= 40 * sp;
 
-		h_fmt_integer_base(context.output, value, context, 64);
-	}
+			const bool wp_inside = 40 * sp + 40 <= upper;
 
-	void fmt_int64(type_union arg_value, const parsed_context& context) noexcept
-	{
-		int64_t value = arg_value.i64;
+			if (up_inside != wp_inside)
+			{
+				ret = { sp + wp_inside, k + 1 };
 
-		h_fmt_integer_base(context.output, value, context, 64, h_get_sign(value, context));
-	}
+				is_found = true;
+			}
+		}
 
-	void fmt_uint32(type_union arg_value, const parsed_context& context) noexcept
-	{
-		uint32_t value = arg_value.u32;
+		if (!is_found)
+		{
+			const bool u_inside = lower <= 4 * s;
 
-		h_fmt_integer_base(context.output, value, context, 32);
-	}
+			const bool w_inside = 4 * s + 4 <= upper;
 
-	void fmt_int32(type_union arg_value, const parsed_context& context) noexcept
-	{
-		int32_t value = arg_value.i32;
+			if (u_inside != w_inside)
+			{
+				ret = { s + w_inside, k };
+			}
+			else
+			{
+				const uint64_t mid = 4 * s + 2;
 
-		h_fmt_integer_base(context.output, value, context, 32, h_get_sign(value, context));
-	}
+				ret = { s + (vb > mid || (vb == mid && (s & 1) != 0)), k };
+			}
+		}
 
-	void fmt_uint16(type_union arg_value, const parsed_context& context) noexcept
-	{
-		uint16_t value = arg_value.u16;
+		while (ret.significand % 10 == 0)
+		{
+			ret.significand /= 10;
 
-		h_fmt_integer_base(context.output, value, context, 16);
+			++ret.exponent;
+		}
+
+		return ret;
 	}
 
-	void fmt_int16(type_union arg_value, const parsed_context& context) noexcept
+	// Writes the decimal digits of n to the end of buf and returns a pointer to the first one
+	char* h_reverse_decimal(char* buf_end, uint64_t n) noexcept
 	{
-		int16_t value = arg_value.i16;
+		do
+		{
+			*--buf_end = static_cast<char>('0' + n % 10);
 
-		h_fmt_integer_base(context.output, value, context, 16, h_get_sign(value, context));
+			n /= 10;
+		}
+		while (n);
+
+		return buf_end;
 	}
 
-	void fmt_uint8(type_union arg_value, const parsed_context& context) noexcept
+	// Exact decimal expansion of c * 2^q, rounded to a given number of digits. Large or tiny values are expanded with a
+	// bignum of 32-bit words, but for the common case of few integer and fraction bits only a word or two is involved.
+	struct exact_decimal
 	{
-		uint8_t value = arg_value.u8;
+		static constexpr uint32_t MAX_WORDS = 36;
 
-		h_fmt_integer_base(context.output, value, context, 8);
-	}
+		static constexpr uint32_t MAX_DIGITS = 1152;
 
-	void fmt_int8(type_union arg_value, const parsed_context& context) noexcept
-	{
-		int8_t value = arg_value.i8;
+		char digits[MAX_DIGITS];
 
-		h_fmt_integer_base(context.output, value, context, 8, h_get_sign(value, context));
-	}
+		uint32_t digit_cnt = 0;
 
-	void fmt_utf8_view(type_union arg_value, const parsed_context& context) noexcept
-	{
-		och::utf8_view value = *(const och::utf8_view*)arg_value.ptr;
+		int32_t point = 0; // Number of digits before the decimal point
 
-		if (value.get_codepoints() > context.precision)
-			value = value.subview(0, context.precision);
+		uint32_t fraction[MAX_WORDS];
 
-		context.output.put_padded(value, context);
-	}
+		uint32_t fraction_words = 0;
 
-	void fmt_utf8_string(type_union arg_value, const parsed_context& context) noexcept
-	{
-		och::utf8_view value(*(const och::utf8_string*)arg_value.ptr);
+		uint32_t fraction_bits = 0;
 
-		fmt_utf8_view((const void*)&value, context);
-	}
+		exact_decimal(uint64_t c, int32_t q) noexcept
+		{
+			uint32_t integer[MAX_WORDS]{};
 
-	void fmt_cstring(type_union arg_value, const parsed_context& context) noexcept
-	{
-		och::utf8_view value(reinterpret_cast<const char*>(arg_value.ptr));
+			uint32_t integer_words = 0;
 
-		fmt_utf8_view((const void*)&value, context);
-	}
+			if (q >= 0)
+			{
+				const uint32_t word_shift = static_cast<uint32_t>(q) >> 5;
 
-	void fmt_codepoint(type_union arg_value, const parsed_context& context) noexcept
-	{
-		och::utf8_char value = arg_value.utf_c;
+				const uint32_t bit_shift = static_cast<uint32_t>(q) & 31;
 
-		context.output.put_padded(value, context);
-	}
+				const uint64_t lo = c << bit_shift;
 
-	void fmt_float(type_union arg_value, const parsed_context& context) noexcept
-	{
-		constexpr uint64_t radix_pos = 60;
+				const uint64_t hi = bit_shift == 0 ? 0 : c >> (64 - bit_shift);
 
-		struct chonker
-		{
-			uint32_t bits[10]{};
+				integer[word_shift] = static_cast<uint32_t>(lo);
+				integer[word_shift + 1] = static_cast<uint32_t>(lo >> 32);
+				integer[word_shift + 2] = static_cast<uint32_t>(hi);
 
-			chonker(int32_t raw_exp, int32_t mnt)
+				integer_words = word_shift + 3;
+			}
+			else
 			{
-				if (!raw_exp)
-					raw_exp = 1;
-				else
-					mnt |= 1 << 23;
+				fraction_bits = static_cast<uint32_t>(-q);
 
-				int32_t shift = raw_exp + 10;
+				const uint64_t integer_part = fraction_bits < 64 ? c >> fraction_bits : 0;
 
-				int32_t block = shift >> 5;
+				const uint64_t fraction_part = fraction_bits < 64 ? c & ((1ull << fraction_bits) - 1) : c;
 
-				int32_t rest = shift & 31;
+				integer[0] = static_cast<uint32_t>(integer_part);
+				integer[1] = static_cast<uint32_t>(integer_part >> 32);
 
-				bits[block    ] = mnt << rest;;
-				bits[block + 1] = static_cast<uint32_t>(static_cast<uint64_t>(mnt) >> (32 - rest));
-			}
+				integer_words = 2;
 
-			__forceinline bool div10_part(uint32_t& n, uint32_t& rem)
-			{
-				uint64_t nl = (static_cast<uint64_t>(rem) << 32) | n;
+				fraction_words = (fraction_bits + 31) >> 5;
+
+				for (uint32_t i = 0; i != fraction_words; ++i)
+					fraction[i] = i < 2 ? static_cast<uint32_t>(fraction_part >> (i * 32)) : 0;
+			}
 
-				rem = nl % 10;
+			while (integer_words != 0 && integer[integer_words - 1] == 0)
+				--integer_words;
 
-				n = static_cast<uint32_t>(nl / 10);
+			// Integer digits are produced in chunks of nine, least significant chunk first
+			char integer_digits[324];
 
-				return n;
-			}
+			char* integer_beg = integer_digits + sizeof(integer_digits);
 
-			bool moddiv10(int32_t& out_rem)
+			while (integer_words != 0)
 			{
-				uint32_t rem = 0;
+				uint64_t rem = 0;
 
-				bool is_nonzero = false;
+				for (uint32_t i = integer_words; i-- != 0;)
+				{
+					const uint64_t curr = (rem << 32) | integer[i];
 
-				for (int i = 9; i != 4; --i)
-					is_nonzero |= div10_part(bits[i], rem);
+					integer[i] = static_cast<uint32_t>(curr / 1'000'000'000);
 
-				out_rem = rem;
+					rem = curr % 1'000'000'000;
+				}
 
-				return is_nonzero;
-			}
+				while (integer_words != 0 && integer[integer_words - 1] == 0)
+					--integer_words;
 
-			__forceinline bool mul10_part(uint32_t& n, uint32_t& rem)
-			{
-				uint64_t nl = static_cast<uint64_t>(n);
+				char* chunk_end = integer_beg;
 
-				nl = nl * 10 + rem;
+				integer_beg = h_reverse_decimal(integer_beg, rem);
 
-				n = static_cast<uint32_t>(nl);
+				if (integer_words != 0)
+					while (integer_beg != chunk_end - 9)
+						*--integer_beg = '0';
+			}
 
-				rem = static_cast<uint32_t>(nl >> 32);
+			digit_cnt = static_cast<uint32_t>(integer_digits + sizeof(integer_digits) - integer_beg);
 
-				return n;
-			}
+			point = static_cast<int32_t>(digit_cnt);
 
-			bool modmul10(int32_t& out_rem)
-			{
-				uint32_t rem = 0;
+			memcpy(digits, integer_beg, digit_cnt);
+		}
+
+		bool fraction_is_zero() const noexcept
+		{
+			for (uint32_t i = 0; i != fraction_words; ++i)
+				if (fraction[i] != 0)
+					return false;
 
-				bool is_nonzero = false;
+			return true;
+		}
+
+		// Appends the next nine fraction digits
+		void next_fraction_chunk() noexcept
+		{
+			uint64_t carry = 0;
 
-				for (int i = 0; i != 5; ++i)
-					is_nonzero |= mul10_part(bits[i], rem);
+			for (uint32_t i = 0; i != fraction_words; ++i)
+			{
+				const uint64_t curr = static_cast<uint64_t>(fraction[i]) * 1'000'000'000 + carry;
 
-				out_rem = rem;
+				fraction[i] = static_cast<uint32_t>(curr);
 
-				return is_nonzero;
+				carry = curr >> 32;
 			}
-		};
 
-		const int32_t value = arg_value.i32;
+			const uint32_t top_bits = fraction_bits & 31;
 
-		const int32_t sgn = value & (1 << 31);
-		const int32_t exp = ((value >> 23) & 0xFF);
-		const int32_t mnt = value & 0x7FFFFF;
+			uint64_t chunk;
 
-		if (exp == 0xFF)
-		{
-			if (mnt)
+			if (top_bits == 0)
 			{
-				context.output.put_padded(och::stringview("nan"), context);
-
-				return;
+				chunk = carry;
 			}
 			else
 			{
-				char buf[]{ 'X', 'i', 'n', 'f', '0' };
+				chunk = (carry << (32 - top_bits)) | (fraction[fraction_words - 1] >> top_bits);
 
-				char* beg = buf;
+				fraction[fraction_words - 1] &= (1u << top_bits) - 1;
+			}
 
-				if (sgn)
-					*beg = '-';
-				else if (context.flags & 1)
-					*beg = '+';
-				else if (context.flags & 2)
-					*beg = ' ';
-				else
-					++beg;
+			for (uint32_t i = 9; i != 0; --i)
+			{
+				digits[digit_cnt + i - 1] = static_cast<char>('0' + chunk % 10);
+
+				chunk /= 10;
+			}
+
+			digit_cnt += 9;
+		}
 
-				uint32_t len = static_cast<uint32_t>(buf - beg + 4);
+		// Rounds to nearest, ties to even, keeping only the first keep_cnt digits. If keep_cnt is negative, the value is
+		// rounded to the position of the digit -keep_cnt places before the first digit.
+		void round(int32_t keep_cnt) noexcept
+		{
+			if (keep_cnt < 0)
+			{
+				memset(digits, '0', digit_cnt);
 
-				context.output.put_padded(och::stringview(beg, len, len), context);
+				digit_cnt = 0;
 
 				return;
 			}
-		}
 
-		int32_t norm_exp = exp - 127;
+			while (static_cast<int32_t>(digit_cnt) <= keep_cnt && !fraction_is_zero() && digit_cnt + 9 <= MAX_DIGITS)
+				next_fraction_chunk();
 
-		char buf[256];
+			if (static_cast<int32_t>(digit_cnt) <= keep_cnt)
+			{
+				memset(digits + digit_cnt, '0', keep_cnt - digit_cnt);
 
-		char* integral_part = buf + radix_pos;
+				digit_cnt = static_cast<uint32_t>(keep_cnt);
 
-		char* fractional_part = buf + radix_pos;
+				return;
+			}
 
-		buf[radix_pos] = '.';
+			const char round_digit = digits[keep_cnt];
 
-		int32_t fract_digits = 0, precision = context.precision == 0xFFFF ? 6 : static_cast<int32_t>(context.precision);
+			bool is_tie = round_digit == '5' && fraction_is_zero();
 
-#ifdef _M_AMD64
-		constexpr int32_t mul_offset = 0;
-		
-		constexpr uint64_t mul_mask = 0xFFFF'FFFF'FFFF'FFFF;
-#else
-		constexpr int32_t mul_offset = 4;
+			for (uint32_t i = keep_cnt + 1; is_tie && i != digit_cnt; ++i)
+				is_tie = digits[i] == '0';
 
-		constexpr uint64_t mul_mask = (1ull << (64 - mul_offset)) - 1;
-#endif // _M_AMD64
+			digit_cnt = static_cast<uint32_t>(keep_cnt);
 
-		if (norm_exp < 64 && norm_exp > -41 + mul_offset) //Fast path
-		{
+			const bool round_up = round_digit > '5' || (round_digit == '5' && (!is_tie || (keep_cnt != 0 && (digits[keep_cnt - 1] & 1))));
 
-			uint64_t norm_mnt = (1 << 23) | mnt;
+			if (!round_up)
+				return;
 
-			uint64_t whole = norm_exp < 0 ? 0ull : norm_exp <= 23 ? norm_mnt >> (23 - norm_exp) : norm_mnt << (norm_exp - 23);
+			int32_t i = keep_cnt - 1;
 
-			uint64_t fract = norm_exp >= 23 ? 0ull : (norm_mnt << (41 + norm_exp - mul_offset)) & mul_mask;
+			while (i >= 0 && digits[i] == '9')
+				digits[i--] = '0';
 
-			while (whole >= 10)
+			if (i >= 0)
+			{
+				++digits[i];
+			}
+			else
 			{
-				*--integral_part = '0' + (whole % 10);
+				// Carried out of the first digit, so the value now has one more digit before the point
+				memmove(digits + 1, digits, digit_cnt);
+
+				digits[0] = '1';
+
+				++point;
 
-				whole /= 10;
+				++digit_cnt;
 			}
+		}
 
-			*--integral_part = '0' + static_cast<char>(whole);
+		// Skips leading zeroes in the fraction, so that digits[0] is the first significant digit (if there is any)
+		void skip_leading_zeroes() noexcept
+		{
+			if (digit_cnt != 0)
+				return;
 
-			do
-#ifdef _M_AMD64
+			while (!fraction_is_zero())
 			{
-				uint64_t ovflo;
+				next_fraction_chunk();
 
-				fract = _umul128(10, fract, &ovflo);
+				uint32_t zeroes = 0;
 
-				*++fractional_part = '0' + static_cast<char>(ovflo);
+				while (zeroes != digit_cnt && digits[zeroes] == '0')
+					++zeroes;
 
-				++fract_digits;
-			}
-#else		
-			{
-				fract *= 10;
+				point -= static_cast<int32_t>(zeroes);
 
-				*++fractional_part = '0' + static_cast<char>(fract >> (64 - mul_offset));
+				digit_cnt -= zeroes;
 
-				fract &= (1ull << (64 - mul_offset)) - 1;
+				memmove(digits, digits + zeroes, digit_cnt);
 
-				++fract_digits;
+				if (digit_cnt != 0)
+					return;
 			}
-#endif // _M_AMD64
-			while (fract && fract_digits < precision);
 		}
-		else //Slow path
+	};
+
+	// Writes digits, of which point are before the decimal point, in fixed notation with exactly fraction_digits digits
+	// after the point. Returns the end of the written characters.
+	char* h_write_fixed(char* curr, const char* digits, uint32_t digit_cnt, int32_t point, uint32_t fraction_digits) noexcept
+	{
+		if (point <= 0)
+		{
+			*curr++ = '0';
+		}
+		else
 		{
-			chonker num(exp, mnt);
+			for (int32_t i = 0; i != point; ++i)
+				*curr++ = i < static_cast<int32_t>(digit_cnt) ? digits[i] : '0';
+		}
 
-			int32_t rem;
+		if (fraction_digits != 0)
+		{
+			*curr++ = '.';
 
-			bool nonzero = true;
+			for (int32_t i = point; i != point + static_cast<int32_t>(fraction_digits); ++i)
+				*curr++ = i >= 0 && i < static_cast<int32_t>(digit_cnt) ? digits[i] : '0';
+		}
 
-			while (nonzero)
-			{
-				nonzero = num.moddiv10(rem);
+		return curr;
+	}
 
-				*--integral_part = '0' + static_cast<char>(rem);
-			}
+	// Writes digits in scientific notation, with exactly fraction_digits digits after the point and at least two exponent digits.
+	char* h_write_scientific(char* curr, const char* digits, uint32_t digit_cnt, int32_t exponent, uint32_t fraction_digits, char exponent_char) noexcept
+	{
+		*curr++ = digit_cnt == 0 ? '0' : digits[0];
 
-			nonzero = true;
+		if (fraction_digits != 0)
+		{
+			*curr++ = '.';
 
-			while (nonzero && fract_digits <= precision)
-			{
-				nonzero = num.modmul10(rem);
+			for (uint32_t i = 1; i != fraction_digits + 1; ++i)
+				*curr++ = i < digit_cnt ? digits[i] : '0';
+		}
 
-				*++fractional_part = '0' + static_cast<char>(rem);
+		*curr++ = exponent_char;
 
-				++fract_digits;
-			}
-		}
+		*curr++ = exponent < 0 ? '-' : '+';
 
-		if (context.format_specifier == och::utf8_char('\0')) //Default formatting
-		{
-			if (precision != 0x7FFF) //Rounding / padding
-			{
-				if (fract_digits > precision) //Round...
-				{
-					while (fractional_part != buf + radix_pos + 1)
-					{
-						char falloff = *fractional_part;
+		const uint32_t abs_exponent = static_cast<uint32_t>(exponent < 0 ? -exponent : exponent);
 
-						*--fractional_part += falloff >= '5';
+		if (abs_exponent >= 100)
+			*curr++ = static_cast<char>('0' + abs_exponent / 100);
 
-						--fract_digits;
+		*curr++ = static_cast<char>('0' + abs_exponent / 10 % 10);
 
-						if (*fractional_part != '9' + 1)
-							break;
-					}
-				}
+		*curr++ = static_cast<char>('0' + abs_exponent % 10);
 
-				if (precision > 128) //Prevent a buffer overflow
-					precision = 128;
+		return curr;
+	}
 
-				while (fract_digits++ < precision) //Pad...
-					*++fractional_part = '0';
-			}
+	// Formats c * 2^q according to context. Supported format specifiers are
+	//   (none)  fixed notation
+	//   e / E   scientific notation
+	//   g / G   scientific notation for very large or small exponents and fixed notation otherwise, without trailing zeroes
+	// An omitted precision defaults to 6 digits after the point (or 6 significant digits for g), while a '.' without
+	// precision selects the shortest representation that reads back as the same value.
+	void h_fmt_binary_fp(uint64_t c, int32_t q, bool lower_boundary_is_closer, bool is_negative, const parsed_context& context) noexcept
+	{
+		constexpr uint32_t MAX_PRECISION = 767;
 
-			if (sgn)
-				*--integral_part = '-';
-			else if (context.flags & 1)
-				*--integral_part = '+';
-			else if (context.flags & 2)
-				*--integral_part = ' ';
+		const char32_t specifier = context.format_specifier.codepoint();
 
-			if (!precision)
-				fractional_part = buf + radix_pos - 1;
-		}
-		else
+		if (specifier != '\0' && specifier != 'e' && specifier != 'E' && specifier != 'g' && specifier != 'G')
 		{
 			context.output.put_padded(invalid_specifier_msg, context);
 
 			return;
 		}
 
-		uint32_t len = static_cast<uint32_t>(fractional_part - integral_part + 1);
+		const bool is_shortest = context.precision == 0x7FFF;
 
-		context.output.put_padded(och::stringview(integral_part, len, len), context);
-	}
+		uint32_t precision = context.precision == 0xFFFF ? 6 : context.precision;
 
-	//TODO implement
-	void fmt_double(type_union arg_value, const parsed_context& context) noexcept
-	{
-		arg_value;
+		if (precision > MAX_PRECISION)
+			precision = MAX_PRECISION;
 
-		context.output.put_padded(och::stringview("[[fmt_double is not yet implemented]]"), context);
-	}
+		char buf[exact_decimal::MAX_DIGITS + 32];
 
-	void fmt_date(type_union arg_value, const parsed_context& context) noexcept
-	{
-		//          [y]yyyy-mm-dd, hh:mm:ss.mmm
-		// d   ->   [y]yyyy-mm-dd
-		// t   ->   hh:mm:ss.mmm : hh:mm:ss:mmm
-		// u   ->   is_utc ? [y]yyyy-mm-ddThh:mm:ss.mmmZ : [y]yyyy-mm-ddThh:mm:ss.mmm+-hh:mm
-		// x   ->   custom format:
-		//          +-------------------------------------------------------------------------------------------+
-		//          | y   ->   year														                        |
-		//          | m   ->   month, w/o leading zero										                    |
-		//          | n   ->   short monthname (Jan, Feb, ...)								                    |
-		//          | d   ->   monthday, w/o leading zero									                    |
-		//          | w   ->   short weekday (Mon, Tue, ...)								                    |
-		//          | i   ->   hour, w/o leading zero										                    |
-		//          | j   ->   minute, w/o leading zero									                        |
-		//          | k   ->   second, w/o leading zero									                        |
-		//          | l   ->   millisecond, three digits									                    |
-		//          | 	   	   																                    |
-		//          | u   ->   utc-offset hours (+-hh)										                    |
-		//          | U   ->   utc-offset minutes (mm)										                    |
-		//          | s?  ->   utf8_char after s is only printed if date is local			                    |
-		//          | S?  ->   utf8_char after s is only printed if date is utc			                        |
-		//          | x   ->   x is ignored and the next character is printed, even if it is a format-specifier |
-		//          | 																	                        |
-		//          | Capital letters (except U) indicate leading zeroes, or full names                         |
-		//          +-------------------------------------------------------------------------------------------+
+		char* curr = buf;
 
-		const och::date& value = *reinterpret_cast<const och::date*>(arg_value.ptr);
-
-		output_buffer& out = context.output;
-
-		uint32_t utf8_cpoints = 0;
+		if (is_negative)
+			*curr++ = '-';
+		else if (context.flags & 1)
+			*curr++ = '+';
+		else if (context.flags & 2)
+			*curr++ = ' ';
 
-		const char* format;
+		const char exponent_char = specifier == 'E' || specifier == 'G' ? 'E' : 'e';
 
-		if (context.format_specifier == och::utf8_char('\0'))
-			format = "y-M-D, I:J:K.L}";
-		else if (context.format_specifier == och::utf8_char('d'))
-			format = "y-M-D}";
-		else if (context.format_specifier == och::utf8_char('t'))
-			format = "I:J:K.L}";
-		else if (context.format_specifier == och::utf8_char('u'))
-			format = "Y-M-DTI:J:K.Lus:U}";
-		else if (context.format_specifier == och::utf8_char('x'))
-			format = context.raw_context;
-		else
+		if (is_shortest)
 		{
-			out.put_padded(invalid_specifier_msg, context);
-			return;
-		}
+			char digit_buf[20];
 
-#define OCH_FMT_2DIGIT(x) if(c & 0x20) { if(x >= 10) out.put((char)('0' + x / 10)); out.put((char)('0' + x % 10)); } else { out.put((char)('0' + x / 10)); out.put((char)('0' + x % 10)); }
+			decimal_fp dec{ 0, 0 };
 
-		uint16_t year = value.year();
-		uint16_t month = value.month();
-		uint16_t weekday = value.weekday();
-		uint16_t monthday = value.monthday();
-		uint16_t hour = value.hour();
-		uint16_t minute = value.minute();
-		uint16_t second = value.second();
-		uint16_t millisecond = value.millisecond();
+			if (c != 0)
+				dec = h_shortest_decimal(c, q, lower_boundary_is_closer);
 
-		uint32_t cpoints = 0;
+			const char* digits = h_reverse_decimal(digit_buf + sizeof(digit_buf), dec.significand);
 
-		//Count required codepoints
-		{
-			const char* fmt = format;
+			const uint32_t digit_cnt = static_cast<uint32_t>(digit_buf + sizeof(digit_buf) - digits);
 
-			for (char c = *fmt; c != '}'; c = *++fmt)
-				switch (c)
-				{
-				case 'y':
-					cpoints += log10(year); 	break;
-				case 'Y':
-					cpoints += year >= 10000 ? 5 : 4; break;
-				case 'm':
-					cpoints += month >= 10 ? 2 : 1; break;
-				case 'N':
-					cpoints += static_cast<uint32_t>(strlen(months + static_cast<ptrdiff_t>(month - 1) * 10)); break;
-				case 'd':
-					cpoints += 1 + (monthday >= 10); break;
-				case 'W':
-					cpoints += static_cast<uint32_t>(strlen(weekdays + static_cast<ptrdiff_t>(weekday) * 10)); break;
-				case 'i':
-					cpoints += 1 + (hour >= 10); break;
-				case 'j':
-					cpoints += 1 + (minute >= 10); break;
-				case 'k':
-					cpoints += 1 + (second >= 10); break;
-				case 'l':
-					cpoints += millisecond >= 100 ? 3 : millisecond >= 10 ? 2 : 1; break;
-				case 'D':
-				case 'I':
-				case 'J':
-				case 'K':
-				case 'M':
-					cpoints += 2; break;
-				case 'L':
-				case 'w':
-				case 'n':
-					cpoints += 3; break;
-				case 'u':
-					cpoints += value.is_utc() ? 1 : 3; break;
-				case 'U':
-					cpoints += value.is_utc() ? 0 : 2; break;
-				case 's':
-				case 'S':
-					if ((c != 's') ^ (value.is_utc())) //Next char is inactive
-					{
-						if (*++fmt == 'x')
-							++fmt;
+			const int32_t point = static_cast<int32_t>(digit_cnt) + dec.exponent;
 
-						while (is_utf8_surr(fmt[1]))
-							++fmt;
-					}
-					break;
-				case 'x':
-					c = *++fmt; //Fallthrough...
-				default:
-					cpoints += !is_utf8_surr(c); break;
-				}
+			const int32_t sci_exponent = point - 1;
+
+			if (specifier == '\0' || ((specifier == 'g' || specifier == 'G') && sci_exponent >= -4 && sci_exponent < 17))
+				curr = h_write_fixed(curr, digits, digit_cnt, point, dec.exponent < 0 ? static_cast<uint32_t>(-dec.exponent) : 0);
+			else
+				curr = h_write_scientific(curr, digits, digit_cnt, c == 0 ? 0 : sci_exponent, digit_cnt - 1, exponent_char);
 		}
+		else if (specifier == '\0')
+		{
+			exact_decimal dec(c, q);
 
-		//Actually start formatting
+			dec.round(dec.point + static_cast<int32_t>(precision));
 
-		if (is_rightadj(context))
-			context.output.pad(cpoints, context);
+			curr = h_write_fixed(curr, dec.digits, dec.digit_cnt, dec.point, precision);
+		}
+		else
+		{
+			const bool is_general = specifier == 'g' || specifier == 'G';
 
-		for (char c = *format; c != '}'; c = *++format)
-			switch (c)
-			{
-			case 'y':
-				h_fmt_decimal(out, year, log10(year));
-				break;
+			if (is_general && precision == 0)
+				precision = 1;
 
-			case 'Y':
-				h_fmt_decimal(out, year, log10(year));
-				for (int i = log10(year); i != 4; ++i)
-					out.put('0');
-				break;
+			const uint32_t significant_digits = is_general ? precision : precision + 1;
 
-			case 'm':
-			case 'M':
-				OCH_FMT_2DIGIT(month);
-				break;
+			exact_decimal dec(c, q);
 
-			case 'n':
-				for (int i = 0; i != 3; ++i)
-					out.put(months[(month - 1) * 10 + i]);
-				break;
+			dec.skip_leading_zeroes();
 
-			case 'N':
-				out.put(och::stringview(months + (ptrdiff_t)(month - 1) * 10));
-				break;
+			dec.round(static_cast<int32_t>(significant_digits));
 
-			case 'd':
-			case 'D':
-				OCH_FMT_2DIGIT(monthday);
-				break;
+			// Zero has no significant digits, but is written as a single one before the point
+			const int32_t point = c == 0 ? 1 : dec.point;
 
-			case 'w':
-				for(int i = 0; i != 3; ++i)
-					out.put(weekdays[weekday * 10 + i]);
-				break;
+			const int32_t sci_exponent = point - 1;
 
-			case 'W':
-				out.put(och::stringview(weekdays + (ptrdiff_t)weekday * 10));
-				break;
+			if (!is_general)
+			{
+				curr = h_write_scientific(curr, dec.digits, dec.digit_cnt, sci_exponent, precision, exponent_char);
+			}
+			else
+			{
+				uint32_t digit_cnt = dec.digit_cnt;
 
-			case 'i':
-			case 'I':
-				OCH_FMT_2DIGIT(hour);
-				break;
+				while (digit_cnt > 1 && dec.digits[digit_cnt - 1] == '0')
+					--digit_cnt;
 
-			case 'j':
-			case 'J':
-				OCH_FMT_2DIGIT(minute);
-				break;
+				if (sci_exponent >= -4 && sci_exponent < static_cast<int32_t>(precision))
+				{
+					const int32_t fraction_digits = static_cast<int32_t>(digit_cnt) - point;
 
-			case 'k':
-			case 'K':
-				OCH_FMT_2DIGIT(second);
-				break;
+					curr = h_write_fixed(curr, dec.digits, digit_cnt, point, fraction_digits > 0 ? static_cast<uint32_t>(fraction_digits) : 0);
+				}
+				else
+				{
+					curr = h_write_scientific(curr, dec.digits, digit_cnt, sci_exponent, digit_cnt - 1, exponent_char);
+				}
+			}
+		}
 
-			case 'l':
-				h_fmt_decimal(out, millisecond, log10(millisecond));
-				break;
+		const uint32_t len = static_cast<uint32_t>(curr - buf);
 
-			case 'L':
-				h_fmt_three_digit(out, millisecond);
-				break;
+		context.output.put_padded(och::stringview(buf, len, len), context);
+	}
 
-			case 'u':
-				if (!value.is_utc())
-				{
-					out.put(value.utc_offset_is_negative() ? '-' : '+');
-					h_fmt_two_digit(out, value.utc_offset_hours());
-				}
-				else
-					out.put('Z');
-				break;
+	void h_fmt_nonfinite(bool is_nan, bool is_negative, const parsed_context& context) noexcept
+	{
+		if (is_nan)
+		{
+			context.output.put_padded(och::stringview("nan"), context);
 
-			case 'U':
-				if (!value.is_utc())
-					h_fmt_two_digit(out, value.utc_offset_minutes());
-				break;
+			return;
+		}
 
-			case 's':
-			case 'S':
-				if ((c != 's') ^ (value.is_utc())) //Next char is inactive
-				{
-					if (*++format == 'x')
-						++format;
+		char buf[]{ 'X', 'i', 'n', 'f' };
 
-					while (is_utf8_surr(format[1]))
-						++format;
-				}
-				break;
+		char* beg = buf;
 
-			case 'x':
-				c = *++format;//Fallthrough...
-			default:
-				out.put(c);
-				utf8_cpoints -= is_utf8_surr(c);
-				break;
-			}
+		if (is_negative)
+			*beg = '-';
+		else if (context.flags & 1)
+			*beg = '+';
+		else if (context.flags & 2)
+			*beg = ' ';
+		else
+			++beg;
 
-		if (!is_rightadj(context))
-			out.pad(cpoints, context);
+		const uint32_t len = static_cast<uint32_t>(buf + sizeof(buf) - beg);
 
-#undef OCH_FMT_2DIGIT
+		context.output.put_padded(och::stringview(beg, len, len), context);
 	}
 
-	//TODO improve (Not happy)
-	void fmt_timespan(type_union arg_value, const parsed_context& context) noexcept
+	// Writes value in fixed notation with precision digits after the point, prefixing positive values with
+	// positive_sign. Returns the end of the written text, which is at most 50 cunits long.
+	char* h_write_float_fixed(char* curr, float value, uint32_t precision, char positive_sign) noexcept
 	{
-		//     ->   appropriate format (with format specifier)
-		// d   ->   days
-		// h   ->   hours
-		// min ->   minutes
-		// s   ->   seconds
-		// ms  ->   milliseconds
-		// us,
-		// sμ  ->  microseconds
-		// l   ->  combination of all units which are greater than zero for the given timespan, separated by commas and with
-		//         their SI-symbols. Uppercase also prints units that are zero.
-		// x   ->  custom format, composed of the aforementioned letters. Other formatting rules are equivalent to fmt_date
-		//
-		// Uppercase letters also write the fitting SI-symbol.
-		//
-		// For microseconds, U writes [n...]u, while μ writes [n...]μ
+		constexpr double exact_powers10[9]{ 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
 
-		och::timespan value;
+		uint32_t bits;
 
-		value.val = arg_value.i64;
-		
-		output_buffer& out = context.output;
+		memcpy(&bits, &value, 4);
 
-		char sign = h_get_sign(value.val, context);
+		const bool is_negative = bits >> 31;
 
-		if (value.val < 0)
-			value.val = -value.val;
+		const uint32_t ieee_exponent = (bits >> 23) & 0xFF;
 
-		char32_t c = context.format_specifier.codepoint();
+		const uint32_t ieee_significand = bits & 0x7F'FFFF;
 
-		uint32_t utf_surr_count = 0;
+		if (ieee_exponent == 0xFF && ieee_significand != 0)
+		{
+			memcpy(curr, "nan", 3);
 
-		const char* specifier = nullptr;
+			return curr + 3;
+		}
 
-		int64_t time_value;
+		*curr++ = is_negative ? '-' : positive_sign;
 
-		switch (c)
+		if (ieee_exponent == 0xFF)
 		{
-		case '\0':
-			if (value.val < 10000ll && value.val > -10000ll)
-			{
-				if (is_rightadj(context))
-					out.pad(5 + (sign != 0), context);
+			memcpy(curr, "inf", 3);
 
-				if (sign)
-					out.put(sign);
+			return curr + 3;
+		}
 
-				h_fmt_three_digit(out, value.microseconds());
-				out.put('u');
-				out.put('s');
+		// The float's 24 significant bits times 5^precision take at most 43 bits, so the product is exact
+		const double scaled = static_cast<double>(is_negative ? -value : value) * exact_powers10[precision];
 
-				if (!is_rightadj(context))
-					out.pad(5 + (sign != 0), context);
-			}
-			else if (value.val < 10000000ll && value.val > -10000000ll)
-			{
-				if (is_rightadj(context))
-					out.pad(9 + (sign != 0), context);
+		if (scaled < 4503599627370496.0)
+		{
+			// Adding and subtracting 2^52 rounds to an integer, with ties going to even like exact_decimal::round
+			const uint64_t n = static_cast<uint64_t>((scaled + 4503599627370496.0) - 4503599627370496.0);
 
-				if (sign)
-					out.put(sign);
+			const uint64_t scale = static_cast<uint64_t>(exact_powers10[precision]);
 
-				h_fmt_three_digit(out, value.milliseconds());
+			const uint64_t integral = n / scale;
 
-				out.put('.');
+			const uint32_t integral_digits = log10(integral);
 
-				h_fmt_three_digit(out, value.microseconds() % 1000);
+			h_write_decimal_backwards(curr + integral_digits, integral);
 
-				out.put('m');
-				out.put('s');
+			curr += integral_digits;
 
-				if (!is_rightadj(context))
-					out.pad(9 + (sign != 0), context);
-			}
-			else if (value.val < 600000000ll && value.val > -600000000ll)
+			if (precision != 0)
 			{
-				if (is_rightadj(context))
-					out.pad(7 + (sign != 0), context);
+				*curr++ = '.';
 
-				h_fmt_two_digit(out, value.seconds());
+				// Writing scale + fraction keeps the leading zeroes of the fraction, with the leading 1 overwritten by '.'
+				h_write_decimal_backwards(curr + precision, scale + (n - integral * scale));
 
-				out.put('.');
+				curr[-1] = '.';
 
-				h_fmt_three_digit(out, value.milliseconds() % 1000);
+				curr += precision;
+			}
 
-				out.put('s');
+			return curr;
+		}
 
-				if (!is_rightadj(context))
-					out.pad(7 + (sign != 0), context);
-			}
-			else if (value.val < 60 * 600000000ll && value.val > -60 * 600000000ll)
-			{
-				if (is_rightadj(context))
-					out.pad(12 + (sign != 0), context);
+		exact_decimal dec(ieee_exponent == 0 ? ieee_significand : ieee_significand | (1 << 23), ieee_exponent == 0 ? -149 : static_cast<int32_t>(ieee_exponent) - 150);
 
-				h_fmt_two_digit(out, value.minutes());
+		dec.round(dec.point + static_cast<int32_t>(precision));
 
-				out.put(':');
+		return h_write_fixed(curr, dec.digits, dec.digit_cnt, dec.point, precision);
+	}
 
-				h_fmt_two_digit(out, value.seconds() % 60);
+	// Formats the ELEMS floats at values with the precision from context into strs, returning the length of the
+	// longest one, but at least context.width. All of them are ASCII, so cunits and cpoints are the same.
+	template<uint32_t ELEMS>
+	uint32_t h_fmt_float_elements(const float* values, char (&strs)[ELEMS][64], uint8_t (&cps)[ELEMS], const parsed_context& context) noexcept
+	{
+		uint32_t prec = context.precision;
 
-				out.put('.');
+		if (prec == 0x7FFF || prec == 0xFFFF)
+			prec = 4;
+		else if (prec > 8)
+			prec = 8;
 
-				h_fmt_three_digit(out, value.milliseconds() % 1000);
+		const char positive_sign = context.flags & 1 ? '+' : ' ';
 
-				out.put('m');
-				out.put('i');
-				out.put('n');
+		uint32_t max_cps = context.width;
 
-				if (!is_rightadj(context))
-					out.pad(12 + (sign != 0), context);
-			}
-			else
-			{
-				int64_t days = value.days();
-
-				uint32_t log10_d = log10(days);
+		for (uint32_t i = 0; i != ELEMS; ++i)
+		{
+			cps[i] = static_cast<uint8_t>(h_write_float_fixed(strs[i], values[i], prec, positive_sign) - strs[i]);
 
-				uint32_t chars = 6 + (days ? log10_d + 4 : 0) + (sign != 0);
+			if (cps[i] > max_cps)
+				max_cps = cps[i];
+		}
 
-				if (is_rightadj(context))
-					out.pad(chars, context);
+		return max_cps;
+	}
 
-				if (sign)
-					out.put(sign);
+	// Writes str right-aligned with spaces in a field of width cunits
+	void h_put_right_aligned(output_buffer& out, const char* str, uint32_t cunits, uint32_t width) noexcept
+	{
+		char* curr = out.reserve(width);
 
-				if (days)
-				{
-					h_fmt_decimal(out, value.days(), log10_d);
+		if (curr != nullptr)
+		{
+			memset(curr, ' ', width - cunits);
 
-					out.put('d');
-					out.put(' ');
-					out.put('+');
-					out.put(' ');
-				}
+			memcpy(curr + width - cunits, str, cunits);
+		}
+	}
 
-				h_fmt_two_digit(out, value.hours() % 24);
+	template<size_t SZ>
+	void h_fmt_mat(type_union arg_value, const parsed_context& context) noexcept
+	{
+		constexpr uint32_t ELEMS = SZ * SZ;
 
-				out.put(':');
+		uint8_t cps[ELEMS];
 
-				h_fmt_two_digit(out, value.minutes() % 60);
+		char flt_strs[ELEMS][64];
 
-				if (!is_rightadj(context))
-					out.pad(chars, context);
-			}
-			return;
+		const uint32_t max_cps = h_fmt_float_elements(static_cast<const float*>(arg_value.ptr), flt_strs, cps, context);
 
-		case 'D':
-			specifier = "d";
-		case 'd':
-			time_value = value.days();
-			break;
+		output_buffer& out = context.output;
 
-		case 'H':
-			specifier = "h";
-		case 'h':
-			time_value = value.hours();
-			break;
+		for (uint32_t y = 0; y != SZ; ++y)
+		{
+			out.put('|');
 
-		case 'M':
-			if (!context.raw_context)
+			for (uint32_t x = 0; x != SZ; ++x)
 			{
-				out.put_padded(invalid_specifier_msg, context);
+				const uint32_t i = x * SZ + y;
 
-				return;
-			}
-			else if (context.raw_context[0] == 'S')
-			{
-				specifier = "ms";
+				h_put_right_aligned(out, flt_strs[i], cps[i], max_cps);
 
-				time_value = value.milliseconds();
+				if (x != SZ - 1)
+					out.put(", ", 2);
 			}
-			else if (context.raw_context[0] == 'I' && context.raw_context[1] == 'N')
-			{
-				specifier = "min";
 
-				time_value = value.minutes();
-			}
-			else
-			{
-				out.put_padded(invalid_specifier_msg, context);
+			out.put('|');
 
-				return;
-			}
-			break;
-		case 'm':
-			if (!context.raw_context)
-			{
-				out.put_padded(invalid_specifier_msg, context);
+			if (y != SZ - 1)
+				out.put('\n');
+		}
+	}
 
-				return;
-			}
-			else if (context.raw_context[0] == 's')
-				time_value = value.milliseconds();
-			else if (context.raw_context[0] == 'i' && context.raw_context[1] == 'n')
-				time_value = value.minutes();
-			else
-			{
-				out.put_padded(invalid_specifier_msg, context);
+	template<size_t SZ>
+	void h_fmt_vec(type_union arg_value, const parsed_context& context) noexcept
+	{
+		uint8_t cps[SZ];
 
-				return;
-			}
-			break;
+		char flt_strs[SZ][64];
 
-		case 'S':
-			specifier = "s";
-		case 's':
-			time_value = value.seconds();
-			break;
+		const uint32_t max_cps = h_fmt_float_elements(static_cast<const float*>(arg_value.ptr), flt_strs, cps, context);
 
-		case U'μ':
-			specifier = reinterpret_cast<const char*>(u8"μs");
-			time_value = value.microseconds();
-			++utf_surr_count;
-			break;
+		output_buffer& out = context.output;
 
-		case 'U':
-			specifier = "us";
-		case 'u':
-			time_value = value.microseconds();
-			break;
+		out.put('(');
 
-		case 'L':
+		for (uint32_t i = 0; i != SZ; ++i)
 		{
-			//[+ -][D+d, ]HH:MM:SS.MMM.UUU
+			h_put_right_aligned(out, flt_strs[i], cps[i], max_cps);
 
-			int64_t days = value.days();
+			if (i != SZ - 1)
+				out.put(", ", 2);
+		}
 
-			uint32_t log10_d = log10(days);
+		out.put(')');
+	}
+	// Expands the 16 bytes at src into 32 hex digits at dst, two per byte with the high nibble first
+	void h_expand_hex_bytes(char* dst, const uint8_t* src, bool is_upper) noexcept
+	{
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
 
-			uint32_t day_chars = days ? 4 + log10_d : 0;
+		const __m128i nibble_mask = _mm_set1_epi8(0x0F);
 
-			uint32_t chars = 17 + day_chars + (sign != 0);
+		const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
 
-			if (is_rightadj(context))
-				out.pad(chars, context);
+		const __m128i lo_nibbles = _mm_and_si128(bytes, nibble_mask);
 
-			if (sign)
-				out.put(sign);
+		const __m128i letter_offset = _mm_set1_epi8(is_upper ? 'A' - '9' - 1 : 'a' - '9' - 1);
 
-			if (days)
-			{
-				h_fmt_decimal(out, value.days(), log10_d);
+		const __m128i nines = _mm_set1_epi8(9);
 
-				out.put('d');
-				out.put(' ');
-				out.put('+');
-				out.put(' ');
-			}
+		const __m128i zeroes = _mm_set1_epi8('0');
 
-			h_fmt_two_digit(out, value.hours() % 24);
+		const __m128i nibbles[2]{ _mm_unpacklo_epi8(hi_nibbles, lo_nibbles), _mm_unpackhi_epi8(hi_nibbles, lo_nibbles) };
 
-			out.put(':');
+		for (uint32_t i = 0; i != 2; ++i)
+		{
+			const __m128i digits = _mm_add_epi8(_mm_add_epi8(nibbles[i], zeroes), _mm_and_si128(_mm_cmpgt_epi8(nibbles[i], nines), letter_offset));
 
-			h_fmt_two_digit(out, value.minutes() % 60);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 16), digits);
+		}
+	}
 
-			out.put(':');
+	// Replaces the 16 bytes at src that are not printable ASCII with '.'
+	void h_expand_ascii_bytes(char* dst, const uint8_t* src) noexcept
+	{
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
 
-			h_fmt_two_digit(out, value.seconds() % 60);
+		// Bytes from 0x80 are negative as signed chars, so they fail the first comparison
+		const __m128i is_printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7F)));
 
-			out.put('.');
+		const __m128i chars = _mm_or_si128(_mm_and_si128(is_printable, bytes), _mm_andnot_si128(is_printable, _mm_set1_epi8('.')));
 
-			h_fmt_three_digit(out, value.milliseconds() % 1000);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), chars);
+	}
 
-			out.put('.');
+	// Number of cunits taken by byte_cnt bytes in hex, with a space between each group of group_bytes bytes
+	uint32_t h_hex_column_cunits(uint32_t byte_cnt, uint32_t group_bytes) noexcept
+	{
+		if (byte_cnt == 0)
+			return 0;
 
-			h_fmt_three_digit(out, value.microseconds() % 1000);
+		return byte_cnt * 2 + (group_bytes == 0 ? 0 : (byte_cnt - 1) / group_bytes);
+	}
 
-			out.put('h');
+	// Writes up to 16 bytes in hex to dst, which must have room for 48 cunits. first_index is the position of bytes
+	// in their line, which decides where the spaces between groups go. Returns the end of the written text.
+	char* h_write_hex_chunk(char* dst, const uint8_t* bytes, uint32_t byte_cnt, uint32_t first_index, uint32_t group_bytes, bool is_upper) noexcept
+	{
+		uint8_t tail[16]{};
 
-			if (!is_rightadj(context))
-				out.pad(chars, context);
+		if (byte_cnt != 16)
+		{
+			memcpy(tail, bytes, byte_cnt);
+
+			bytes = tail;
 		}
-		return;
 
-		case 'l':
-			out.put_padded(och::stringview("[[fmt_timespan - specifier 'l' is not yet implemented]]"), context);
+		if (group_bytes == 0)
+		{
+			h_expand_hex_bytes(dst, bytes, is_upper);
 
-			{
-				////[+ -][D+d, ][HHh, ][MMmin, ][SSs, ][MMMms, ]UUUus
-				//int64_t days = value.days();
-				//
-				//uint32_t log10_d = log10(days);
-				//
-				//uint32_t chars = 5; //chars for us;
-				//
-				//if (value.val < 10000000ll)
-				//{
-				//	chars += 4;
-				//}
-				//
-				//
-				//*curr-- = 's';
-				//*curr-- = 'u';
-				//
-				//uint64_t us = value.microseconds() % 1000;
-				//if(us)
-				//	curr = _fmt_reverse_itos(curr, us);
-				//
-				//if (value.val < 10000llu) break;
-				//
-				//*curr-- = ' ';
-				//*curr-- = ',';
-				//
-				//*curr-- = 's';
-				//*curr-- = 'm';
-				//
-				//uint64_t ms = value.milliseconds() % 1000;
-				//if(ms)
-				//	curr = _fmt_reverse_itos(curr, ms);
-				//
-				//if (value.val < 10000000llu) break;
-				//
-				//*curr-- = ' ';
-				//*curr-- = ',';
-				//
-				//*curr-- = 's';
-				//
-				//uint64_t s = value.seconds() % 60;
-				//if (ms)
-				//	curr = _fmt_reverse_itos(curr, s);
-				//
-				//if (value.val < 600000000llu) break;
-				//
-				//*curr-- = ' ';
-				//*curr-- = ',';
-				//
-				//*curr-- = 'n';
-				//*curr-- = 'i';
-				//*curr-- = 'm';
-				//
-				//uint64_t min = value.minutes() % 60;
-				//if (min)
-				//	curr = _fmt_reverse_itos(curr, min);
-				//
-				//if (value.val < 60 * 600000000llu) break;
-				//
-				//*curr-- = ' ';
-				//*curr-- = ',';
-				//
-				//*curr-- = 'h';
-				//uint64_t h = value.hours() % 24;
-				//if (h)
-				//	curr = _fmt_reverse_itos(curr, h);
-				//
-				//if (value.val < 24 * 60 * 600000000llu) break;
-				//
-				//*curr-- = ' ';
-				//*curr-- = ',';
-				//
-				//*curr-- = 'd';
-				//curr = _fmt_reverse_itos(curr, value.days());
-			}
-			return;
+			return dst + byte_cnt * 2;
+		}
 
-		case 'x':
+		char digits[32];
 
-			out.put_padded(och::stringview("[[fmt_timespan - specifier 'x' is not yet implemented]]"), context);
-			return;
+		h_expand_hex_bytes(digits, bytes, is_upper);
 
-		default:
-			out.put_padded(invalid_specifier_msg, context);
-			return;
-		}
+		uint32_t group_pos = first_index % group_bytes;
 
-		uint32_t log10_v = log10(time_value);
+		for (uint32_t i = 0; i != byte_cnt; ++i)
+		{
+			if (group_pos == 0 && first_index + i != 0)
+				*dst++ = ' ';
 
-		uint32_t chars = log10_v + (sign != 0) - utf_surr_count;
+			memcpy(dst, digits + i * 2, 2);
 
-		uint32_t specifier_len = 0;
-		if (specifier)
-			for (uint32_t i = 0; specifier[i]; ++i)
-				++specifier_len;
+			dst += 2;
 
-		chars += specifier_len;
+			if (++group_pos == group_bytes)
+				group_pos = 0;
+		}
+
+		return dst;
+	}
+
+	// Writes up to 16 bytes to dst, with the ones that are not printable ASCII replaced by '.'
+	char* h_write_ascii_chunk(char* dst, const uint8_t* bytes, uint32_t byte_cnt) noexcept
+	{
+		uint8_t tail[16]{};
+
+		if (byte_cnt != 16)
+		{
+			memcpy(tail, bytes, byte_cnt);
+
+			bytes = tail;
+		}
+
+		char chars[16];
+
+		h_expand_ascii_bytes(chars, bytes);
+
+		memcpy(dst, chars, byte_cnt);
+
+		return dst + byte_cnt;
+	}
+
+	void h_put_hex_bytes(output_buffer& out, const uint8_t* bytes, uint32_t byte_cnt, uint32_t group_bytes, bool is_upper) noexcept
+	{
+		for (uint32_t i = 0; i < byte_cnt; i += 16)
+		{
+			char text[48];
+
+			const char* const text_end = h_write_hex_chunk(text, bytes + i, byte_cnt - i < 16 ? byte_cnt - i : 16, i, group_bytes, is_upper);
+
+			out.put(text, static_cast<uint32_t>(text_end - text));
+		}
+	}
+
+	void h_hexdump_into(output_buffer& out, och::range<const uint8_t> bytes, const hexdump_options& options) noexcept
+	{
+		const uint32_t bytes_per_line = options.bytes_per_line == 0 ? 16 : options.bytes_per_line;
+
+		const uint32_t hex_cunits = h_hex_column_cunits(bytes_per_line, options.group_bytes);
+
+		const uint64_t last_offset = options.offset_base + bytes.len();
+
+		const uint32_t offset_digits = last_offset > 0xFFFF'FFFF ? 16 : 8;
+
+		// Lines are assembled in line_buf and put at once, with each piece of up to 48 cunits written into it in turn
+		char line_buf[512];
+
+		for (size_t line_beg = 0; line_beg < bytes.len(); line_beg += bytes_per_line)
+		{
+			const uint8_t* const line = bytes.beg + line_beg;
+
+			const uint32_t line_cnt = static_cast<uint32_t>(bytes.len() - line_beg < bytes_per_line ? bytes.len() - line_beg : bytes_per_line);
+
+			char* curr = line_buf;
+
+			if (options.show_offset)
+			{
+				char offset_digit_buf[16];
+
+				h_expand_hex(offset_digit_buf, options.offset_base + line_beg, options.is_upper);
+
+				memcpy(curr, offset_digit_buf + 16 - offset_digits, offset_digits);
+
+				memcpy(curr + offset_digits, "  ", 2);
+
+				curr += offset_digits + 2;
+			}
+
+			for (uint32_t i = 0; i < line_cnt; i += 16)
+			{
+				if (curr - line_buf > static_cast<ptrdiff_t>(sizeof(line_buf) - 48))
+				{
+					out.put(line_buf, static_cast<uint32_t>(curr - line_buf));
+
+					curr = line_buf;
+				}
+
+				curr = h_write_hex_chunk(curr, line + i, line_cnt - i < 16 ? line_cnt - i : 16, i, options.group_bytes, options.is_upper);
+			}
+
+			if (options.show_ascii)
+			{
+				// Keep the gutter of a short last line aligned with the ones above
+				for (uint32_t i = h_hex_column_cunits(line_cnt, options.group_bytes); i < hex_cunits; ++i)
+				{
+					if (curr == line_buf + sizeof(line_buf))
+					{
+						out.put(line_buf, sizeof(line_buf));
+
+						curr = line_buf;
+					}
+
+					*curr++ = ' ';
+				}
+
+				for (uint32_t i = 0; i < line_cnt; i += 16)
+				{
+					if (curr - line_buf > static_cast<ptrdiff_t>(sizeof(line_buf) - 48))
+					{
+						out.put(line_buf, static_cast<uint32_t>(curr - line_buf));
+
+						curr = line_buf;
+					}
+
+					if (i == 0)
+					{
+						memcpy(curr, "  |", 3);
+
+						curr += 3;
+					}
+
+					curr = h_write_ascii_chunk(curr, line + i, line_cnt - i < 16 ? line_cnt - i : 16);
+				}
+
+				if (curr - line_buf > static_cast<ptrdiff_t>(sizeof(line_buf) - 2))
+				{
+					out.put(line_buf, static_cast<uint32_t>(curr - line_buf));
+
+					curr = line_buf;
+				}
+
+				*curr++ = '|';
+			}
+
+			// Without the ASCII column nothing above leaves room for the newline, as the hex column may fill line_buf
+			if (curr == line_buf + sizeof(line_buf))
+			{
+				out.put(line_buf, sizeof(line_buf));
+
+				curr = line_buf;
+			}
+
+			*curr++ = '\n';
+
+			out.put(line_buf, static_cast<uint32_t>(curr - line_buf));
+		}
+	}
+
+	enum class escape_mode : uint8_t
+	{
+		json,       // Escapes '"', '\\' and control characters
+		csv,        // Only used to find characters that require a field to be quoted
+		csv_quoted, // Doubles '"'
+		shell,      // Closes, escapes and reopens the single quotes around a string for every '\''
+	};
+
+	bool h_needs_escape(char c, escape_mode mode) noexcept
+	{
+		switch (mode)
+		{
+		case escape_mode::json: return c == '"' || c == '\\' || static_cast<uint8_t>(c) < 0x20;
+		case escape_mode::csv: return c == '"' || c == ',' || c == '\n' || c == '\r';
+		case escape_mode::csv_quoted: return c == '"';
+		case escape_mode::shell: return c == '\'';
+		default: return false;
+		}
+	}
+
+	// Finds the first character in [beg, end) that needs escaping in mode, checking 16 at a time
+	const char* h_find_escaped_char(const char* beg, const char* end, escape_mode mode) noexcept
+	{
+		const __m128i quote = _mm_set1_epi8(mode == escape_mode::shell ? '\'' : '"');
+
+		while (end - beg >= 16)
+		{
+			const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg));
+
+			__m128i hits = _mm_cmpeq_epi8(chars, quote);
+
+			if (mode == escape_mode::json)
+			{
+				// Characters up to 0x1F are the only ones left unchanged by an unsigned max with 0x1F
+				const __m128i control = _mm_set1_epi8(0x1F);
+
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\\')));
+
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_max_epu8(chars, control), control));
+			}
+			else if (mode == escape_mode::csv)
+			{
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chars, _mm_set1_epi8(',')));
+
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')));
+
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')));
+			}
+
+			const uint32_t hit_mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+
+			if (hit_mask != 0)
+			{
+				unsigned long hit_idx;
+
+				_BitScanForward(&hit_idx, hit_mask);
+
+				return beg + hit_idx;
+			}
+
+			beg += 16;
+		}
+
+		while (beg != end && !h_needs_escape(*beg, mode))
+			++beg;
+
+		return beg;
+	}
+
+	// Writes the escape sequence for c, which h_needs_escape reported for mode, to dst. Returns its end.
+	char* h_write_escape(char* dst, char c, escape_mode mode) noexcept
+	{
+		if (mode == escape_mode::csv_quoted)
+		{
+			memcpy(dst, "\"\"", 2);
+
+			return dst + 2;
+		}
+
+		if (mode == escape_mode::shell)
+		{
+			memcpy(dst, "'\\''", 4);
+
+			return dst + 4;
+		}
+
+		*dst++ = '\\';
+
+		switch (c)
+		{
+		case '"':  *dst++ = '"'; break;
+		case '\\': *dst++ = '\\'; break;
+		case '\b': *dst++ = 'b'; break;
+		case '\f': *dst++ = 'f'; break;
+		case '\n': *dst++ = 'n'; break;
+		case '\r': *dst++ = 'r'; break;
+		case '\t': *dst++ = 't'; break;
+		default:
+			memcpy(dst, "u00", 3);
+
+			// Only control characters end up here, so the first hex digit is 0 or 1
+			dst[3] = static_cast<char>('0' + (c >> 4));
+
+			dst[4] = "0123456789abcdef"[c & 0xF];
+
+			dst += 5;
+
+			break;
+		}
+
+		return dst;
+	}
+
+	// Number of cunits the escape sequences in [beg, end) add to its length
+	uint32_t h_escape_growth(const char* beg, const char* end, escape_mode mode) noexcept
+	{
+		uint32_t growth = 0;
+
+		while ((beg = h_find_escaped_char(beg, end, mode)) != end)
+		{
+			char escape[6];
+
+			growth += static_cast<uint32_t>(h_write_escape(escape, *beg, mode) - escape) - 1;
+
+			++beg;
+		}
+
+		return growth;
+	}
+
+	// Copies runs of characters that need no escaping at once and only stops for the ones that do
+	void h_put_escaped(output_buffer& out, const char* beg, const char* end, escape_mode mode) noexcept
+	{
+		while (true)
+		{
+			const char* const run_end = h_find_escaped_char(beg, end, mode);
+
+			if (run_end != beg)
+				out.put(beg, static_cast<uint32_t>(run_end - beg));
+
+			if (run_end == end)
+				return;
+
+			char escape[6];
+
+			out.put(escape, static_cast<uint32_t>(h_write_escape(escape, *run_end, mode) - escape));
+
+			beg = run_end + 1;
+		}
+	}
+
+	// Formats value for one of the escaping specifiers of fmt_utf8_view
+	void h_fmt_escaped(const och::utf8_view& value, escape_mode mode, const parsed_context& context) noexcept
+	{
+		const char* const beg = value.raw_cbegin();
+
+		const char* const end = value.raw_cend();
+
+		// CSV fields are only quoted if they have to be, while shell arguments always are
+		const bool is_quoted = mode == escape_mode::shell || (mode == escape_mode::csv && h_find_escaped_char(beg, end, mode) != end);
+
+		if (mode == escape_mode::csv)
+			mode = escape_mode::csv_quoted;
+
+		const char quote = mode == escape_mode::shell ? '\'' : '"';
+
+		const uint32_t cpoints = context.width == 0 ? 0 : h_text_width(value, context) + h_escape_growth(beg, end, mode) + (is_quoted ? 2 : 0);
 
 		if (is_rightadj(context))
-			out.pad(chars, context);
+			context.output.pad(cpoints, context);
 
-		h_fmt_decimal(out, time_value, log10_v, sign);
+		if (is_quoted)
+			context.output.put(quote);
 
-		if (specifier)
-			out.put(och::stringview(specifier, specifier_len, 1));
+		if (mode == escape_mode::csv_quoted && !is_quoted)
+			context.output.put(beg, static_cast<uint32_t>(end - beg));
+		else
+			h_put_escaped(context.output, beg, end, mode);
+
+		if (is_quoted)
+			context.output.put(quote);
 
 		if (!is_rightadj(context))
-			out.pad(chars, context);
+			context.output.pad(cpoints, context);
 	}
 
-	//TODO implement
-	void fmt_highres_timespan(type_union arg_value, const parsed_context& context) noexcept
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////formatting functions////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void fmt_uint64(type_union arg_value, const parsed_context& context) noexcept
 	{
-		arg_value;
+		uint64_t value = arg_value.u64;
 
-		context.output.put_padded(och::stringview("[[fmt_highres_timespan is not yet implemented]]"), context);
+		h_fmt_integer_base(context.output, value, context, 64);
+	}
 
-		////     ->   microseconds (with format specifier)
-		//// ns  ->   nanoseconds
-		//// us,
-		//// μs  ->   microseconds
-		//// ms  ->   milliseconds
-		//// s   ->   seconds
-		////
-		//// Uppercase letters also write the fitting SI-symbol.
-		////
-		//// For microseconds, U writes [n...]u, while μ writes [n...]μ
-		//
-		//char32_t c = context.format_specifier.codepoint();
-		//
-		//uint32_t utf_surr_count = 0;
-		//
-		//och::highres_timespan value;
-		//
-		//value.val = arg_value.i;
+	void fmt_int64(type_union arg_value, const parsed_context& context) noexcept
+	{
+		int64_t value = arg_value.i64;
+
+		h_fmt_integer_base(context.output, value, context, 64, h_get_sign(value, context));
+	}
+
+	void fmt_uint32(type_union arg_value, const parsed_context& context) noexcept
+	{
+		uint32_t value = arg_value.u32;
+
+		h_fmt_integer_base(context.output, value, context, 32);
+	}
+
+	void fmt_int32(type_union arg_value, const parsed_context& context) noexcept
+	{
+		int32_t value = arg_value.i32;
+
+		h_fmt_integer_base(context.output, value, context, 32, h_get_sign(value, context));
+	}
+
+	void fmt_uint16(type_union arg_value, const parsed_context& context) noexcept
+	{
+		uint16_t value = arg_value.u16;
+
+		h_fmt_integer_base(context.output, value, context, 16);
+	}
+
+	void fmt_int16(type_union arg_value, const parsed_context& context) noexcept
+	{
+		int16_t value = arg_value.i16;
+
+		h_fmt_integer_base(context.output, value, context, 16, h_get_sign(value, context));
+	}
+
+	void fmt_uint8(type_union arg_value, const parsed_context& context) noexcept
+	{
+		uint8_t value = arg_value.u8;
+
+		h_fmt_integer_base(context.output, value, context, 8);
+	}
+
+	void fmt_int8(type_union arg_value, const parsed_context& context) noexcept
+	{
+		int8_t value = arg_value.i8;
+
+		h_fmt_integer_base(context.output, value, context, 8, h_get_sign(value, context));
+	}
+
+	void fmt_utf8_view(type_union arg_value, const parsed_context& context) noexcept
+	{
+		//     ->   as is
+		// j   ->   escaped for the inside of a JSON string
+		// c   ->   as a CSV field, quoted if it contains '"', ',' or line breaks
+		// s   ->   single-quoted for POSIX shells
 		//
-		//char buf[64];
-		//char* curr = buf + 63;
+		// A precision limits the number of codepoints taken from the string, before escaping.
+
+		och::utf8_view value = *(const och::utf8_view*)arg_value.ptr;
+
+		if (value.get_codepoints() > context.precision)
+			value = value.subview(0, context.precision);
+
+		const char32_t specifier = context.format_specifier.codepoint();
+
+		if (specifier == '\0')
+			context.output.put_padded(value, context);
+		else if (specifier == 'j')
+			h_fmt_escaped(value, escape_mode::json, context);
+		else if (specifier == 'c')
+			h_fmt_escaped(value, escape_mode::csv, context);
+		else if (specifier == 's')
+			h_fmt_escaped(value, escape_mode::shell, context);
+		else
+			context.output.put_padded(invalid_specifier_msg, context);
+	}
+
+	void fmt_utf8_string(type_union arg_value, const parsed_context& context) noexcept
+	{
+		och::utf8_view value(*(const och::utf8_string*)arg_value.ptr);
+
+		fmt_utf8_view((const void*)&value, context);
+	}
+
+	void fmt_cstring(type_union arg_value, const parsed_context& context) noexcept
+	{
+		och::utf8_view value(reinterpret_cast<const char*>(arg_value.ptr));
+
+		fmt_utf8_view((const void*)&value, context);
+	}
+
+	void fmt_codepoint(type_union arg_value, const parsed_context& context) noexcept
+	{
+		och::utf8_char value = arg_value.utf_c;
+
+		context.output.put_padded(value, context);
+	}
+
+	void fmt_float(type_union arg_value, const parsed_context& context) noexcept
+	{
+		const uint32_t bits = arg_value.u32;
+
+		const bool is_negative = bits >> 31;
+
+		const uint32_t ieee_exponent = (bits >> 23) & 0xFF;
+
+		const uint32_t ieee_significand = bits & 0x7F'FFFF;
+
+		if (ieee_exponent == 0xFF)
+			h_fmt_nonfinite(ieee_significand != 0, is_negative, context);
+		else if (ieee_exponent == 0)
+			h_fmt_binary_fp(ieee_significand, -149, false, is_negative, context);
+		else
+			h_fmt_binary_fp(ieee_significand | (1 << 23), static_cast<int32_t>(ieee_exponent) - 150, ieee_significand == 0 && ieee_exponent > 1, is_negative, context);
+	}
+
+	void fmt_double(type_union arg_value, const parsed_context& context) noexcept
+	{
+		const uint64_t bits = arg_value.u64;
+
+		const bool is_negative = bits >> 63;
+
+		const uint32_t ieee_exponent = static_cast<uint32_t>(bits >> 52) & 0x7FF;
+
+		const uint64_t ieee_significand = bits & 0xF'FFFF'FFFF'FFFF;
+
+		if (ieee_exponent == 0x7FF)
+			h_fmt_nonfinite(ieee_significand != 0, is_negative, context);
+		else if (ieee_exponent == 0)
+			h_fmt_binary_fp(ieee_significand, -1074, false, is_negative, context);
+		else
+			h_fmt_binary_fp(ieee_significand | (1ull << 52), static_cast<int32_t>(ieee_exponent) - 1075, ieee_significand == 0 && ieee_exponent > 1, is_negative, context);
+	}
+
+	// Formatted text of the most recent date a thread formatted, so that dates only differing in their millisecond can be
+	// written by patching the digits of each L field instead of formatting every field again.
+	struct date_text_cache
+	{
+		static constexpr uint32_t MAX_FORMAT_CUNITS = 64;
+
+		static constexpr uint32_t MAX_TEXT_CUNITS = 256;
+
+		static constexpr uint32_t MAX_MILLISECOND_FIELDS = 4;
+
+		char format[MAX_FORMAT_CUNITS];
+
+		uint32_t format_cunits;
+
+		uint16_t fields[7]; // All members of the date except the millisecond, which comes last
+
+		uint16_t millisecond;
+
+		uint16_t millisecond_offsets[MAX_MILLISECOND_FIELDS];
+
+		uint32_t millisecond_cnt;
+
+		uint32_t text_cunits;
+
+		uint32_t text_cpoints;
+
+		bool is_valid;
+
+		bool is_cacheable;
+
+		char text[MAX_TEXT_CUNITS];
+	};
+
+	thread_local date_text_cache date_cache;
+
+	range<char> h_null_sink_reserve([[maybe_unused]] void* userdata, [[maybe_unused]] uint32_t min_cunits) noexcept
+	{
+		return { nullptr, nullptr };
+	}
+
+	void h_null_sink_commit([[maybe_unused]] void* userdata, [[maybe_unused]] range<char> written) noexcept {}
+
+	// Mirrors the loop in h_fmt_date_fields, returning the number of cunits up to the terminating '}'
+	uint32_t h_date_format_cunits(const char* format) noexcept
+	{
+		const char* fmt = format;
+
+		for (char c = *fmt; c != '}'; c = *++fmt)
+			if (c == 'x')
+				++fmt;
+
+		return static_cast<uint32_t>(fmt - format);
+	}
+
+	uint32_t h_date_cpoints(const och::date& value, const char* format) noexcept
+	{
+		const uint16_t year = value.year();
+		const uint16_t month = value.month();
+		const uint16_t weekday = value.weekday();
+		const uint16_t monthday = value.monthday();
+		const uint16_t hour = value.hour();
+		const uint16_t minute = value.minute();
+		const uint16_t second = value.second();
+		const uint16_t millisecond = value.millisecond();
+
+		uint32_t cpoints = 0;
+
+		const char* fmt = format;
+
+		for (char c = *fmt; c != '}'; c = *++fmt)
+			switch (c)
+			{
+			case 'y':
+				cpoints += log10(year); 	break;
+			case 'Y':
+				cpoints += year >= 10000 ? 5 : 4; break;
+			case 'm':
+				cpoints += month >= 10 ? 2 : 1; break;
+			case 'N':
+				cpoints += static_cast<uint32_t>(strlen(months + static_cast<ptrdiff_t>(month - 1) * 10)); break;
+			case 'd':
+				cpoints += 1 + (monthday >= 10); break;
+			case 'W':
+				cpoints += static_cast<uint32_t>(strlen(weekdays + static_cast<ptrdiff_t>(weekday) * 10)); break;
+			case 'i':
+				cpoints += 1 + (hour >= 10); break;
+			case 'j':
+				cpoints += 1 + (minute >= 10); break;
+			case 'k':
+				cpoints += 1 + (second >= 10); break;
+			case 'l':
+				cpoints += millisecond >= 100 ? 3 : millisecond >= 10 ? 2 : 1; break;
+			case 'D':
+			case 'I':
+			case 'J':
+			case 'K':
+			case 'M':
+				cpoints += 2; break;
+			case 'L':
+			case 'w':
+			case 'n':
+				cpoints += 3; break;
+			case 'u':
+				cpoints += value.is_utc() ? 1 : 3; break;
+			case 'U':
+				cpoints += value.is_utc() ? 0 : 2; break;
+			case 's':
+			case 'S':
+				if ((c != 's') ^ (value.is_utc())) //Next char is inactive
+				{
+					if (*++fmt == 'x')
+						++fmt;
+
+					while (is_utf8_surr(fmt[1]))
+						++fmt;
+				}
+				break;
+			case 'x':
+				c = *++fmt; //Fallthrough...
+			default:
+				cpoints += !is_utf8_surr(c); break;
+			}
+
+		return cpoints;
+	}
+
+	// Writes the fields of value as described by format. If cache is not nullptr, the offsets of the L fields are
+	// recorded in it, and it is marked as not cacheable if format contains fields that do not have a fixed width.
+	void h_fmt_date_fields(output_buffer& out, const och::date& value, const char* format, date_text_cache* cache) noexcept
+	{
+#define OCH_FMT_2DIGIT(x) if(c & 0x20) { if(x >= 10) out.put((char)('0' + x / 10)); out.put((char)('0' + x % 10)); } else { out.put((char)('0' + x / 10)); out.put((char)('0' + x % 10)); }
+
+		const uint16_t year = value.year();
+		const uint16_t month = value.month();
+		const uint16_t weekday = value.weekday();
+		const uint16_t monthday = value.monthday();
+		const uint16_t hour = value.hour();
+		const uint16_t minute = value.minute();
+		const uint16_t second = value.second();
+		const uint16_t millisecond = value.millisecond();
+
+		for (char c = *format; c != '}'; c = *++format)
+			switch (c)
+			{
+			case 'y':
+				h_fmt_decimal(out, year, log10(year));
+				break;
+
+			case 'Y':
+				h_fmt_decimal(out, year, log10(year));
+				for (int i = log10(year); i != 4; ++i)
+					out.put('0');
+				break;
+
+			case 'm':
+			case 'M':
+				OCH_FMT_2DIGIT(month);
+				break;
+
+			case 'n':
+				for (int i = 0; i != 3; ++i)
+					out.put(months[(month - 1) * 10 + i]);
+				break;
+
+			case 'N':
+				out.put(och::stringview(months + (ptrdiff_t)(month - 1) * 10));
+				break;
+
+			case 'd':
+			case 'D':
+				OCH_FMT_2DIGIT(monthday);
+				break;
+
+			case 'w':
+				for(int i = 0; i != 3; ++i)
+					out.put(weekdays[weekday * 10 + i]);
+				break;
+
+			case 'W':
+				out.put(och::stringview(weekdays + (ptrdiff_t)weekday * 10));
+				break;
+
+			case 'i':
+			case 'I':
+				OCH_FMT_2DIGIT(hour);
+				break;
+
+			case 'j':
+			case 'J':
+				OCH_FMT_2DIGIT(minute);
+				break;
+
+			case 'k':
+			case 'K':
+				OCH_FMT_2DIGIT(second);
+				break;
+
+			case 'l':
+				if (cache != nullptr)
+					cache->is_cacheable = false;
+
+				h_fmt_decimal(out, millisecond, log10(millisecond));
+				break;
+
+			case 'L':
+				if (cache != nullptr && cache->millisecond_cnt != date_text_cache::MAX_MILLISECOND_FIELDS)
+					cache->millisecond_offsets[cache->millisecond_cnt++] = static_cast<uint16_t>(out.buffer.beg - cache->text);
+				else if (cache != nullptr)
+					cache->is_cacheable = false;
+
+				h_fmt_three_digit(out, millisecond);
+				break;
+
+			case 'u':
+				if (!value.is_utc())
+				{
+					out.put(value.utc_offset_is_negative() ? '-' : '+');
+					h_fmt_two_digit(out, value.utc_offset_hours());
+				}
+				else
+					out.put('Z');
+				break;
+
+			case 'U':
+				if (!value.is_utc())
+					h_fmt_two_digit(out, value.utc_offset_minutes());
+				break;
+
+			case 's':
+			case 'S':
+				if ((c != 's') ^ (value.is_utc())) //Next char is inactive
+				{
+					if (*++format == 'x')
+						++format;
+
+					while (is_utf8_surr(format[1]))
+						++format;
+				}
+				break;
+
+			case 'x':
+				c = *++format;//Fallthrough...
+			default:
+				out.put(c);
+				break;
+			}
+
+#undef OCH_FMT_2DIGIT
+	}
+
+	// Formats value into cache, returning false if the text does not fit or cannot be patched
+	bool h_fill_date_cache(date_text_cache& cache, const och::date& value, const char* format, uint32_t format_cunits) noexcept
+	{
+		cache.is_valid = false;
+
+		if (format_cunits > date_text_cache::MAX_FORMAT_CUNITS)
+			return false;
+
+		cache.millisecond_cnt = 0;
+
+		cache.is_cacheable = true;
+
+		const fmt_sink null_sink{ h_null_sink_reserve, h_null_sink_commit, nullptr, nullptr };
+
+		output_buffer text_out(null_sink);
+
+		text_out.buffer = range<char>(cache.text, date_text_cache::MAX_TEXT_CUNITS);
+
+		text_out.window_beg = cache.text;
+
+		h_fmt_date_fields(text_out, value, format, &cache);
+
+		if (text_out.is_truncated || !cache.is_cacheable)
+			return false;
+
+		cache.text_cunits = static_cast<uint32_t>(text_out.buffer.beg - cache.text);
+
+		cache.text_cpoints = 0;
+
+		for (uint32_t i = 0; i != cache.text_cunits; ++i)
+			cache.text_cpoints += !is_utf8_surr(cache.text[i]);
+
+		memcpy(cache.format, format, format_cunits);
+
+		cache.format_cunits = format_cunits;
+
+		memcpy(cache.fields, &value, sizeof(cache.fields));
+
+		cache.millisecond = value.millisecond();
+
+		cache.is_valid = true;
+
+		return true;
+	}
+
+	void fmt_date(type_union arg_value, const parsed_context& context) noexcept
+	{
+		//          [y]yyyy-mm-dd, hh:mm:ss.mmm
+		// d   ->   [y]yyyy-mm-dd
+		// t   ->   hh:mm:ss.mmm : hh:mm:ss:mmm
+		// u   ->   is_utc ? [y]yyyy-mm-ddThh:mm:ss.mmmZ : [y]yyyy-mm-ddThh:mm:ss.mmm+-hh:mm
+		// x   ->   custom format:
+		//          +-------------------------------------------------------------------------------------------+
+		//          | y   ->   year														                        |
+		//          | m   ->   month, w/o leading zero										                    |
+		//          | n   ->   short monthname (Jan, Feb, ...)								                    |
+		//          | d   ->   monthday, w/o leading zero									                    |
+		//          | w   ->   short weekday (Mon, Tue, ...)								                    |
+		//          | i   ->   hour, w/o leading zero										                    |
+		//          | j   ->   minute, w/o leading zero									                        |
+		//          | k   ->   second, w/o leading zero									                        |
+		//          | l   ->   millisecond, three digits									                    |
+		//          | 	   	   																                    |
+		//          | u   ->   utc-offset hours (+-hh)										                    |
+		//          | U   ->   utc-offset minutes (mm)										                    |
+		//          | s?  ->   utf8_char after s is only printed if date is local			                    |
+		//          | S?  ->   utf8_char after s is only printed if date is utc			                        |
+		//          | x   ->   x is ignored and the next character is printed, even if it is a format-specifier |
+		//          | 																	                        |
+		//          | Capital letters (except U) indicate leading zeroes, or full names                         |
+		//          +-------------------------------------------------------------------------------------------+
+
+		const och::date& value = *reinterpret_cast<const och::date*>(arg_value.ptr);
+
+		output_buffer& out = context.output;
+
+		const char* format;
+
+		if (context.format_specifier == och::utf8_char('\0'))
+			format = "y-M-D, I:J:K.L}";
+		else if (context.format_specifier == och::utf8_char('d'))
+			format = "y-M-D}";
+		else if (context.format_specifier == och::utf8_char('t'))
+			format = "I:J:K.L}";
+		else if (context.format_specifier == och::utf8_char('u'))
+			format = "Y-M-DTI:J:K.Lus:U}";
+		else if (context.format_specifier == och::utf8_char('x'))
+			format = context.raw_context;
+		else
+		{
+			out.put_padded(invalid_specifier_msg, context);
+			return;
+		}
+
+		const uint32_t format_cunits = h_date_format_cunits(format);
+
+		date_text_cache& cache = date_cache;
+
+		const bool is_cached = cache.is_valid
+			&& cache.format_cunits == format_cunits
+			&& memcmp(cache.format, format, format_cunits) == 0
+			&& memcmp(cache.fields, &value, sizeof(cache.fields)) == 0;
+
+		if (is_cached || h_fill_date_cache(cache, value, format, format_cunits))
+		{
+			const uint16_t millisecond = value.millisecond();
+
+			if (cache.millisecond != millisecond)
+			{
+				for (uint32_t i = 0; i != cache.millisecond_cnt; ++i)
+				{
+					char* digits = cache.text + cache.millisecond_offsets[i];
+
+					digits[0] = static_cast<char>('0' + millisecond / 100);
+
+					memcpy(digits + 1, two_digit_lut + (millisecond % 100) * 2, 2);
+				}
+
+				cache.millisecond = millisecond;
+			}
+
+			const uint32_t text_width = is_display_width(context) ? _utf8_display_width(cache.text, cache.text_cunits) : cache.text_cpoints;
+
+			if (is_rightadj(context))
+				out.pad(text_width, context);
+
+			out.put(cache.text, cache.text_cunits);
+
+			if (!is_rightadj(context))
+				out.pad(text_width, context);
+
+			return;
+		}
+
+		const uint32_t cpoints = h_date_cpoints(value, format);
+
+		if (is_rightadj(context))
+			out.pad(cpoints, context);
+
+		h_fmt_date_fields(out, value, format, nullptr);
+
+		if (!is_rightadj(context))
+			out.pad(cpoints, context);
+	}
+
+	//TODO improve (Not happy)
+	void fmt_timespan(type_union arg_value, const parsed_context& context) noexcept
+	{
+		//     ->   appropriate format (with format specifier)
+		// d   ->   days
+		// h   ->   hours
+		// min ->   minutes
+		// s   ->   seconds
+		// ms  ->   milliseconds
+		// us,
+		// sμ  ->  microseconds
+		// l   ->  combination of all units which are greater than zero for the given timespan, separated by commas and with
+		//         their SI-symbols. Uppercase also prints units that are zero.
+		// x   ->  custom format, composed of the aforementioned letters. Other formatting rules are equivalent to fmt_date
+		//
+		// Uppercase letters also write the fitting SI-symbol.
+		//
+		// For microseconds, U writes [n...]u, while μ writes [n...]μ
+
+		och::timespan value;
+
+		value.val = arg_value.i64;
+		
+		output_buffer& out = context.output;
+
+		char sign = h_get_sign(value.val, context);
+
+		if (value.val < 0)
+			value.val = -value.val;
+
+		char32_t c = context.format_specifier.codepoint();
+
+		uint32_t utf_surr_count = 0;
+
+		const char* specifier = nullptr;
+
+		int64_t time_value;
+
+		switch (c)
+		{
+		case '\0':
+			if (value.val < 10000ll && value.val > -10000ll)
+			{
+				if (is_rightadj(context))
+					out.pad(5 + (sign != 0), context);
+
+				if (sign)
+					out.put(sign);
+
+				h_fmt_three_digit(out, value.microseconds());
+				out.put('u');
+				out.put('s');
+
+				if (!is_rightadj(context))
+					out.pad(5 + (sign != 0), context);
+			}
+			else if (value.val < 10000000ll && value.val > -10000000ll)
+			{
+				if (is_rightadj(context))
+					out.pad(9 + (sign != 0), context);
+
+				if (sign)
+					out.put(sign);
+
+				h_fmt_three_digit(out, value.milliseconds());
+
+				out.put('.');
+
+				h_fmt_three_digit(out, value.microseconds() % 1000);
+
+				out.put('m');
+				out.put('s');
+
+				if (!is_rightadj(context))
+					out.pad(9 + (sign != 0), context);
+			}
+			else if (value.val < 600000000ll && value.val > -600000000ll)
+			{
+				if (is_rightadj(context))
+					out.pad(7 + (sign != 0), context);
+
+				h_fmt_two_digit(out, value.seconds());
+
+				out.put('.');
+
+				h_fmt_three_digit(out, value.milliseconds() % 1000);
+
+				out.put('s');
+
+				if (!is_rightadj(context))
+					out.pad(7 + (sign != 0), context);
+			}
+			else if (value.val < 60 * 600000000ll && value.val > -60 * 600000000ll)
+			{
+				if (is_rightadj(context))
+					out.pad(12 + (sign != 0), context);
+
+				h_fmt_two_digit(out, value.minutes());
+
+				out.put(':');
+
+				h_fmt_two_digit(out, value.seconds() % 60);
+
+				out.put('.');
+
+				h_fmt_three_digit(out, value.milliseconds() % 1000);
+
+				out.put('m');
+				out.put('i');
+				out.put('n');
+
+				if (!is_rightadj(context))
+					out.pad(12 + (sign != 0), context);
+			}
+			else
+			{
+				int64_t days = value.days();
+
+				uint32_t log10_d = log10(days);
+
+				uint32_t chars = 6 + (days ? log10_d + 4 : 0) + (sign != 0);
+
+				if (is_rightadj(context))
+					out.pad(chars, context);
+
+				if (sign)
+					out.put(sign);
+
+				if (days)
+				{
+					h_fmt_decimal(out, value.days(), log10_d);
+
+					out.put('d');
+					out.put(' ');
+					out.put('+');
+					out.put(' ');
+				}
+
+				h_fmt_two_digit(out, value.hours() % 24);
+
+				out.put(':');
+
+				h_fmt_two_digit(out, value.minutes() % 60);
+
+				if (!is_rightadj(context))
+					out.pad(chars, context);
+			}
+			return;
+
+		case 'D':
+			specifier = "d";
+		case 'd':
+			time_value = value.days();
+			break;
+
+		case 'H':
+			specifier = "h";
+		case 'h':
+			time_value = value.hours();
+			break;
+
+		case 'M':
+			if (!context.raw_context)
+			{
+				out.put_padded(invalid_specifier_msg, context);
+
+				return;
+			}
+			else if (context.raw_context[0] == 'S')
+			{
+				specifier = "ms";
+
+				time_value = value.milliseconds();
+			}
+			else if (context.raw_context[0] == 'I' && context.raw_context[1] == 'N')
+			{
+				specifier = "min";
+
+				time_value = value.minutes();
+			}
+			else
+			{
+				out.put_padded(invalid_specifier_msg, context);
+
+				return;
+			}
+			break;
+		case 'm':
+			if (!context.raw_context)
+			{
+				out.put_padded(invalid_specifier_msg, context);
+
+				return;
+			}
+			else if (context.raw_context[0] == 's')
+				time_value = value.milliseconds();
+			else if (context.raw_context[0] == 'i' && context.raw_context[1] == 'n')
+				time_value = value.minutes();
+			else
+			{
+				out.put_padded(invalid_specifier_msg, context);
+
+				return;
+			}
+			break;
+
+		case 'S':
+			specifier = "s";
+		case 's':
+			time_value = value.seconds();
+			break;
+
+		case U'μ':
+			specifier = reinterpret_cast<const char*>(u8"μs");
+			time_value = value.microseconds();
+			++utf_surr_count;
+			break;
+
+		case 'U':
+			specifier = "us";
+		case 'u':
+			time_value = value.microseconds();
+			break;
+
+		case 'L':
+		{
+			//[+ -][D+d, ]HH:MM:SS.MMM.UUU
+
+			int64_t days = value.days();
+
+			uint32_t log10_d = log10(days);
+
+			uint32_t day_chars = days ? 4 + log10_d : 0;
+
+			uint32_t chars = 17 + day_chars + (sign != 0);
+
+			if (is_rightadj(context))
+				out.pad(chars, context);
+
+			if (sign)
+				out.put(sign);
+
+			if (days)
+			{
+				h_fmt_decimal(out, value.days(), log10_d);
+
+				out.put('d');
+				out.put(' ');
+				out.put('+');
+				out.put(' ');
+			}
+
+			h_fmt_two_digit(out, value.hours() % 24);
+
+			out.put(':');
+
+			h_fmt_two_digit(out, value.minutes() % 60);
+
+			out.put(':');
+
+			h_fmt_two_digit(out, value.seconds() % 60);
+
+			out.put('.');
+
+			h_fmt_three_digit(out, value.milliseconds() % 1000);
+
+			out.put('.');
+
+			h_fmt_three_digit(out, value.microseconds() % 1000);
+
+			out.put('h');
+
+			if (!is_rightadj(context))
+				out.pad(chars, context);
+		}
+		return;
+
+		case 'l':
+			out.put_padded(och::stringview("[[fmt_timespan - specifier 'l' is not yet implemented]]"), context);
+
+			{
+				////[+ -][D+d, ][HHh, ][MMmin, ][SSs, ][MMMms, ]UUUus
+				//int64_t days = value.days();
+				//
+				//uint32_t log10_d = log10(days);
+				//
+				//uint32_t chars = 5; //chars for us;
+				//
+				//if (value.val < 10000000ll)
+				//{
+				//	chars += 4;
+				//}
+				//
+				//
+				//*curr-- = 's';
+				//*curr-- = 'u';
+				//
+				//uint64_t us = value.microseconds() % 1000;
+				//if(us)
+				//	curr = _fmt_reverse_itos(curr, us);
+				//
+				//if (value.val < 10000llu) break;
+				//
+				//*curr-- = ' ';
+				//*curr-- = ',';
+				//
+				//*curr-- = 's';
+				//*curr-- = 'm';
+				//
+				//uint64_t ms = value.milliseconds() % 1000;
+				//if(ms)
+				//	curr = _fmt_reverse_itos(curr, ms);
+				//
+				//if (value.val < 10000000llu) break;
+				//
+				//*curr-- = ' ';
+				//*curr-- = ',';
+				//
+				//*curr-- = 's';
+				//
+				//uint64_t s = value.seconds() % 60;
+				//if (ms)
+				//	curr = _fmt_reverse_itos(curr, s);
+				//
+				//if (value.val < 600000000llu) break;
+				//
+				//*curr-- = ' ';
+				//*curr-- = ',';
+				//
+				//*curr-- = 'n';
+				//*curr-- = 'i';
+				//*curr-- = 'm';
+				//
+				//uint64_t min = value.minutes() % 60;
+				//if (min)
+				//	curr = _fmt_reverse_itos(curr, min);
+				//
+				//if (value.val < 60 * 600000000llu) break;
+				//
+				//*curr-- = ' ';
+				//*curr-- = ',';
+				//
+				//*curr-- = 'h';
+				//uint64_t h = value.hours() % 24;
+				//if (h)
+				//	curr = _fmt_reverse_itos(curr, h);
+				//
+				//if (value.val < 24 * 60 * 600000000llu) break;
+				//
+				//*curr-- = ' ';
+				//*curr-- = ',';
+				//
+				//*curr-- = 'd';
+				//curr = _fmt_reverse_itos(curr, value.days());
+			}
+			return;
+
+		case 'x':
+
+			out.put_padded(och::stringview("[[fmt_timespan - specifier 'x' is not yet implemented]]"), context);
+			return;
+
+		default:
+			out.put_padded(invalid_specifier_msg, context);
+			return;
+		}
+
+		uint32_t log10_v = log10(time_value);
+
+		uint32_t chars = log10_v + (sign != 0) - utf_surr_count;
+
+		uint32_t specifier_len = 0;
+		if (specifier)
+			for (uint32_t i = 0; specifier[i]; ++i)
+				++specifier_len;
+
+		chars += specifier_len;
+
+		if (is_rightadj(context))
+			out.pad(chars, context);
+
+		h_fmt_decimal(out, time_value, log10_v, sign);
+
+		if (specifier)
+			out.put(och::stringview(specifier, specifier_len, 1));
+
+		if (!is_rightadj(context))
+			out.pad(chars, context);
+	}
+
+	//TODO implement
+	void fmt_highres_timespan(type_union arg_value, const parsed_context& context) noexcept
+	{
+		arg_value;
+
+		context.output.put_padded(och::stringview("[[fmt_highres_timespan is not yet implemented]]"), context);
+
+		////     ->   microseconds (with format specifier)
+		//// ns  ->   nanoseconds
+		//// us,
+		//// μs  ->   microseconds
+		//// ms  ->   milliseconds
+		//// s   ->   seconds
+		////
+		//// Uppercase letters also write the fitting SI-symbol.
+		////
+		//// For microseconds, U writes [n...]u, while μ writes [n...]μ
+		//
+		//char32_t c = context.format_specifier.codepoint();
+		//
+		//uint32_t utf_surr_count = 0;
+		//
+		//och::highres_timespan value;
+		//
+		//value.val = arg_value.i;
+		//
+		//char buf[64];
+		//char* curr = buf + 63;
 		//
 		//switch (c)
 		//{
@@ -1674,350 +3273,2182 @@ namespace och
 		//write_with_padding(out, och::stringview(curr, (uint32_t)(curr - buf), (uint32_t)(curr - buf - utf_surr_count)), context);
 	}
 
-	void fmt_mat4(type_union arg_value, const parsed_context& context) noexcept
-	{
-		h_fmt_mat<4>(arg_value, context);
-	}
+	void fmt_mat4(type_union arg_value, const parsed_context& context) noexcept
+	{
+		h_fmt_mat<4>(arg_value, context);
+	}
+
+	void fmt_mat3(type_union arg_value, const parsed_context& context) noexcept
+	{
+		h_fmt_mat<3>(arg_value, context);
+	}
+
+	void fmt_mat2(type_union arg_value, const parsed_context& context) noexcept
+	{
+		h_fmt_mat<2>(arg_value, context);
+	}
+
+	void fmt_vec4(type_union arg_value, const parsed_context& context) noexcept
+	{
+		h_fmt_vec<4>(arg_value, context);
+	}
+
+	void fmt_vec3(type_union arg_value, const parsed_context& context) noexcept
+	{
+		h_fmt_vec<3>(arg_value, context);
+	}
+
+	void fmt_vec2(type_union arg_value, const parsed_context& context) noexcept
+	{
+		h_fmt_vec<2>(arg_value, context);
+	}
+
+	void fmt_virtual_keycode(type_union arg_value, const parsed_context& context) noexcept
+	{
+		context.output.put(och::stringview(virtual_key_names[arg_value.u8]));
+	}
+
+	void fmt_bytes(type_union arg_value, const parsed_context& context) noexcept
+	{
+		// x / X   ->   hex digits, with a space after every [precision] bytes if a precision is given
+		// h / H   ->   hexdump with offsets and ASCII gutter, as written by hexdump with default options
+
+		const och::range<const uint8_t>& value = *static_cast<const och::range<const uint8_t>*>(arg_value.ptr);
+
+		const char32_t specifier = context.format_specifier.codepoint();
+
+		const bool is_upper = specifier == 'X' || specifier == 'H';
+
+		if (specifier == 'h' || specifier == 'H')
+		{
+			hexdump_options options;
+
+			options.is_upper = is_upper;
+
+			h_hexdump_into(context.output, value, options);
+		}
+		else if (specifier == '\0' || specifier == 'x' || specifier == 'X')
+		{
+			const uint32_t group_bytes = context.precision == 0xFFFF || context.precision == 0x7FFF ? 0 : context.precision;
+
+			const uint32_t cpoints = h_hex_column_cunits(static_cast<uint32_t>(value.len()), group_bytes);
+
+			if (is_rightadj(context))
+				context.output.pad(cpoints, context);
+
+			h_put_hex_bytes(context.output, value.beg, static_cast<uint32_t>(value.len()), group_bytes, is_upper);
+
+			if (!is_rightadj(context))
+				context.output.pad(cpoints, context);
+		}
+		else
+		{
+			context.output.put_padded(invalid_specifier_msg, context);
+		}
+	}
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*////////////////////////////////////////////////////arg_wrapper////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	arg_wrapper create_fmt_arg_wrapper(uint64_t value) noexcept { return { value, fmt_uint64 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(int64_t value) noexcept { return { value, fmt_int64 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(uint32_t value) noexcept { return { value, fmt_uint32 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(int32_t value) noexcept { return { value, fmt_int32 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(uint16_t value) noexcept { return { value, fmt_uint16 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(int16_t value) noexcept { return { value, fmt_int16 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(uint8_t value) noexcept { return { value, fmt_uint8 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(int8_t value) noexcept { return { value, fmt_int8 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(float value) noexcept { return { value, fmt_float }; }
+
+	arg_wrapper create_fmt_arg_wrapper(double value) noexcept { return { value, fmt_double }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const char* value) noexcept { return { (const void*)value, fmt_cstring }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::utf8_string& value) noexcept { return { static_cast<const void*>(&value), fmt_utf8_string }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::utf8_view& value) noexcept { return { static_cast<const void*>(&value), fmt_utf8_view }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::date& value) noexcept { return { static_cast<const void*>(&value), fmt_date }; }
+
+	arg_wrapper create_fmt_arg_wrapper(char32_t value) noexcept { return { och::utf8_char(value), fmt_codepoint }; }
+
+	arg_wrapper create_fmt_arg_wrapper(char value) noexcept { return { och::utf8_char(value), fmt_codepoint }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::utf8_char& value) noexcept { return { value, fmt_codepoint }; }
+
+	arg_wrapper create_fmt_arg_wrapper(och::timespan value) noexcept { return { value.val, fmt_timespan }; }
+
+	arg_wrapper create_fmt_arg_wrapper(och::highres_timespan value) noexcept { return { value.val, fmt_highres_timespan }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::mat4& value) noexcept { return { static_cast<const void*>(&value), fmt_mat4 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::mat3& value) noexcept { return { static_cast<const void*>(&value), fmt_mat3 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::mat2& value) noexcept { return { static_cast<const void*>(&value), fmt_mat2 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::vec4& value) noexcept { return { static_cast<const void*>(&value), fmt_vec4 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::vec3& value) noexcept { return { static_cast<const void*>(&value), fmt_vec3 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::vec2& value) noexcept { return { static_cast<const void*>(&value), fmt_vec2 }; }
+
+	arg_wrapper create_fmt_arg_wrapper(och::vk value) noexcept { return { static_cast<uint8_t>(value), fmt_virtual_keycode }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::range<const uint8_t>& value) noexcept { return { static_cast<const void*>(&value), fmt_bytes }; }
+
+	arg_wrapper create_fmt_arg_wrapper(const och::range<uint8_t>& value) noexcept { return { static_cast<const void*>(&value), fmt_bytes }; }
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////parsed_context//////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	template<typename Argv>
+	void h_parse_context(parsed_context& out, const char*& context, const Argv& argv) noexcept
+	{
+		out.width = h_parse_fmt_index_relative(context, argv);
+
+		if (*context == '.')
+		{
+			++context;
+
+			if (*context != '{' && (*context < '0' || *context > '9'))
+				out.precision = 0x7FFF;
+			else
+				out.precision = h_parse_fmt_index_relative(context, argv);
+		}
+
+		if (*context == '>')
+		{
+			out.flags |= 4;
+
+			++context;
+		}
+		else if (*context == '<')
+			++context;
+
+		if (*context == '!')
+		{
+			out.flags |= 32;
+
+			++context;
+		}
+
+		if (*context == '~')
+		{
+			out.filler = utf8_char(++context);
+
+			context += out.filler.get_codeunits();
+		}
+
+		if (*context == '+')
+		{
+			out.flags |= 1;
+
+			++context;
+		}
+		else if (*context == '_')
+		{
+			out.flags |= 2;
+
+			++context;
+		}
+
+		if (*context != '}')
+		{
+			out.format_specifier = utf8_char(context);
+
+			context += out.format_specifier.get_codeunits();
+		}
+		else
+			out.format_specifier = '\0';
+
+		if (*context != '}')
+			out.raw_context = context;
+
+		for (int32_t opening_bracket_cnt = 1; opening_bracket_cnt; ++context)
+			if (*context == '{')
+				++opening_bracket_cnt;
+			else if (*context == '}')
+				--opening_bracket_cnt;
+	}
+
+	template<typename Argv>
+	void h_apply_placeholder(parsed_context& out, const char* format, const compiled_placeholder& placeholder, const Argv& argv) noexcept
+	{
+		out.width = placeholder.width;
+
+		out.precision = placeholder.precision;
+
+		out.flags = static_cast<uint8_t>(placeholder.flags & ~(compiled_placeholder::WIDTH_FROM_ARG | compiled_placeholder::PRECISION_FROM_ARG));
+
+		if (placeholder.flags & compiled_placeholder::WIDTH_FROM_ARG)
+			out.width = h_arg_u16(argv, out.width);
+
+		if (placeholder.flags & compiled_placeholder::PRECISION_FROM_ARG)
+			out.precision = h_arg_u16(argv, out.precision);
+
+		if (placeholder.filler_offset != compiled_placeholder::NO_OFFSET)
+			out.filler = utf8_char(format + placeholder.filler_offset);
+
+		if (placeholder.specifier_offset != compiled_placeholder::NO_OFFSET)
+			out.format_specifier = utf8_char(format + placeholder.specifier_offset);
+
+		if (placeholder.raw_context_offset != compiled_placeholder::NO_OFFSET)
+			out.raw_context = format + placeholder.raw_context_offset;
+	}
+
+	parsed_context::parsed_context(const char*& context, const och::range<const och::arg_wrapper> argv, output_buffer& output) : argv(argv), output(output)
+	{
+		h_parse_context(*this, context, argv);
+	}
+
+	parsed_context::parsed_context(const char* format, const compiled_placeholder& placeholder, const och::range<const och::arg_wrapper> argv, output_buffer& output) : argv(argv), output(output)
+	{
+		h_apply_placeholder(*this, format, placeholder, argv);
+	}
+
+	parsed_context::parsed_context(const char*& context, const packed_fmt_args& args, output_buffer& output) : output(output)
+	{
+		h_parse_context(*this, context, args);
+	}
+
+	parsed_context::parsed_context(const char* format, const compiled_placeholder& placeholder, const packed_fmt_args& args, output_buffer& output) : output(output)
+	{
+		h_apply_placeholder(*this, format, placeholder, args);
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*//////////////////////////////////////////////////////fmt_sink/////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	och::range<char> h_buffer_sink_reserve(void* userdata, uint32_t min_cunits) noexcept
+	{
+		fmt_buffer_sink_state& state = *static_cast<fmt_buffer_sink_state*>(userdata);
+
+		// The whole buffer is handed out at once, so any further request means it is full
+		if (state.is_reserved || state.buffer.len() < min_cunits)
+			return och::range<char>(nullptr, nullptr);
+
+		state.is_reserved = true;
+
+		return state.buffer;
+	}
+
+	void h_buffer_sink_commit(void* userdata, och::range<char> written) noexcept
+	{
+		static_cast<fmt_buffer_sink_state*>(userdata)->written += static_cast<uint32_t>(written.len());
+	}
+
+	void h_buffer_sink_flush(void* userdata) noexcept
+	{
+		fmt_buffer_sink_state& state = *static_cast<fmt_buffer_sink_state*>(userdata);
+
+		if (state.written < state.buffer.len())
+			state.buffer[state.written] = '\0';
+	}
+
+	och::range<char> h_file_sink_reserve(void* userdata, uint32_t min_cunits) noexcept
+	{
+		fmt_file_sink_state& state = *static_cast<fmt_file_sink_state*>(userdata);
+
+		// Everything handed out before has already been committed, so both buffers can be reused from their start
+		if (state.buffer.len() >= min_cunits)
+			return state.buffer;
+
+		if (state.overflow_cunits < min_cunits)
+		{
+			char* const grown = static_cast<char*>(realloc(state.overflow, min_cunits));
+
+			if (grown == nullptr)
+				return och::range<char>(nullptr, nullptr);
+
+			state.overflow = grown;
+
+			state.overflow_cunits = min_cunits;
+		}
+
+		return och::range<char>(state.overflow, state.overflow_cunits);
+	}
+
+	void h_file_sink_commit(void* userdata, och::range<char> written) noexcept
+	{
+		const fmt_file_sink_state& state = *static_cast<fmt_file_sink_state*>(userdata);
+
+		uint32_t bytes_written;
+
+		ignore_status(och::write_to_file(bytes_written, state.file, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(written.beg), reinterpret_cast<const uint8_t*>(written.end))));
+	}
+
+	void h_file_sink_flush(void* userdata) noexcept
+	{
+		fmt_file_sink_state& state = *static_cast<fmt_file_sink_state*>(userdata);
+
+		free(state.overflow);
+
+		state.overflow = nullptr;
+
+		state.overflow_cunits = 0;
+	}
+
+	// Only selects a sink and publishes no other data, so relaxed ordering suffices
+	std::atomic<print_mode> current_print_mode = print_mode::buffered;
+
+	constexpr uint32_t atomic_print_min_growth = 1024;
+
+	// Buffers larger than this are released after the print that grew them, so that a single huge print does not pin
+	// its memory for the lifetime of the thread
+	constexpr uint32_t atomic_print_retained_cunits = 65536;
+
+	// Collects the complete output of one print call in print_mode::atomic
+	struct atomic_print_buffer
+	{
+		char* beg = nullptr;
+
+		uint32_t used = 0;
+
+		uint32_t capacity = 0;
+
+		bool is_in_use = false; // Set while a print is using the buffer, so that prints from within formatters do not clobber it
+
+		~atomic_print_buffer() noexcept
+		{
+			free(beg);
+		}
+	};
+
+	thread_local atomic_print_buffer atomic_print_state;
+
+	struct atomic_file_sink_state
+	{
+		och::iohandle file;
+
+		atomic_print_buffer& buffer;
+	};
+
+	och::range<char> h_atomic_file_sink_reserve(void* userdata, uint32_t min_cunits) noexcept
+	{
+		atomic_print_buffer& buffer = static_cast<atomic_file_sink_state*>(userdata)->buffer;
+
+		if (buffer.capacity - buffer.used < min_cunits || buffer.capacity == buffer.used)
+		{
+			uint32_t growth = buffer.capacity > atomic_print_min_growth ? buffer.capacity : atomic_print_min_growth;
+
+			if (growth < min_cunits)
+				growth = min_cunits;
+
+			char* const grown = static_cast<char*>(realloc(buffer.beg, buffer.capacity + growth));
+
+			if (grown == nullptr)
+				return och::range<char>(nullptr, nullptr);
+
+			buffer.beg = grown;
+
+			buffer.capacity += growth;
+		}
+
+		return och::range<char>(buffer.beg + buffer.used, buffer.beg + buffer.capacity);
+	}
+
+	void h_atomic_file_sink_commit(void* userdata, och::range<char> written) noexcept
+	{
+		static_cast<atomic_file_sink_state*>(userdata)->buffer.used += static_cast<uint32_t>(written.len());
+	}
+
+	void h_atomic_file_sink_flush(void* userdata) noexcept
+	{
+		const atomic_file_sink_state& state = *static_cast<atomic_file_sink_state*>(userdata);
+
+		atomic_print_buffer& buffer = state.buffer;
+
+		uint32_t bytes_written;
+
+		if (buffer.used != 0)
+			ignore_status(och::write_to_file(bytes_written, state.file, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(buffer.beg), buffer.used)));
+
+		buffer.used = 0;
+
+		if (buffer.capacity > atomic_print_retained_cunits)
+		{
+			free(buffer.beg);
+
+			buffer.beg = nullptr;
+
+			buffer.capacity = 0;
+		}
+	}
+
+	// Formats to out through the sink selected by current_print_mode
+	template<typename Fn>
+	uint32_t h_vprint_file(const och::iohandle& out, Fn&& vprint_to_sink)
+	{
+		if (current_print_mode.load(std::memory_order_relaxed) == print_mode::atomic && !atomic_print_state.is_in_use)
+		{
+			atomic_print_state.is_in_use = true;
+
+			atomic_file_sink_state state{ out, atomic_print_state };
+
+			const uint32_t cunits = vprint_to_sink(fmt_sink{ h_atomic_file_sink_reserve, h_atomic_file_sink_commit, h_atomic_file_sink_flush, &state });
+
+			atomic_print_state.is_in_use = false;
+
+			return cunits;
+		}
+
+		char buffer[fmt_file_sink_state::DEFAULT_BUFFER_CUNITS];
+
+		fmt_file_sink_state state{ out, och::range<char>(buffer) };
+
+		return vprint_to_sink(file_sink(state));
+	}
+
+	constexpr uint32_t string_sink_min_growth = 64;
+
+	och::range<char> h_string_sink_reserve(void* userdata, uint32_t min_cunits) noexcept
+	{
+		och::utf8_string& str = *static_cast<och::utf8_string*>(userdata);
+
+		const uint32_t cunits = str.get_codeunits();
+
+		// Grow geometrically, so that long outputs do not reallocate for every window
+		uint32_t growth = cunits > string_sink_min_growth ? cunits : string_sink_min_growth;
+
+		if (growth < min_cunits)
+			growth = min_cunits;
+
+		if (!str.reserve(cunits + growth))
+			return och::range<char>(nullptr, nullptr);
+
+		// Leave room for the terminating '\0'
+		return och::range<char>(str.raw_end(), str.raw_begin() + str.get_capacity() - 1);
+	}
+
+	void h_string_sink_commit(void* userdata, och::range<char> written) noexcept
+	{
+		uint32_t cpoints = 0;
+
+		for (const char* c = written.beg; c != written.end; ++c)
+			cpoints += (*c & 0xC0) != 0x80;
+
+		static_cast<och::utf8_string*>(userdata)->fmt_commit_raw_write(static_cast<uint32_t>(written.len()), cpoints);
+	}
+
+	// Keeps output in buffer for as long as it fits, and only counts it afterwards
+	struct measure_sink_state
+	{
+		och::range<char> buffer;
+
+		uint32_t cunits = 0;
+
+		uint32_t cpoints = 0;
+
+		bool has_overflowed = false;
+
+		char scratch[128]; // Receives output after an overflow, so that it can still be counted
+
+		char* large_scratch = nullptr; // Takes the place of scratch for reserves larger than it
+
+		uint32_t large_scratch_cunits = 0;
+
+		~measure_sink_state() noexcept
+		{
+			free(large_scratch);
+		}
+	};
+
+	och::range<char> h_measure_sink_reserve(void* userdata, uint32_t min_cunits) noexcept
+	{
+		measure_sink_state& state = *static_cast<measure_sink_state*>(userdata);
+
+		if (!state.has_overflowed && state.buffer.len() - state.cunits >= min_cunits)
+			return och::range<char>(state.buffer.beg + state.cunits, state.buffer.end);
+
+		state.has_overflowed = true;
+
+		if (min_cunits <= sizeof(state.scratch))
+			return och::range<char>(state.scratch);
+
+		if (state.large_scratch_cunits < min_cunits)
+		{
+			char* const grown = static_cast<char*>(realloc(state.large_scratch, min_cunits));
+
+			if (grown == nullptr)
+				return och::range<char>(nullptr, nullptr);
+
+			state.large_scratch = grown;
+
+			state.large_scratch_cunits = min_cunits;
+		}
+
+		return och::range<char>(state.large_scratch, state.large_scratch_cunits);
+	}
+
+	void h_measure_sink_commit(void* userdata, och::range<char> written) noexcept
+	{
+		measure_sink_state& state = *static_cast<measure_sink_state*>(userdata);
+
+		for (const char* c = written.beg; c != written.end; ++c)
+			state.cpoints += (*c & 0xC0) != 0x80;
+
+		state.cunits += static_cast<uint32_t>(written.len());
+	}
+
+	constexpr uint32_t exact_print_stack_cunits = 512;
+
+	// Formats into str with a single allocation of exactly the required size. Output that fits into a stack buffer is
+	// formatted once and copied; anything longer is measured first and then formatted directly into str.
+	template<typename Fn>
+	uint32_t h_vprint_exact(och::utf8_string& str, Fn&& vprint_to_sink)
+	{
+		char stack_buffer[exact_print_stack_cunits];
+
+		measure_sink_state measured;
+
+		measured.buffer = och::range<char>(stack_buffer);
+
+		vprint_to_sink(fmt_sink{ h_measure_sink_reserve, h_measure_sink_commit, nullptr, &measured });
+
+		if (!str.reserve(str.get_codeunits() + measured.cunits))
+			return 0;
+
+		if (!measured.has_overflowed)
+		{
+			if (measured.cunits != 0)
+				memcpy(str.raw_end(), stack_buffer, measured.cunits);
+		}
+		else
+		{
+			fmt_buffer_sink_state exact{ och::range<char>(str.raw_end(), measured.cunits) };
+
+			vprint_to_sink(buffer_sink(exact));
+		}
+
+		str.fmt_commit_raw_write(measured.cunits, measured.cpoints);
+
+		return measured.cunits;
+	}
+
+	template<typename Fn>
+	fmt_size h_vformatted_size(Fn&& vprint_to_sink)
+	{
+		measure_sink_state measured;
+
+		measured.buffer = och::range<char>(nullptr, nullptr);
+
+		vprint_to_sink(fmt_sink{ h_measure_sink_reserve, h_measure_sink_commit, nullptr, &measured });
+
+		return { measured.cunits, measured.cpoints };
+	}
+
+	fmt_sink buffer_sink(fmt_buffer_sink_state& state) noexcept
+	{
+		return { h_buffer_sink_reserve, h_buffer_sink_commit, h_buffer_sink_flush, &state };
+	}
+
+	fmt_sink file_sink(fmt_file_sink_state& state) noexcept
+	{
+		return { h_file_sink_reserve, h_file_sink_commit, h_file_sink_flush, &state };
+	}
+
+	fmt_sink string_sink(och::utf8_string& str) noexcept
+	{
+		return { h_string_sink_reserve, h_string_sink_commit, nullptr, &str };
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////vprint//////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	template<typename Fn>
+	uint32_t h_vprint_to(const fmt_sink& sink, Fn&& emit)
+	{
+		output_buffer output(sink);
+
+		emit(output);
+
+		return output.finalize();
+	}
+
+	void h_format_arg(const och::range<const arg_wrapper>& argv, uint32_t index, const parsed_context& context) noexcept
+	{
+		argv[index].formatter(argv[index].value, context);
+	}
+
+	// Built-in types are called directly, leaving only wrapped arguments to go through a function pointer
+	void h_format_arg(const packed_fmt_args& args, uint32_t index, const parsed_context& context) noexcept
+	{
+		switch (args.types[index])
+		{
+		case fmt_arg_type::u8: fmt_uint8(h_packed_value(args, index), context); return;
+		case fmt_arg_type::u16: fmt_uint16(h_packed_value(args, index), context); return;
+		case fmt_arg_type::u32: fmt_uint32(h_packed_value(args, index), context); return;
+		case fmt_arg_type::u64: fmt_uint64(h_packed_value(args, index), context); return;
+		case fmt_arg_type::i8: fmt_int8(h_packed_value(args, index), context); return;
+		case fmt_arg_type::i16: fmt_int16(h_packed_value(args, index), context); return;
+		case fmt_arg_type::i32: fmt_int32(h_packed_value(args, index), context); return;
+		case fmt_arg_type::i64: fmt_int64(h_packed_value(args, index), context); return;
+		case fmt_arg_type::f32: fmt_float(h_packed_value(args, index), context); return;
+		case fmt_arg_type::f64: fmt_double(h_packed_value(args, index), context); return;
+		case fmt_arg_type::codepoint: fmt_codepoint(h_packed_value(args, index), context); return;
+		case fmt_arg_type::cstring: fmt_cstring(h_packed_value(args, index), context); return;
+		case fmt_arg_type::utf8_string: fmt_utf8_string(h_packed_value(args, index), context); return;
+		case fmt_arg_type::utf8_view: fmt_utf8_view(h_packed_value(args, index), context); return;
+		case fmt_arg_type::wrapper:
+			{
+				arg_wrapper wrapper;
+
+				memcpy(&wrapper, args.values + args.offsets[index], sizeof(wrapper));
+
+				wrapper.formatter(wrapper.value, context);
+
+				return;
+			}
+		default: assert(false); return;
+		}
+	}
+
+	//{[argindex] [:[width] [.precision] [rightadj] [!] [~filler] [signmode] [formatmode]]}
+	template<typename Argv>
+	void h_vprint_into(output_buffer& output, const och::stringview& format, const Argv& argv) noexcept
+	{
+		uint32_t arg_counter = 0;
+
+		const char* last_fmt_end = format.raw_cbegin(), * curr = format.raw_cbegin();
+
+		while (curr < format.raw_cend())
+			if (*curr++ == '{')
+			{
+				if (*curr == '{')
+				{
+					++curr;
+
+					output.put(och::stringview(last_fmt_end, static_cast<uint32_t>(curr - 1 - last_fmt_end), 1));
+
+					last_fmt_end = curr;
+
+					continue;
+				}
+
+				output.put(och::stringview(last_fmt_end, static_cast<uint32_t>(curr - 1 - last_fmt_end), 1));
+
+				uint32_t arg_idx;
+
+				arg_idx = *curr >= '0' && *curr <= '9' ? h_parse_fmt_index(curr) : arg_counter;
+
+				++arg_counter;
+
+				assert(arg_idx < h_arg_cnt(argv));
+
+				assert(*curr == ':' || *curr == '}');
+
+				if (*curr == ':')
+					++curr;
+
+				parsed_context format_context(curr, argv, output);
+
+				h_format_arg(argv, arg_idx, format_context);
+
+				last_fmt_end = curr;
+			}
+
+		output.put(och::stringview(last_fmt_end, static_cast<uint32_t>(curr - last_fmt_end), 1));
+	}
+
+	template<typename Argv>
+	void h_vprint_compiled_into(output_buffer& output, const char* format, const och::range<const compiled_placeholder>& placeholders, const Argv& argv) noexcept
+	{
+		for (const compiled_placeholder* placeholder_ptr = placeholders.beg; placeholder_ptr != placeholders.end; ++placeholder_ptr)
+		{
+			const compiled_placeholder& placeholder = *placeholder_ptr;
+
+			if (placeholder.literal_cunits != 0)
+				output.put(och::stringview(format + placeholder.literal_beg, placeholder.literal_cunits, 1));
+
+			if (placeholder.arg_index == compiled_placeholder::NO_ARG)
+				continue;
+
+			parsed_context format_context(format, placeholder, argv, output);
+
+			h_format_arg(argv, placeholder.arg_index, format_context);
+		}
+	}
+
+	uint32_t vprint(const fmt_sink& sink, const och::stringview& format, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vprint_to(sink, [&](output_buffer& output) { h_vprint_into(output, format, argv); });
+	}
+
+	uint32_t vprint(const fmt_sink& sink, const char* format, const och::range<const compiled_placeholder>& placeholders, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vprint_to(sink, [&](output_buffer& output) { h_vprint_compiled_into(output, format, placeholders, argv); });
+	}
+
+	uint32_t vprint(const fmt_sink& sink, const och::stringview& format, const packed_fmt_args& args)
+	{
+		return h_vprint_to(sink, [&](output_buffer& output) { h_vprint_into(output, format, args); });
+	}
+
+	uint32_t vprint(const fmt_sink& sink, const char* format, const och::range<const compiled_placeholder>& placeholders, const packed_fmt_args& args)
+	{
+		return h_vprint_to(sink, [&](output_buffer& output) { h_vprint_compiled_into(output, format, placeholders, args); });
+	}
+
+
+
+	template<typename Element>
+	void h_fmt_elements(const void* elements, size_t element_cnt, fmt_fn formatter, const parsed_context& context, const och::stringview& separator) noexcept
+	{
+		const Element* typed_elements = static_cast<const Element*>(elements);
+
+		for (size_t i = 0; i != element_cnt; ++i)
+		{
+			if (i != 0)
+				context.output.put(separator);
+
+			formatter(type_union(typed_elements[i]), context);
+		}
+	}
+
+	void h_fmt_element_addresses(const void* elements, uint32_t element_bytes, size_t element_cnt, fmt_fn formatter, const parsed_context& context, const och::stringview& separator) noexcept
+	{
+		const char* element = static_cast<const char*>(elements);
+
+		for (size_t i = 0; i != element_cnt; ++i)
+		{
+			if (i != 0)
+				context.output.put(separator);
+
+			formatter(type_union(static_cast<const void*>(element)), context);
+
+			element += element_bytes;
+		}
+	}
+
+	uint32_t vprint_range(const fmt_sink& sink, const och::stringview& spec, fmt_fn formatter, const void* elements, uint32_t element_bytes, bool elements_by_address, size_t element_cnt, const och::stringview& separator)
+	{
+		return h_vprint_to(sink, [&](output_buffer& output)
+			{
+				const char* curr = spec.raw_cbegin();
+
+				assert(*curr == '{');
+
+				++curr;
+
+				while (*curr >= '0' && *curr <= '9')
+					++curr;
+
+				if (*curr == ':')
+					++curr;
+
+				// The spec is parsed once for all elements, so it cannot refer to arguments for its width or precision
+				const parsed_context context(curr, och::range<const arg_wrapper>(nullptr, nullptr), output);
+
+				if (elements_by_address)
+				{
+					h_fmt_element_addresses(elements, element_bytes, element_cnt, formatter, context, separator);
+
+					return;
+				}
+
+				// Other elements are passed to the formatter as raw bits of their size, which is all the formatters look at
+				switch (element_bytes)
+				{
+				case 1: h_fmt_elements<uint8_t>(elements, element_cnt, formatter, context, separator); break;
+				case 2: h_fmt_elements<uint16_t>(elements, element_cnt, formatter, context, separator); break;
+				case 4: h_fmt_elements<uint32_t>(elements, element_cnt, formatter, context, separator); break;
+				case 8: h_fmt_elements<uint64_t>(elements, element_cnt, formatter, context, separator); break;
+				default: assert(false);
+				}
+			});
+	}
+
+	uint32_t vprint(const och::iohandle& out, const och::stringview& format, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vprint_file(out, [&](const fmt_sink& sink) { return vprint(sink, format, argv); });
+	}
+
+	uint32_t vprint(const och::iohandle& out, const char* format, const och::range<const compiled_placeholder>& placeholders, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vprint_file(out, [&](const fmt_sink& sink) { return vprint(sink, format, placeholders, argv); });
+	}
+
+	uint32_t vprint(const och::iohandle& out, const och::stringview& format, const packed_fmt_args& args)
+	{
+		return h_vprint_file(out, [&](const fmt_sink& sink) { return vprint(sink, format, args); });
+	}
+
+	uint32_t vprint(const och::iohandle& out, const char* format, const och::range<const compiled_placeholder>& placeholders, const packed_fmt_args& args)
+	{
+		return h_vprint_file(out, [&](const fmt_sink& sink) { return vprint(sink, format, placeholders, args); });
+	}
+
+	uint32_t vprint(och::utf8_string& out, const och::stringview& format, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vprint_exact(out, [&](const fmt_sink& sink) { return vprint(sink, format, argv); });
+	}
+
+	uint32_t vprint(och::utf8_string& out, const char* format, const och::range<const compiled_placeholder>& placeholders, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vprint_exact(out, [&](const fmt_sink& sink) { return vprint(sink, format, placeholders, argv); });
+	}
+
+	uint32_t vprint(och::utf8_string& out, const och::stringview& format, const packed_fmt_args& args)
+	{
+		return h_vprint_exact(out, [&](const fmt_sink& sink) { return vprint(sink, format, args); });
+	}
+
+	uint32_t vprint(och::utf8_string& out, const char* format, const och::range<const compiled_placeholder>& placeholders, const packed_fmt_args& args)
+	{
+		return h_vprint_exact(out, [&](const fmt_sink& sink) { return vprint(sink, format, placeholders, args); });
+	}
+
+	uint32_t vprint_range(och::utf8_string& out, const och::stringview& spec, fmt_fn formatter, const void* elements, uint32_t element_bytes, bool elements_by_address, size_t element_cnt, const och::stringview& separator)
+	{
+		return h_vprint_exact(out, [&](const fmt_sink& sink) { return vprint_range(sink, spec, formatter, elements, element_bytes, elements_by_address, element_cnt, separator); });
+	}
+
+	uint32_t hexdump(const fmt_sink& sink, och::range<const uint8_t> bytes, const hexdump_options& options)
+	{
+		return h_vprint_to(sink, [&](output_buffer& output) { h_hexdump_into(output, bytes, options); });
+	}
+
+	uint32_t hexdump(och::utf8_string& out, och::range<const uint8_t> bytes, const hexdump_options& options)
+	{
+		return h_vprint_exact(out, [&](const fmt_sink& sink) { return hexdump(sink, bytes, options); });
+	}
+
+	void fmt_put(const parsed_context& context, const och::stringview& text) noexcept
+	{
+		context.output.put(text);
+	}
+
+	void fmt_put(const parsed_context& context, och::utf8_char c) noexcept
+	{
+		context.output.put(c);
+	}
+
+	void fmt_put_padded(const parsed_context& context, const och::stringview& text) noexcept
+	{
+		context.output.put_padded(text, context);
+	}
+
+	void vprint_nested(const parsed_context& context, const och::stringview& format, const och::range<const arg_wrapper>& argv) noexcept
+	{
+		h_vprint_into(context.output, format, argv);
+	}
+
+	fmt_size vformatted_size(const och::stringview& format, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vformatted_size([&](const fmt_sink& sink) { return vprint(sink, format, argv); });
+	}
+
+	fmt_size vformatted_size(const char* format, const och::range<const compiled_placeholder>& placeholders, const och::range<const arg_wrapper>& argv)
+	{
+		return h_vformatted_size([&](const fmt_sink& sink) { return vprint(sink, format, placeholders, argv); });
+	}
+
+	fmt_size vformatted_size(const och::stringview& format, const packed_fmt_args& args)
+	{
+		return h_vformatted_size([&](const fmt_sink& sink) { return vprint(sink, format, args); });
+	}
+
+	fmt_size vformatted_size(const char* format, const och::range<const compiled_placeholder>& placeholders, const packed_fmt_args& args)
+	{
+		return h_vformatted_size([&](const fmt_sink& sink) { return vprint(sink, format, placeholders, args); });
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////print///////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void set_print_mode(print_mode mode) noexcept
+	{
+		current_print_mode.store(mode, std::memory_order_relaxed);
+	}
+
+	print_mode get_print_mode() noexcept
+	{
+		return current_print_mode.load(std::memory_order_relaxed);
+	}
+
+	void print(const och::iohandle& out, const och::stringview& format)
+	{
+		uint32_t bytes_written;
+		ignore_status(och::write_to_file(bytes_written, out, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(format.raw_cbegin()), reinterpret_cast<const uint8_t*>(format.raw_cend()))));
+	}
+
+	void print(const och::iohandle& out, const char* format)
+	{
+		print(out, och::stringview(format));
+	}
+
+	void print(const och::iohandle& out, const och::utf8_string& format)
+	{
+		print(out, och::stringview(format));
+	}
+
+
+	void print(const och::filehandle& out, const och::stringview& format)
+	{
+		print(out.get_handle_(), format);
+	}
+
+	void print(const och::filehandle& out, const char* format)
+	{
+		print(out.get_handle_(), format);
+	}
+
+	void print(const och::filehandle& out, const och::utf8_string& format)
+	{
+		print(out.get_handle_(), format);
+	}
+
+
+	void print(const och::stringview& format)
+	{
+		print(och::get_stdout(), format);
+	}
+
+	void print(const char* format)
+	{
+		print(och::get_stdout(), format);
+	}
+
+	void print(const och::utf8_string& format)
+	{
+		print(och::get_stdout(), format);
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////sprint//////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	uint32_t sprint(range<char> buf, const stringview& format)
+	{
+		uint32_t wish = format.get_codeunits();
+
+		if (wish <= buf.len())
+		{
+			for (uint32_t i = 0; i != wish; ++i)
+				buf[i] = format.raw_cbegin()[i];
+		}
+
+		return wish;
+	}
+
+	uint32_t sprint(range<char> buf, const char* format)
+	{
+		return sprint(buf, och::stringview(format));
+	}
+
+	uint32_t sprint(range<char> buf, const utf8_string& format)
+	{
+		return sprint(buf, och::stringview(format));
+	}
+
+
+
+	uint32_t sprint(och::utf8_string& buf, const stringview& format)
+	{
+		buf += format;
+
+		return format.get_codeunits();
+	}
+
+	uint32_t sprint(och::utf8_string& buf, const char* format)
+	{
+		uint32_t prev_cunits = buf.get_codeunits();
+
+		buf += format;
+
+		return buf.get_codeunits() - prev_cunits;
+	}
+
+	uint32_t sprint(och::utf8_string& buf, const utf8_string& format)
+	{
+		buf += format;
+
+		return format.get_codeunits();
+	}
+
+
+
+	template<typename T>
+	uint32_t h_sprint_integers(range<char> buf, range<const T> values, char separator) noexcept
+	{
+		char* curr = buf.beg;
+
+		uint64_t required = 0;
+
+		for (size_t i = 0; i != values.len(); ++i)
+		{
+			const T value = values[i];
+
+			bool is_negative = false;
+
+			if constexpr (static_cast<T>(-1) < 0)
+				is_negative = value < 0;
+
+			const uint64_t abs_value = is_negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+
+			const uint32_t digits = log10(abs_value);
+
+			const uint32_t cunits = digits + is_negative + (i != 0);
+
+			// Once a value does not fit, none of the following ones are written either, since required keeps growing
+			if (required + cunits <= buf.len())
+			{
+				if (i != 0)
+					*curr++ = separator;
+
+				if (is_negative)
+					*curr++ = '-';
+
+				h_write_decimal_backwards(curr + digits, abs_value);
+
+				curr += digits;
+			}
+
+			required += cunits;
+		}
+
+		if (curr != buf.end)
+			*curr = '\0';
+
+		// If the output does not fit, the required size includes the terminating '\0', as with sprint
+		return static_cast<uint32_t>(required < buf.len() ? required : required + 1);
+	}
+
+	uint32_t sprint_integers(range<char> buf, range<const uint64_t> values, char separator)
+	{
+		return h_sprint_integers(buf, values, separator);
+	}
+
+	uint32_t sprint_integers(range<char> buf, range<const int64_t> values, char separator)
+	{
+		return h_sprint_integers(buf, values, separator);
+	}
+
+	uint32_t sprint_integers(range<char> buf, range<const uint32_t> values, char separator)
+	{
+		return h_sprint_integers(buf, values, separator);
+	}
+
+	uint32_t sprint_integers(range<char> buf, range<const int32_t> values, char separator)
+	{
+		return h_sprint_integers(buf, values, separator);
+	}
+
+
+
+	template<typename T>
+	uint32_t h_sprint_quantities(range<char> buf, range<const T> values, quantity kind, uint32_t precision, char separator) noexcept
+	{
+		const quantity_format& format = quantity_formats[static_cast<uint8_t>(kind)];
+
+		if (precision > MAX_QUANTITY_PRECISION)
+			precision = MAX_QUANTITY_PRECISION;
+
+		uint64_t max_value = 0;
+
+		for (size_t i = 0; i != values.len(); ++i)
+			if (values[i] > max_value)
+				max_value = values[i];
+
+		const scaled_quantity max_scaled = h_scale_quantity(max_value, format.is_binary, precision);
+
+		const uint32_t unit = max_scaled.unit;
+
+		const uint32_t fraction_digits = unit == 0 ? 0 : precision;
+
+		// With unit and decimals shared by all values, the largest one is also the widest
+		const uint32_t width = h_quantity_cunits(max_scaled, fraction_digits, format);
+
+		char* curr = buf.beg;
+
+		uint64_t required = 0;
+
+		for (size_t i = 0; i != values.len(); ++i)
+		{
+			const uint32_t cunits = width + (i != 0);
+
+			if (required + cunits <= buf.len())
+			{
+				if (i != 0)
+					*curr++ = separator;
+
+				const scaled_quantity q = h_scale_quantity(values[i], format.is_binary, unit, precision);
+
+				const uint32_t padding = width - h_quantity_cunits(q, fraction_digits, format);
+
+				memset(curr, ' ', padding);
+
+				h_write_quantity(curr + padding, q, fraction_digits, format);
+
+				curr += width;
+			}
+
+			required += cunits;
+		}
+
+		if (curr != buf.end)
+			*curr = '\0';
+
+		// If the output does not fit, the required size includes the terminating '\0', as with sprint
+		return static_cast<uint32_t>(required < buf.len() ? required : required + 1);
+	}
+
+	uint32_t sprint_quantities(range<char> buf, range<const uint64_t> values, quantity kind, uint32_t precision, char separator)
+	{
+		return h_sprint_quantities(buf, values, kind, precision, separator);
+	}
+
+	uint32_t sprint_quantities(range<char> buf, range<const uint32_t> values, quantity kind, uint32_t precision, char separator)
+	{
+		return h_sprint_quantities(buf, values, kind, precision, separator);
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*////////////////////////////////////////////////////////parse//////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	uint64_t h_load_eight(const char* src) noexcept
+	{
+		uint64_t chunk;
+
+		memcpy(&chunk, src, 8);
+
+		return chunk;
+	}
+
+	// Whether all eight bytes of chunk are in '0' to '9'
+	bool h_is_eight_digits(uint64_t chunk) noexcept
+	{
+		return ((chunk & 0xF0F0'F0F0'F0F0'F0F0) | (((chunk + 0x0606'0606'0606'0606) & 0xF0F0'F0F0'F0F0'F0F0) >> 4)) == 0x3333'3333'3333'3333;
+	}
+
+	// Converts eight decimal digits to their value with three multiplications, combining pairs, then quads, then both halves
+	uint32_t h_eight_digits_value(uint64_t chunk) noexcept
+	{
+		chunk -= 0x3030'3030'3030'3030;
+
+		chunk = chunk * 10 + (chunk >> 8);
+
+		chunk = ((chunk & 0x0000'00FF'0000'00FF) * (100 + (1000000ull << 32)) + ((chunk >> 16) & 0x0000'00FF'0000'00FF) * (1 + (10000ull << 32))) >> 32;
+
+		return static_cast<uint32_t>(chunk);
+	}
+
+	// Whether all eight bytes of chunk are '0' or '1'
+	bool h_is_eight_bits(uint64_t chunk) noexcept
+	{
+		return (chunk & ~0x0101'0101'0101'0101ull) == 0x3030'3030'3030'3030;
+	}
+
+	// Gathers the low bits of all bytes into one byte, with the first character ending up as the most significant bit
+	uint32_t h_eight_bits_value(uint64_t chunk) noexcept
+	{
+		return static_cast<uint32_t>(((chunk & 0x0101'0101'0101'0101) * 0x8040'2010'0804'0201) >> 56);
+	}
+
+	uint32_t h_hex_digit_value(char c) noexcept
+	{
+		if (static_cast<uint8_t>(c - '0') < 10)
+			return c - '0';
+
+		if (static_cast<uint8_t>((c | 0x20) - 'a') < 6)
+			return (c | 0x20) - 'a' + 10;
+
+		return 16;
+	}
+
+	// Reads the digits at the start of text without a sign. Fails if there are none or if the value exceeds max_value.
+	status h_parse_unsigned(uint64_t& out_value, range<const char>& text, uint32_t base, uint64_t max_value) noexcept
+	{
+		const char* curr = text.beg;
+
+		uint64_t value = 0;
+
+		bool is_overflow = false;
+
+		if (base == 10)
+		{
+			while (text.end - curr >= 8)
+			{
+				const uint64_t chunk = h_load_eight(curr);
+
+				if (!h_is_eight_digits(chunk))
+					break;
+
+				uint64_t hi;
+
+				const uint64_t lo = h_mul128(value, 100000000, hi);
+
+				value = lo + h_eight_digits_value(chunk);
+
+				is_overflow |= hi != 0 || value < lo;
+
+				curr += 8;
+			}
+
+			while (curr != text.end && static_cast<uint8_t>(*curr - '0') < 10)
+			{
+				const uint32_t digit = *curr - '0';
+
+				is_overflow |= value > (~0ull - digit) / 10;
+
+				value = value * 10 + digit;
+
+				++curr;
+			}
+		}
+		else if (base == 2)
+		{
+			while (text.end - curr >= 8)
+			{
+				const uint64_t chunk = h_load_eight(curr);
+
+				if (!h_is_eight_bits(chunk))
+					break;
+
+				is_overflow |= (value >> 56) != 0;
+
+				value = (value << 8) | h_eight_bits_value(chunk);
+
+				curr += 8;
+			}
+
+			while (curr != text.end && (*curr == '0' || *curr == '1'))
+			{
+				is_overflow |= (value >> 63) != 0;
+
+				value = (value << 1) | static_cast<uint64_t>(*curr - '0');
+
+				++curr;
+			}
+		}
+		else if (base == 16)
+		{
+			while (curr != text.end)
+			{
+				const uint32_t digit = h_hex_digit_value(*curr);
+
+				if (digit == 16)
+					break;
+
+				is_overflow |= (value >> 60) != 0;
+
+				value = (value << 4) | digit;
+
+				++curr;
+			}
+		}
+		else
+		{
+			return to_status(error::argument_invalid);
+		}
+
+		if (curr == text.beg)
+			return to_status(error::argument_invalid);
+
+		if (is_overflow || value > max_value)
+			return to_status(error::argument_too_large);
+
+		out_value = value;
+
+		text.beg = curr;
+
+		return {};
+	}
+
+	template<typename T>
+	status h_parse_integer(T& out_value, range<const char>& text, uint32_t base) noexcept
+	{
+		constexpr bool is_signed = static_cast<T>(-1) < static_cast<T>(0);
+
+		constexpr uint64_t max_value = is_signed ? (1ull << (sizeof(T) * 8 - 1)) - 1 : static_cast<T>(~static_cast<T>(0));
+
+		const bool is_negative = is_signed && text.len() != 0 && *text.beg == '-';
+
+		const bool has_sign = text.len() != 0 && (*text.beg == '+' || is_negative);
+
+		range<const char> digits(text.beg + has_sign, text.end);
+
+		uint64_t magnitude;
+
+		check(h_parse_unsigned(magnitude, digits, base, max_value + is_negative));
+
+		out_value = static_cast<T>(is_negative ? 0 - magnitude : magnitude);
+
+		text.beg = digits.beg;
+
+		return {};
+	}
+
+	status parse(uint64_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(uint32_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(uint16_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(uint8_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(int64_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(int32_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(int16_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	status parse(int8_t& out_value, range<const char>& text, uint32_t base) noexcept { return h_parse_integer(out_value, text, base); }
+
+	// A decimal number as read from text, with at most 19 significant digits kept in significand
+	struct parsed_decimal
+	{
+		uint64_t significand;
+
+		int64_t exponent;
+
+		const char* end;
+
+		bool is_negative;
+
+		bool is_truncated; // Digits were dropped from significand, so the value lies in (significand, significand + 1) * 10^exponent
+
+		bool is_nonfinite;
+
+		bool is_nan;
+	};
+
+	// Accumulates the decimal digits at curr into value, eight at a time where possible. Overflow is ignored, since
+	// numbers with more than 19 digits are read again by h_truncate_decimal.
+	const char* h_accumulate_digits(const char* curr, const char* end, uint64_t& value) noexcept
+	{
+		while (end - curr >= 8)
+		{
+			const uint64_t chunk = h_load_eight(curr);
+
+			if (!h_is_eight_digits(chunk))
+				break;
+
+			value = value * 100000000 + h_eight_digits_value(chunk);
+
+			curr += 8;
+		}
+
+		while (curr != end && static_cast<uint8_t>(*curr - '0') < 10)
+			value = value * 10 + static_cast<uint64_t>(*curr++ - '0');
+
+		return curr;
+	}
+
+	// Keeps the first 19 significant digits of [int_beg, int_end) followed by [frac_beg, frac_end)
+	void h_truncate_decimal(parsed_decimal& out, const char* int_beg, const char* int_end, const char* frac_beg, const char* frac_end, int64_t explicit_exponent) noexcept
+	{
+		uint64_t significand = 0;
+
+		uint32_t significant_cnt = 0;
+
+		int64_t exponent = explicit_exponent;
+
+		for (const char* c = int_beg; c != int_end; ++c)
+		{
+			if (significant_cnt == 19)
+			{
+				++exponent;
+
+				continue;
+			}
+
+			significand = significand * 10 + static_cast<uint64_t>(*c - '0');
+
+			significant_cnt += significand != 0;
+		}
+
+		for (const char* c = frac_beg; c != frac_end && significant_cnt != 19; ++c)
+		{
+			significand = significand * 10 + static_cast<uint64_t>(*c - '0');
+
+			significant_cnt += significand != 0;
+
+			--exponent;
+		}
+
+		out.significand = significand;
+
+		out.exponent = exponent;
+
+		out.is_truncated = true;
+	}
+
+	bool h_parse_decimal(parsed_decimal& out, range<const char> text) noexcept
+	{
+		const char* curr = text.beg;
+
+		out.is_negative = curr != text.end && *curr == '-';
+
+		if (curr != text.end && (*curr == '-' || *curr == '+'))
+			++curr;
+
+		out.is_nonfinite = false;
+
+		out.is_nan = false;
+
+		if (text.end - curr >= 3 && (memcmp(curr, "inf", 3) == 0 || memcmp(curr, "nan", 3) == 0))
+		{
+			out.is_nonfinite = true;
+
+			out.is_nan = *curr == 'n';
+
+			out.end = curr + 3;
+
+			return true;
+		}
+
+		uint64_t significand = 0;
+
+		const char* const int_beg = curr;
+
+		curr = h_accumulate_digits(curr, text.end, significand);
+
+		const char* const int_end = curr;
+
+		const char* frac_beg = curr;
+
+		if (curr != text.end && *curr == '.')
+		{
+			frac_beg = ++curr;
+
+			curr = h_accumulate_digits(curr, text.end, significand);
+		}
+
+		const char* const frac_end = curr;
+
+		const int64_t digit_cnt = (int_end - int_beg) + (frac_end - frac_beg);
+
+		if (digit_cnt == 0)
+			return false;
+
+		int64_t explicit_exponent = 0;
+
+		if (curr != text.end && (*curr | 0x20) == 'e')
+		{
+			const char* exp_curr = curr + 1;
+
+			const bool is_negative_exponent = exp_curr != text.end && *exp_curr == '-';
+
+			if (exp_curr != text.end && (*exp_curr == '-' || *exp_curr == '+'))
+				++exp_curr;
+
+			// Without digits, the e is not part of the number
+			if (exp_curr != text.end && static_cast<uint8_t>(*exp_curr - '0') < 10)
+			{
+				while (exp_curr != text.end && static_cast<uint8_t>(*exp_curr - '0') < 10)
+				{
+					// Saturate; anything this large is zero or infinity anyway
+					if (explicit_exponent < 0x1000'0000)
+						explicit_exponent = explicit_exponent * 10 + (*exp_curr - '0');
+
+					++exp_curr;
+				}
+
+				if (is_negative_exponent)
+					explicit_exponent = -explicit_exponent;
+
+				curr = exp_curr;
+			}
+		}
+
+		out.end = curr;
+
+		out.significand = significand;
+
+		out.exponent = explicit_exponent - (frac_end - frac_beg);
+
+		out.is_truncated = false;
+
+		if (digit_cnt > 19)
+		{
+			// Leading zeroes do not count towards the 19 digits that fit into significand
+			const char* first_significant = int_beg;
+
+			while (first_significant != int_end && *first_significant == '0')
+				++first_significant;
+
+			int64_t significant_cnt = int_end - first_significant;
+
+			if (first_significant == int_end)
+			{
+				const char* frac_significant = frac_beg;
+
+				while (frac_significant != frac_end && *frac_significant == '0')
+					++frac_significant;
+
+				significant_cnt = frac_end - frac_significant;
+			}
+			else
+			{
+				significant_cnt += frac_end - frac_beg;
+			}
+
+			if (significant_cnt > 19)
+				h_truncate_decimal(out, int_beg, int_end, frac_beg, frac_end, explicit_exponent);
+		}
+
+		return true;
+	}
+
+	struct binary_fp_format
+	{
+		uint32_t mantissa_bits;
+
+		int32_t min_exponent;
+
+		int32_t infinite_exponent;
+
+		int32_t min_power10; // Anything below rounds to zero
+
+		int32_t max_power10; // Anything above rounds to infinity
+
+		int32_t min_round_to_even_power10;
+
+		int32_t max_round_to_even_power10;
+	};
+
+	constexpr binary_fp_format binary64_format{ 52, -1023, 0x7FF, -342, 308, -4, 23 };
+
+	constexpr binary_fp_format binary32_format{ 23, -127, 0xFF, -64, 38, -17, 10 };
+
+	// Eisel-Lemire: Computes the bits of the binary floating-point value nearest to w * 10^q from a truncated 128-bit
+	// approximation of 10^q. Returns false if q is outside the range of pow10_significands.
+	bool h_eisel_lemire(uint64_t& out_bits, uint64_t w, int64_t q, const binary_fp_format& fmt) noexcept
+	{
+		if (w == 0 || q < fmt.min_power10)
+		{
+			out_bits = 0;
+
+			return true;
+		}
+
+		if (q > fmt.max_power10)
+		{
+			out_bits = static_cast<uint64_t>(fmt.infinite_exponent) << fmt.mantissa_bits;
+
+			return true;
+		}
+
+		if (q < POW10_MIN_EXPONENT)
+			return false;
+
+		uint64_t t_hi = pow10_significands[q - POW10_MIN_EXPONENT][0];
+
+		uint64_t t_lo = pow10_significands[q - POW10_MIN_EXPONENT][1];
+
+		// The table is rounded up, while the algorithm's bounds are established for truncated values, except for
+		// [-27, -1], where 5^-q fits into 64 bits and the rounded-up value is what is needed
+		if (q >= 0 || q < -27)
+		{
+			if (t_lo == 0)
+				--t_hi;
+
+			--t_lo;
+		}
+
+		const uint32_t lz = 64 - h_bit_width(w);
+
+		w <<= lz;
+
+		uint64_t hi;
+
+		uint64_t lo = h_mul128(w, t_hi, hi);
+
+		const uint64_t precision_mask = ~0ull >> (fmt.mantissa_bits + 3);
+
+		// Only if the bits below the ones kept are all set can the low half of the table entry change the result
+		if ((hi & precision_mask) == precision_mask)
+		{
+			uint64_t lo_hi;
+
+			h_mul128(w, t_lo, lo_hi);
+
+			lo += lo_hi;
+
+			if (lo_hi > lo)
+				++hi;
+		}
+
+		const uint32_t upper_bit = static_cast<uint32_t>(hi >> 63);
+
+		const uint32_t shift = upper_bit + 64 - fmt.mantissa_bits - 3;
+
+		uint64_t mantissa = hi >> shift;
+
+		int32_t power2 = static_cast<int32_t>(((152170 + 65536) * q) >> 16) + 63 + static_cast<int32_t>(upper_bit) - static_cast<int32_t>(lz) - fmt.min_exponent;
+
+		if (power2 <= 0)
+		{
+			if (-power2 + 1 >= 64)
+			{
+				out_bits = 0;
+
+				return true;
+			}
+
+			mantissa >>= -power2 + 1;
+
+			mantissa += mantissa & 1;
+
+			mantissa >>= 1;
+
+			// Rounding up may carry into the implicit bit, turning the subnormal into the smallest normal value
+			power2 = mantissa < (1ull << fmt.mantissa_bits) ? 0 : 1;
+
+			out_bits = mantissa | (static_cast<uint64_t>(power2) << fmt.mantissa_bits);
+
+			return true;
+		}
+
+		// Exactly halfway between two values, which is only possible for small q. Round to even instead of up.
+		if (lo <= 1 && q >= fmt.min_round_to_even_power10 && q <= fmt.max_round_to_even_power10 && (mantissa & 3) == 1 && (mantissa << shift) == hi)
+			mantissa &= ~1ull;
+
+		mantissa += mantissa & 1;
+
+		mantissa >>= 1;
+
+		if (mantissa >= (2ull << fmt.mantissa_bits))
+		{
+			mantissa = 1ull << fmt.mantissa_bits;
+
+			++power2;
+		}
+
+		mantissa &= ~(1ull << fmt.mantissa_bits);
+
+		if (power2 >= fmt.infinite_exponent)
+		{
+			out_bits = static_cast<uint64_t>(fmt.infinite_exponent) << fmt.mantissa_bits;
+
+			return true;
+		}
+
+		out_bits = mantissa | (static_cast<uint64_t>(power2) << fmt.mantissa_bits);
+
+		return true;
+	}
+
+	// Falls back to the C runtime for the rare inputs Eisel-Lemire cannot decide
+	double h_strtod(const char* beg, const char* end, bool is_single) noexcept
+	{
+		char stack_buffer[128];
+
+		const size_t cunits = end - beg;
+
+		char* buffer = cunits < sizeof(stack_buffer) ? stack_buffer : static_cast<char*>(malloc(cunits + 1));
+
+		if (buffer == nullptr)
+			return 0.0;
+
+		memcpy(buffer, beg, cunits);
+
+		buffer[cunits] = '\0';
+
+		const double value = is_single ? strtof(buffer, nullptr) : strtod(buffer, nullptr);
+
+		if (buffer != stack_buffer)
+			free(buffer);
+
+		return value;
+	}
+
+	template<typename T>
+	status h_parse_binary_fp(T& out_value, range<const char>& text) noexcept
+	{
+		constexpr bool is_single = sizeof(T) == 4;
+
+		constexpr const binary_fp_format& fmt = is_single ? binary32_format : binary64_format;
+
+		constexpr uint64_t max_exact_significand = 2ull << fmt.mantissa_bits;
+
+		constexpr int64_t max_exact_power10 = is_single ? 10 : 22;
+
+		constexpr double exact_powers10[23]{ 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		parsed_decimal d;
+
+		if (!h_parse_decimal(d, text))
+			return to_status(error::argument_invalid);
+
+		const uint64_t sign_bit = static_cast<uint64_t>(d.is_negative) << (sizeof(T) * 8 - 1);
+
+		uint64_t bits;
+
+		if (d.is_nonfinite)
+		{
+			bits = (static_cast<uint64_t>(fmt.infinite_exponent) << fmt.mantissa_bits) | (static_cast<uint64_t>(d.is_nan) << (fmt.mantissa_bits - 1));
+		}
+		else if (!d.is_truncated && d.significand <= max_exact_significand && d.exponent >= -max_exact_power10 && d.exponent <= max_exact_power10)
+		{
+			// Clinger's fast path: Both the significand and the power of ten are exact, so a single rounding suffices
+			T value = static_cast<T>(d.significand);
+
+			if (d.exponent < 0)
+				value /= static_cast<T>(exact_powers10[-d.exponent]);
+			else
+				value *= static_cast<T>(exact_powers10[d.exponent]);
+
+			out_value = d.is_negative ? -value : value;
+
+			text.beg = d.end;
+
+			return {};
+		}
+		else
+		{
+			bool is_decided = h_eisel_lemire(bits, d.significand, d.exponent, fmt);
+
+			// With dropped digits, the result is only known if both ends of the possible range round the same way
+			if (is_decided && d.is_truncated)
+			{
+				uint64_t upper_bits;
+
+				is_decided = h_eisel_lemire(upper_bits, d.significand + 1, d.exponent, fmt) && upper_bits == bits;
+			}
+
+			if (!is_decided)
+			{
+				const T value = static_cast<T>(h_strtod(text.beg, d.end, is_single));
+
+				if (is_single)
+				{
+					uint32_t single_bits;
+
+					memcpy(&single_bits, &value, 4);
+
+					bits = single_bits & 0x7FFF'FFFF;
+				}
+				else
+				{
+					memcpy(&bits, &value, 8);
+
+					bits &= 0x7FFF'FFFF'FFFF'FFFF;
+				}
+			}
 
-	void fmt_mat3(type_union arg_value, const parsed_context& context) noexcept
-	{
-		h_fmt_mat<3>(arg_value, context);
+			if (bits == static_cast<uint64_t>(fmt.infinite_exponent) << fmt.mantissa_bits)
+				return to_status(error::argument_too_large);
+		}
+
+		bits |= sign_bit;
+
+		if constexpr (is_single)
+		{
+			const uint32_t single_bits = static_cast<uint32_t>(bits);
+
+			memcpy(&out_value, &single_bits, 4);
+		}
+		else
+		{
+			memcpy(&out_value, &bits, 8);
+		}
+
+		text.beg = d.end;
+
+		return {};
 	}
 
-	void fmt_mat2(type_union arg_value, const parsed_context& context) noexcept
+	status parse(double& out_value, range<const char>& text) noexcept
 	{
-		h_fmt_mat<2>(arg_value, context);
+		return h_parse_binary_fp(out_value, text);
 	}
 
-	void fmt_vec4(type_union arg_value, const parsed_context& context) noexcept
+	status parse(float& out_value, range<const char>& text) noexcept
 	{
-		h_fmt_vec<4>(arg_value, context);
+		return h_parse_binary_fp(out_value, text);
 	}
 
-	void fmt_vec3(type_union arg_value, const parsed_context& context) noexcept
+	// Reads exactly digit_cnt decimal digits
+	bool h_parse_fixed_digits(uint32_t& out_value, const char*& curr, const char* end, uint32_t digit_cnt) noexcept
 	{
-		h_fmt_vec<3>(arg_value, context);
+		if (static_cast<uint32_t>(end - curr) < digit_cnt)
+			return false;
+
+		uint32_t value = 0;
+
+		for (uint32_t i = 0; i != digit_cnt; ++i)
+		{
+			if (static_cast<uint8_t>(curr[i] - '0') >= 10)
+				return false;
+
+			value = value * 10 + (curr[i] - '0');
+		}
+
+		out_value = value;
+
+		curr += digit_cnt;
+
+		return true;
 	}
 
-	void fmt_vec2(type_union arg_value, const parsed_context& context) noexcept
+	bool h_is_leap_year(uint32_t year) noexcept
 	{
-		h_fmt_vec<2>(arg_value, context);
+		return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
 	}
 
-	void fmt_virtual_keycode(type_union arg_value, const parsed_context& context) noexcept
+	status parse(date& out_value, range<const char>& text) noexcept
 	{
-		context.output.put(och::stringview(virtual_key_names[arg_value.u8]));
-	}
+		constexpr uint8_t month_days[12]{ 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*////////////////////////////////////////////////////arg_wrapper////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+		constexpr uint8_t weekday_offsets[12]{ 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
 
-	arg_wrapper create_fmt_arg_wrapper(uint64_t value) noexcept { return { value, fmt_uint64 }; }
+		const char* curr = text.beg;
 
-	arg_wrapper create_fmt_arg_wrapper(int64_t value) noexcept { return { value, fmt_int64 }; }
+		uint32_t year = 0;
 
-	arg_wrapper create_fmt_arg_wrapper(uint32_t value) noexcept { return { value, fmt_uint32 }; }
+		while (curr != text.end && static_cast<uint8_t>(*curr - '0') < 10 && curr - text.beg != 5)
+			year = year * 10 + (*curr++ - '0');
 
-	arg_wrapper create_fmt_arg_wrapper(int32_t value) noexcept { return { value, fmt_int32 }; }
+		uint32_t month, monthday;
 
-	arg_wrapper create_fmt_arg_wrapper(uint16_t value) noexcept { return { value, fmt_uint16 }; }
+		if (curr == text.beg || year > 0xFFFF || curr == text.end || *curr++ != '-' || !h_parse_fixed_digits(month, curr, text.end, 2) || curr == text.end || *curr++ != '-' || !h_parse_fixed_digits(monthday, curr, text.end, 2))
+			return to_status(error::argument_invalid);
 
-	arg_wrapper create_fmt_arg_wrapper(int16_t value) noexcept { return { value, fmt_int16 }; }
+		if (month == 0 || month > 12)
+			return to_status(error::argument_invalid);
 
-	arg_wrapper create_fmt_arg_wrapper(uint8_t value) noexcept { return { value, fmt_uint8 }; }
+		const uint32_t days_in_month = month_days[month - 1] + static_cast<uint32_t>(month == 2 && h_is_leap_year(year));
 
-	arg_wrapper create_fmt_arg_wrapper(int8_t value) noexcept { return { value, fmt_int8 }; }
+		if (monthday == 0 || monthday > days_in_month)
+			return to_status(error::argument_invalid);
 
-	arg_wrapper create_fmt_arg_wrapper(float value) noexcept { return { value, fmt_float }; }
+		uint32_t hour = 0, minute = 0, second = 0, millisecond = 0;
 
-	arg_wrapper create_fmt_arg_wrapper(double value) noexcept { return { value, fmt_double }; }
+		const bool has_time = (text.end - curr >= 2 && curr[0] == ',' && curr[1] == ' ') || (curr != text.end && *curr == 'T');
 
-	arg_wrapper create_fmt_arg_wrapper(const char* value) noexcept { return { (const void*)value, fmt_cstring }; }
+		if (has_time)
+		{
+			curr += *curr == 'T' ? 1 : 2;
 
-	arg_wrapper create_fmt_arg_wrapper(const och::utf8_string& value) noexcept { return { static_cast<const void*>(&value), fmt_utf8_string }; }
+			if (!h_parse_fixed_digits(hour, curr, text.end, 2) || curr == text.end || *curr++ != ':' || !h_parse_fixed_digits(minute, curr, text.end, 2) || curr == text.end || *curr++ != ':' || !h_parse_fixed_digits(second, curr, text.end, 2))
+				return to_status(error::argument_invalid);
 
-	arg_wrapper create_fmt_arg_wrapper(const och::utf8_view& value) noexcept { return { static_cast<const void*>(&value), fmt_utf8_view }; }
+			if (curr != text.end && *curr == '.')
+			{
+				++curr;
 
-	arg_wrapper create_fmt_arg_wrapper(const och::date& value) noexcept { return { static_cast<const void*>(&value), fmt_date }; }
+				if (!h_parse_fixed_digits(millisecond, curr, text.end, 3))
+					return to_status(error::argument_invalid);
+			}
 
-	arg_wrapper create_fmt_arg_wrapper(char32_t value) noexcept { return { och::utf8_char(value), fmt_codepoint }; }
+			if (hour > 23 || minute > 59 || second > 59)
+				return to_status(error::argument_invalid);
+		}
 
-	arg_wrapper create_fmt_arg_wrapper(char value) noexcept { return { och::utf8_char(value), fmt_codepoint }; }
+		// Sakamoto's method, giving 0 for Sunday like SYSTEMTIME
+		const uint32_t weekday_year = year - (month < 3);
 
-	arg_wrapper create_fmt_arg_wrapper(const och::utf8_char& value) noexcept { return { value, fmt_codepoint }; }
+		uint16_t weekday_and_offset = static_cast<uint16_t>((weekday_year + weekday_year / 4 - weekday_year / 100 + weekday_year / 400 + weekday_offsets[month - 1] + monthday) % 7);
 
-	arg_wrapper create_fmt_arg_wrapper(och::timespan value) noexcept { return { value.val, fmt_timespan }; }
+		if (curr != text.end && *curr == 'Z')
+		{
+			weekday_and_offset |= 0x8000;
 
-	arg_wrapper create_fmt_arg_wrapper(och::highres_timespan value) noexcept { return { value.val, fmt_highres_timespan }; }
+			++curr;
+		}
+		else if (has_time && curr != text.end && (*curr == '+' || *curr == '-'))
+		{
+			const bool is_negative = *curr++ == '-';
 
-	arg_wrapper create_fmt_arg_wrapper(const och::mat4& value) noexcept { return { static_cast<const void*>(&value), fmt_mat4 }; }
+			uint32_t offset_hours, offset_minutes;
 
-	arg_wrapper create_fmt_arg_wrapper(const och::mat3& value) noexcept { return { static_cast<const void*>(&value), fmt_mat3 }; }
+			if (!h_parse_fixed_digits(offset_hours, curr, text.end, 2) || curr == text.end || *curr++ != ':' || !h_parse_fixed_digits(offset_minutes, curr, text.end, 2) || offset_hours > 23 || offset_minutes > 59)
+				return to_status(error::argument_invalid);
 
-	arg_wrapper create_fmt_arg_wrapper(const och::mat2& value) noexcept { return { static_cast<const void*>(&value), fmt_mat2 }; }
+			weekday_and_offset |= static_cast<uint16_t>((is_negative ? 0x8000 : 0) | (offset_hours << 10) | (offset_minutes << 4));
+		}
 
-	arg_wrapper create_fmt_arg_wrapper(const och::vec4& value) noexcept { return { static_cast<const void*>(&value), fmt_vec4 }; }
+		out_value = date(static_cast<uint16_t>(year), static_cast<uint16_t>(month), weekday_and_offset, static_cast<uint16_t>(monthday), static_cast<uint16_t>(hour), static_cast<uint16_t>(minute), static_cast<uint16_t>(second), static_cast<uint16_t>(millisecond));
 
-	arg_wrapper create_fmt_arg_wrapper(const och::vec3& value) noexcept { return { static_cast<const void*>(&value), fmt_vec3 }; }
+		text.beg = curr;
 
-	arg_wrapper create_fmt_arg_wrapper(const och::vec2& value) noexcept { return { static_cast<const void*>(&value), fmt_mat2 }; }
+		return {};
+	}
 
-	arg_wrapper create_fmt_arg_wrapper(och::vk value) noexcept { return { static_cast<uint8_t>(value), fmt_virtual_keycode }; }
+	// Adds magnitude * unit_ticks plus the fraction given by [frac_beg, frac_end) of unit_ticks to ticks
+	bool h_add_timespan_units(uint64_t& ticks, uint64_t magnitude, const char* frac_beg, const char* frac_end, uint64_t unit_ticks) noexcept
+	{
+		uint64_t hi;
 
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////parsed_context//////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+		const uint64_t whole = h_mul128(magnitude, unit_ticks, hi);
 
-	parsed_context::parsed_context(const char*& context, const och::range<const och::arg_wrapper> argv, output_buffer& output) : argv(argv), output(output)
-	{
-		width = h_parse_fmt_index_relative(context, argv);
+		if (hi != 0 || whole + ticks < whole)
+			return false;
 
-		if (*context == '.')
-		{
-			++context;
+		ticks += whole;
 
-			if (*context != '{' && (*context < '0' || *context > '9'))
-				precision = 0x7FFF;
-			else
-				precision = h_parse_fmt_index_relative(context, argv);
-		}
+		// Digits beyond the resolution of 100ns are truncated
+		uint64_t scale = unit_ticks;
 
-		if (*context == '>')
+		for (const char* c = frac_beg; c != frac_end && scale >= 10; ++c)
 		{
-			flags |= 4;
+			ticks += (*c - '0') * (scale / 10);
 
-			++context;
+			scale /= 10;
 		}
-		else if (*context == '<')
-			++context;
 
-		if (*context == '~')
-		{
-			filler = utf8_char(++context);
+		return true;
+	}
 
-			context += filler.get_codeunits();
-		}
+	status parse(timespan& out_value, range<const char>& text) noexcept
+	{
+		constexpr uint64_t TICKS_US = 10;
 
-		if (*context == '+')
-		{
-			flags |= 1;
+		constexpr uint64_t TICKS_MS = 1000 * TICKS_US;
 
-			++context;
-		}
-		else if (*context == '_')
-		{
-			flags |= 2;
+		constexpr uint64_t TICKS_S = 1000 * TICKS_MS;
 
-			++context;
-		}
+		constexpr uint64_t TICKS_MIN = 60 * TICKS_S;
 
-		if (*context != '}')
-		{
-			format_specifier = utf8_char(context);
+		constexpr uint64_t TICKS_H = 60 * TICKS_MIN;
 
-			context += format_specifier.get_codeunits();
-		}
-		else
-			format_specifier = '\0';
+		constexpr uint64_t TICKS_D = 24 * TICKS_H;
 
-		if (*context != '}')
-			raw_context = context;
+		range<const char> rest = text;
 
-		for (int32_t opening_bracket_cnt = 1; opening_bracket_cnt; ++context)
-			if (*context == '{')
-				++opening_bracket_cnt;
-			else if (*context == '}')
-				--opening_bracket_cnt;
-	}
+		const bool is_negative = rest.len() != 0 && *rest.beg == '-';
 
+		if (rest.len() != 0 && (*rest.beg == '-' || *rest.beg == '+'))
+			++rest.beg;
 
+		uint64_t magnitude;
 
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////vprint//////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+		check(h_parse_unsigned(magnitude, rest, 10, ~0ull));
 
-	//{[argindex] [:[width] [.precision] [rightadj] [~filler] [signmode] [formatmode]]}
-	uint32_t vprint(uint64_t out, const och::stringview& format, const och::range<const arg_wrapper>& argv, uint32_t buffer_bytes)
-	{
-		och::range<char> buffer;
+		uint64_t ticks = 0;
 
-		void* backing_structure = nullptr;
+		bool is_valid = true;
 
-		if (buffer_bytes == 0xFFFF'FFFF)
+		if (text.end - rest.beg >= 4 && memcmp(rest.beg, "d + ", 4) == 0)
 		{
-			char buffer_array[output_buffer::file_buffer_capacity];
+			// [n]d + hh:mm
+			rest.beg += 4;
 
-			buffer = buffer_array;
+			uint32_t hours, minutes;
 
-			backing_structure = reinterpret_cast<void*>(out);
+			is_valid = h_parse_fixed_digits(hours, rest.beg, rest.end, 2) && rest.beg != rest.end && *rest.beg++ == ':' && h_parse_fixed_digits(minutes, rest.beg, rest.end, 2) && hours < 24 && minutes < 60
+				&& h_add_timespan_units(ticks, magnitude, nullptr, nullptr, TICKS_D) && h_add_timespan_units(ticks, hours * 60 + minutes, nullptr, nullptr, TICKS_MIN);
 		}
-		else if (buffer_bytes == 0xFFFF'FFFE)
+		else if (rest.len() != 0 && *rest.beg == ':')
 		{
-			buffer = och::range<char>(nullptr, nullptr);
+			// mm:ss.mmmmin or hh:mm
+			++rest.beg;
+
+			uint32_t lower;
+
+			is_valid = h_parse_fixed_digits(lower, rest.beg, rest.end, 2) && lower < 60;
+
+			if (is_valid && rest.len() != 0 && *rest.beg == '.')
+			{
+				const char* const frac_beg = ++rest.beg;
+
+				while (rest.beg != rest.end && static_cast<uint8_t>(*rest.beg - '0') < 10)
+					++rest.beg;
+
+				is_valid = rest.beg != frac_beg && rest.len() >= 3 && memcmp(rest.beg, "min", 3) == 0 && h_add_timespan_units(ticks, magnitude, nullptr, nullptr, TICKS_MIN) && h_add_timespan_units(ticks, lower, frac_beg, rest.beg, TICKS_S);
 
-			backing_structure = reinterpret_cast<void*>(out);
+				rest.beg += 3;
+			}
+			else if (is_valid)
+			{
+				is_valid = h_add_timespan_units(ticks, magnitude, nullptr, nullptr, TICKS_H) && h_add_timespan_units(ticks, lower, nullptr, nullptr, TICKS_MIN);
+			}
 		}
 		else
-			buffer = och::range<char>(reinterpret_cast<char*>(out), buffer_bytes);
+		{
+			// [n][.fraction]unit
+			const char* frac_beg = rest.beg, * frac_end = rest.beg;
 
-		output_buffer output(buffer, backing_structure);
+			if (rest.len() != 0 && *rest.beg == '.')
+			{
+				frac_beg = ++rest.beg;
 
-		uint32_t arg_counter = 0;
+				while (rest.beg != rest.end && static_cast<uint8_t>(*rest.beg - '0') < 10)
+					++rest.beg;
 
-		const char* last_fmt_end = format.raw_cbegin(), * curr = format.raw_cbegin(), * const initial_buffer_start = buffer.beg;
+				frac_end = rest.beg;
+			}
 
-		while (curr < format.raw_cend())
-			if (*curr++ == '{')
-			{
-				if (*curr == '{')
-				{
-					++curr;
+			struct unit { const char* symbol; uint32_t cunits; uint64_t ticks; };
 
-					output.put(och::stringview(last_fmt_end, static_cast<uint32_t>(curr - 1 - last_fmt_end), 1));
+			// Longer symbols come first, so that ms and min are not mistaken for m
+			static constexpr unit units[]{ { "min", 3, TICKS_MIN }, { "ms", 2, TICKS_MS }, { "us", 2, TICKS_US }, { "\xCE\xBCs", 3, TICKS_US }, { "s", 1, TICKS_S }, { "h", 1, TICKS_H }, { "d", 1, TICKS_D } };
 
-					last_fmt_end = curr;
+			const unit* matched = nullptr;
 
-					continue;
+			for (const unit& u : units)
+				if (rest.len() >= u.cunits && memcmp(rest.beg, u.symbol, u.cunits) == 0)
+				{
+					matched = &u;
+
+					break;
 				}
 
-				output.put(och::stringview(last_fmt_end, static_cast<uint32_t>(curr - 1 - last_fmt_end), 1));
+			is_valid = matched != nullptr;
 
-				uint32_t arg_idx;
+			if (is_valid)
+			{
+				rest.beg += matched->cunits;
 
-				arg_idx = *curr >= '0' && *curr <= '9' ? h_parse_fmt_index(curr) : arg_counter;
+				if (!h_add_timespan_units(ticks, magnitude, frac_beg, frac_end, matched->ticks))
+					return to_status(error::argument_too_large);
+			}
+		}
 
-				++arg_counter;
+		if (!is_valid)
+			return to_status(error::argument_invalid);
 
-				assert(arg_idx < static_cast<uint32_t>(argv.len()));
+		if (ticks > static_cast<uint64_t>(INT64_MAX))
+			return to_status(error::argument_too_large);
 
-				assert(*curr == ':' || *curr == '}');
+		out_value.val = is_negative ? -static_cast<int64_t>(ticks) : static_cast<int64_t>(ticks);
 
-				if (*curr == ':')
-					++curr;
+		text.beg = rest.beg;
 
-				parsed_context format_context(curr, argv, output);
+		return {};
+	}
 
-				argv[arg_idx].formatter(argv[arg_idx].value, format_context);
+	status scan_uint8(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<uint8_t*>(out_value), text, base); }
 
-				last_fmt_end = curr;
-			}
+	status scan_uint16(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<uint16_t*>(out_value), text, base); }
 
-		output.put(och::stringview(last_fmt_end, static_cast<uint32_t>(curr - last_fmt_end), 1));
+	status scan_uint32(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<uint32_t*>(out_value), text, base); }
 
-		output.finalize();
+	status scan_uint64(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<uint64_t*>(out_value), text, base); }
 
-		if (output.overrun_count)
-			return static_cast<uint32_t>(output.buffer.beg - initial_buffer_start + output.overrun_count);
-		else
-			return static_cast<uint32_t>(output.buffer.beg - initial_buffer_start + output.overrun_count - 1);
-	}
+	status scan_int8(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<int8_t*>(out_value), text, base); }
 
+	status scan_int16(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<int16_t*>(out_value), text, base); }
 
+	status scan_int32(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<int32_t*>(out_value), text, base); }
 
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////print///////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	status scan_int64(void* out_value, range<const char>& text, uint32_t base) noexcept { return parse(*static_cast<int64_t*>(out_value), text, base); }
 
-	void print(const och::iohandle& out, const och::stringview& format)
+	template<typename T>
+	status h_scan_base10(void* out_value, range<const char>& text, uint32_t base) noexcept
 	{
-		uint32_t bytes_written;
-		ignore_status(och::write_to_file(bytes_written, out, och::range<const uint8_t>(reinterpret_cast<const uint8_t*>(format.raw_cbegin()), reinterpret_cast<const uint8_t*>(format.raw_cend()))));
-	}
+		if (base != 10)
+			return to_status(error::argument_invalid);
 
-	void print(const och::iohandle& out, const char* format)
-	{
-		print(out, och::stringview(format));
+		return parse(*static_cast<T*>(out_value), text);
 	}
 
-	void print(const och::iohandle& out, const och::utf8_string& format)
-	{
-		print(out, och::stringview(format));
-	}
+	scan_arg create_scan_arg(uint8_t& value) noexcept { return { &value, scan_uint8 }; }
 
+	scan_arg create_scan_arg(uint16_t& value) noexcept { return { &value, scan_uint16 }; }
 
-	void print(const och::filehandle& out, const och::stringview& format)
-	{
-		print(out.get_handle_(), format);
-	}
+	scan_arg create_scan_arg(uint32_t& value) noexcept { return { &value, scan_uint32 }; }
 
-	void print(const och::filehandle& out, const char* format)
-	{
-		print(out.get_handle_(), format);
-	}
+	scan_arg create_scan_arg(uint64_t& value) noexcept { return { &value, scan_uint64 }; }
 
-	void print(const och::filehandle& out, const och::utf8_string& format)
-	{
-		print(out.get_handle_(), format);
-	}
+	scan_arg create_scan_arg(int8_t& value) noexcept { return { &value, scan_int8 }; }
 
+	scan_arg create_scan_arg(int16_t& value) noexcept { return { &value, scan_int16 }; }
 
-	void print(const och::stringview& format)
-	{
-		print(och::get_stdout(), format);
-	}
+	scan_arg create_scan_arg(int32_t& value) noexcept { return { &value, scan_int32 }; }
 
-	void print(const char* format)
-	{
-		print(och::get_stdout(), format);
-	}
+	scan_arg create_scan_arg(int64_t& value) noexcept { return { &value, scan_int64 }; }
 
-	void print(const och::utf8_string& format)
-	{
-		print(och::get_stdout(), format);
-	}
+	scan_arg create_scan_arg(float& value) noexcept { return { &value, h_scan_base10<float> }; }
 
+	scan_arg create_scan_arg(double& value) noexcept { return { &value, h_scan_base10<double> }; }
 
+	scan_arg create_scan_arg(date& value) noexcept { return { &value, h_scan_base10<date> }; }
 
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////sprint//////////////////////////////////////////////////////////*/
-	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	scan_arg create_scan_arg(timespan& value) noexcept { return { &value, h_scan_base10<timespan> }; }
 
-	uint32_t sprint(range<char> buf, const stringview& format)
+	status vscan(range<const char>& text, const stringview& format, const range<const scan_arg>& argv) noexcept
 	{
-		uint32_t wish = format.get_codeunits();
+		const char* fmt = format.raw_cbegin();
 
-		if (wish <= buf.len())
+		const char* const fmt_end = format.raw_cend();
+
+		range<const char> rest = text;
+
+		uint32_t arg_counter = 0;
+
+		while (fmt != fmt_end)
 		{
-			for (uint32_t i = 0; i != wish; ++i)
-				buf[i] = format.raw_cbegin()[i];
-		}
+			if (*fmt != '{' || (fmt_end - fmt >= 2 && fmt[1] == '{'))
+			{
+				if (rest.len() == 0 || *rest.beg != *fmt)
+					return to_status(error::argument_invalid);
 
-		return wish;
-	}
+				++rest.beg;
 
-	uint32_t sprint(range<char> buf, const char* format)
-	{
-		return sprint(buf, och::stringview(format));
-	}
+				fmt += *fmt == '{' ? 2 : 1;
 
-	uint32_t sprint(range<char> buf, const utf8_string& format)
-	{
-		return sprint(buf, och::stringview(format));
-	}
+				continue;
+			}
 
+			++fmt;
 
+			uint32_t arg_index = arg_counter++;
 
-	uint32_t sprint(och::utf8_string& buf, const stringview& format)
-	{
-		buf += format;
+			if (fmt != fmt_end && static_cast<uint8_t>(*fmt - '0') < 10)
+			{
+				arg_index = 0;
 
-		return format.get_codeunits();
-	}
+				while (fmt != fmt_end && static_cast<uint8_t>(*fmt - '0') < 10)
+					arg_index = arg_index * 10 + (*fmt++ - '0');
+			}
 
-	uint32_t sprint(och::utf8_string& buf, const char* format)
-	{
-		uint32_t prev_cunits = buf.get_codeunits();
+			uint32_t base = 10;
 
-		buf += format;
+			if (fmt != fmt_end && *fmt == ':')
+			{
+				++fmt;
 
-		return buf.get_codeunits() - prev_cunits;
-	}
+				if (fmt != fmt_end && (*fmt == 'x' || *fmt == 'X'))
+				{
+					base = 16;
 
-	uint32_t sprint(och::utf8_string& buf, const utf8_string& format)
-	{
-		buf += format;
+					++fmt;
+				}
+				else if (fmt != fmt_end && *fmt == 'b')
+				{
+					base = 2;
 
-		return format.get_codeunits();
+					++fmt;
+				}
+			}
+
+			if (fmt == fmt_end || *fmt != '}' || arg_index >= argv.len())
+				return to_status(error::argument_invalid);
+
+			++fmt;
+
+			check(argv[arg_index].parser(argv[arg_index].value, rest, base));
+		}
+
+		text.beg = rest.beg;
+
+		return {};
 	}
 }
@@ -4,6 +4,9 @@
 // OCH_FMT_INCLUDE_GUARD is #defined further down in the second #ifndef block
 
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 
 #include "och_range.h"
 #include "och_fio.h"
@@ -13,8 +16,93 @@ namespace och
 {
 	struct arg_wrapper;
 
+	struct packed_fmt_args;
+
 	struct output_buffer;
 
+	// A placeholder of a format string that was parsed at compile time by fmt_string. Offsets refer to the format string.
+	struct compiled_placeholder
+	{
+		static constexpr uint16_t NO_ARG = 0xFFFF;
+
+		static constexpr uint16_t NO_OFFSET = 0xFFFF;
+
+		static constexpr uint8_t WIDTH_FROM_ARG = 8;
+
+		static constexpr uint8_t PRECISION_FROM_ARG = 16;
+
+		uint16_t literal_beg; // Literal text to be output before the placeholder
+
+		uint16_t literal_cunits;
+
+		uint16_t arg_index; // NO_ARG if there is only literal text
+
+		uint16_t width; // Index of the argument holding the width if flags & WIDTH_FROM_ARG
+
+		uint16_t precision; // Index of the argument holding the precision if flags & PRECISION_FROM_ARG
+
+		uint16_t filler_offset;
+
+		uint16_t specifier_offset;
+
+		uint16_t raw_context_offset;
+
+		uint8_t flags; // Same as parsed_context::flags, plus WIDTH_FROM_ARG and PRECISION_FROM_ARG
+	};
+
+	// Destination of formatted output. reserve hands out a window of at least min_cunits writable cunits, or an empty
+	// range if the sink is full, in which case all further output is only counted. commit receives the filled start of
+	// the most recently reserved window. flush is called once after formatting completes and may be nullptr.
+	struct fmt_sink
+	{
+		range<char> (*reserve)(void* userdata, uint32_t min_cunits) noexcept;
+
+		void (*commit)(void* userdata, range<char> written) noexcept;
+
+		void (*flush)(void* userdata) noexcept;
+
+		void* userdata;
+	};
+
+	// Writes into a fixed buffer, null-terminating the output if there is room
+	struct fmt_buffer_sink_state
+	{
+		range<char> buffer;
+
+		uint32_t written = 0;
+
+		bool is_reserved = false;
+	};
+
+	// Writes to a file, using buffer to batch calls to write_to_file. Reserves larger than buffer are served from a heap
+	// buffer, which the sink releases once formatting completes.
+	struct fmt_file_sink_state
+	{
+		static constexpr uint32_t DEFAULT_BUFFER_CUNITS = 1024;
+
+		iohandle file;
+
+		range<char> buffer;
+
+		char* overflow = nullptr;
+
+		uint32_t overflow_cunits = 0;
+	};
+
+	fmt_sink buffer_sink(fmt_buffer_sink_state& state) noexcept;
+
+	fmt_sink file_sink(fmt_file_sink_state& state) noexcept;
+
+	// Appends to str
+	fmt_sink string_sink(utf8_string& str) noexcept;
+
+	struct fmt_size
+	{
+		uint32_t cunits;
+
+		uint32_t cpoints;
+	};
+
 	struct parsed_context
 	{
 		const char* raw_context = nullptr;
@@ -27,6 +115,13 @@ namespace och
 		output_buffer& output;
 
 		parsed_context(const char*& context, const range<const arg_wrapper> argv, output_buffer& output);
+
+		parsed_context(const char* format, const compiled_placeholder& placeholder, const range<const arg_wrapper> argv, output_buffer& output);
+
+		// argv is left empty for packed arguments
+		parsed_context(const char*& context, const packed_fmt_args& args, output_buffer& output);
+
+		parsed_context(const char* format, const compiled_placeholder& placeholder, const packed_fmt_args& args, output_buffer& output);
 	};
 
 	using fmt_fn = void (*) (type_union arg_value, const parsed_context& context) noexcept;
@@ -38,6 +133,40 @@ namespace och
 		fmt_fn formatter;
 	};
 
+	// Type of a packed argument. Built-in types are formatted through a switch on this, everything else is packed as
+	// its arg_wrapper and formatted through the wrapper's formatter.
+	enum class fmt_arg_type : uint8_t
+	{
+		u8,
+		u16,
+		u32,
+		u64,
+		i8,
+		i16,
+		i32,
+		i64,
+		f32,
+		f64,
+		codepoint, // utf8_char
+		cstring, // const char*
+		utf8_string, // const utf8_string*
+		utf8_view, // const utf8_view*
+		wrapper, // arg_wrapper
+	};
+
+	// Arguments as passed to vprint by the variadic formatting functions. types and offsets are a compile-time
+	// descriptor shared by all calls with the same argument types, so only the values are written at the call site.
+	struct packed_fmt_args
+	{
+		const fmt_arg_type* types;
+
+		const uint16_t* offsets; // Byte offset of each argument in values, followed by the total number of bytes
+
+		const uint8_t* values;
+
+		uint32_t arg_cnt;
+	};
+
 	arg_wrapper create_fmt_arg_wrapper(uint8_t value) noexcept;
 
 	arg_wrapper create_fmt_arg_wrapper(uint16_t value) noexcept;
@@ -69,6 +198,112 @@ namespace och
 	arg_wrapper create_fmt_arg_wrapper(char value) noexcept;
 
 	arg_wrapper create_fmt_arg_wrapper(const utf8_char& value) noexcept;
+
+	// Formats bytes as hex digits, or with h / H as a hexdump
+	arg_wrapper create_fmt_arg_wrapper(const range<const uint8_t>& value) noexcept;
+
+	arg_wrapper create_fmt_arg_wrapper(const range<uint8_t>& value) noexcept;
+
+	// Customization point for formatting user types. Specialize it with a member
+	//
+	//     static void format(const T& value, const parsed_context& context) noexcept;
+	//
+	// which writes value using fmt_put, fmt_put_padded or fmt_nested, and T can be passed to print, sprint and all
+	// other formatting functions. Trivially copyable types of 1, 2, 4 or 8 bytes are copied into their arg_wrapper and
+	// formatted from that copy, so the wrapper stays valid after the original is gone. Other types are referenced by
+	// address.
+	template<typename T>
+	struct formatter;
+
+	template<typename T>
+	concept has_user_formatter = requires(const T& value, const parsed_context& context) { formatter<T>::format(value, context); };
+
+	template<typename T>
+	constexpr bool fmt_passes_by_value = std::is_trivially_copyable_v<T> && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+	template<typename T>
+	void fmt_user_type(type_union arg_value, const parsed_context& context) noexcept
+	{
+		if constexpr (fmt_passes_by_value<T>)
+		{
+			T value;
+
+			memcpy(&value, &arg_value, sizeof(T));
+
+			formatter<T>::format(value, context);
+		}
+		else
+		{
+			formatter<T>::format(*static_cast<const T*>(arg_value.ptr), context);
+		}
+	}
+
+	template<typename T> requires has_user_formatter<T>
+	arg_wrapper create_fmt_arg_wrapper(const T& value) noexcept
+	{
+		if constexpr (fmt_passes_by_value<T>)
+		{
+			type_union bits(static_cast<uint64_t>(0));
+
+			memcpy(&bits, &value, sizeof(T));
+
+			return { bits, fmt_user_type<T> };
+		}
+		else
+		{
+			return { static_cast<const void*>(&value), fmt_user_type<T> };
+		}
+	}
+
+	// Declared, next to its create_fmt_arg_wrapper, with a return type of std::true_type for every type whose
+	// arg_wrapper refers to the argument by address instead of holding a copy of it. Only used through
+	// fmt_wrapper_takes_address.
+	template<typename T>
+	std::bool_constant<has_user_formatter<T> && !fmt_passes_by_value<T>> fmt_wrapper_takes_address_(const T& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const utf8_string& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const utf8_view& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const range<const uint8_t>& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const range<uint8_t>& value) noexcept;
+
+	// Whether create_fmt_arg_wrapper refers to its argument by address instead of copying it into the arg_wrapper.
+	// sprint_range hands such elements to their formatter by address, and all others as raw bits of their size.
+	template<typename T>
+	constexpr bool fmt_wrapper_takes_address = decltype(fmt_wrapper_takes_address_(std::declval<const T&>()))::value;
+
+
+
+	using scan_fn = status (*) (void* out_value, range<const char>& text, uint32_t base) noexcept;
+
+	struct scan_arg
+	{
+		void* value;
+
+		scan_fn parser;
+	};
+
+	scan_arg create_scan_arg(uint8_t& value) noexcept;
+
+	scan_arg create_scan_arg(uint16_t& value) noexcept;
+
+	scan_arg create_scan_arg(uint32_t& value) noexcept;
+
+	scan_arg create_scan_arg(uint64_t& value) noexcept;
+
+	scan_arg create_scan_arg(int8_t& value) noexcept;
+
+	scan_arg create_scan_arg(int16_t& value) noexcept;
+
+	scan_arg create_scan_arg(int32_t& value) noexcept;
+
+	scan_arg create_scan_arg(int64_t& value) noexcept;
+
+	scan_arg create_scan_arg(float& value) noexcept;
+
+	scan_arg create_scan_arg(double& value) noexcept;
 }
 
 #endif // !OCH_FMT_INCLUDE_GUARD
@@ -81,6 +316,20 @@ namespace och
 	arg_wrapper create_fmt_arg_wrapper(timespan value) noexcept;
 
 	arg_wrapper create_fmt_arg_wrapper(highres_timespan value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const date& value) noexcept;
+
+	// Reads the ISO forms written by fmt_date's default, d and u specifiers, i.e. [y]yyyy-mm-dd, optionally followed
+	// by ", hh:mm:ss.mmm" or "Thh:mm:ss.mmm", optionally followed by Z or a +-hh:mm utc-offset
+	[[nodiscard]] status parse(date& out_value, range<const char>& text) noexcept;
+
+	// Reads a number with an optional fraction followed by one of the units d, h, min, s, ms, us or μs, or the
+	// composite forms written by fmt_timespan's default specifier, such as 12:34.567min or 3d + 04:05
+	[[nodiscard]] status parse(timespan& out_value, range<const char>& text) noexcept;
+
+	scan_arg create_scan_arg(date& value) noexcept;
+
+	scan_arg create_scan_arg(timespan& value) noexcept;
 #endif // OCH_TIME_PRESENT
 
 #ifdef OCH_MATMATH_PRESENT
@@ -95,6 +344,18 @@ namespace och
 	arg_wrapper create_fmt_arg_wrapper(const och::vec3& value);
 
 	arg_wrapper create_fmt_arg_wrapper(const och::vec2& value);
+
+	std::true_type fmt_wrapper_takes_address_(const och::mat4& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const och::mat3& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const och::mat2& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const och::vec4& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const och::vec3& value) noexcept;
+
+	std::true_type fmt_wrapper_takes_address_(const och::vec2& value) noexcept;
 #endif // OCH_MATMATH_PRESENT
 
 #ifdef OCH_VIRTUAL_KEYS_PRESENT
@@ -108,15 +369,480 @@ namespace och
 
 namespace och
 {
-	uint32_t vprint(uint64_t out, const stringview& format, const range<const arg_wrapper>& argv, uint32_t buffer_bytes = 0xFFFF'FFFF);
+	template<typename T>
+	struct fmt_arg_traits
+	{
+		static constexpr fmt_arg_type type = fmt_arg_type::wrapper;
+
+		static constexpr uint32_t bytes = sizeof(arg_wrapper);
+
+		static void pack(uint8_t* out, const T& value) noexcept { const arg_wrapper wrapper = create_fmt_arg_wrapper(value); memcpy(out, &wrapper, sizeof(wrapper)); }
+	};
+
+	template<typename T, fmt_arg_type Type>
+	struct fmt_scalar_arg_traits
+	{
+		static constexpr fmt_arg_type type = Type;
+
+		static constexpr uint32_t bytes = sizeof(T);
+
+		static void pack(uint8_t* out, T value) noexcept { memcpy(out, &value, sizeof(T)); }
+	};
+
+	template<typename T, fmt_arg_type Type>
+	struct fmt_address_arg_traits
+	{
+		static constexpr fmt_arg_type type = Type;
+
+		static constexpr uint32_t bytes = sizeof(const void*);
+
+		static void pack(uint8_t* out, const T& value) noexcept { const void* address = &value; memcpy(out, &address, sizeof(address)); }
+	};
+
+	template<typename T>
+	struct fmt_codepoint_arg_traits
+	{
+		static constexpr fmt_arg_type type = fmt_arg_type::codepoint;
+
+		static constexpr uint32_t bytes = sizeof(utf8_char);
+
+		static void pack(uint8_t* out, T value) noexcept { const utf8_char c(value); memcpy(out, &c, sizeof(c)); }
+	};
+
+	template<> struct fmt_arg_traits<uint8_t> : fmt_scalar_arg_traits<uint8_t, fmt_arg_type::u8> {};
+
+	template<> struct fmt_arg_traits<uint16_t> : fmt_scalar_arg_traits<uint16_t, fmt_arg_type::u16> {};
+
+	template<> struct fmt_arg_traits<uint32_t> : fmt_scalar_arg_traits<uint32_t, fmt_arg_type::u32> {};
+
+	template<> struct fmt_arg_traits<uint64_t> : fmt_scalar_arg_traits<uint64_t, fmt_arg_type::u64> {};
+
+	template<> struct fmt_arg_traits<int8_t> : fmt_scalar_arg_traits<int8_t, fmt_arg_type::i8> {};
+
+	template<> struct fmt_arg_traits<int16_t> : fmt_scalar_arg_traits<int16_t, fmt_arg_type::i16> {};
+
+	template<> struct fmt_arg_traits<int32_t> : fmt_scalar_arg_traits<int32_t, fmt_arg_type::i32> {};
+
+	template<> struct fmt_arg_traits<int64_t> : fmt_scalar_arg_traits<int64_t, fmt_arg_type::i64> {};
+
+	template<> struct fmt_arg_traits<float> : fmt_scalar_arg_traits<float, fmt_arg_type::f32> {};
+
+	template<> struct fmt_arg_traits<double> : fmt_scalar_arg_traits<double, fmt_arg_type::f64> {};
+
+	template<> struct fmt_arg_traits<const char*> : fmt_scalar_arg_traits<const char*, fmt_arg_type::cstring> {};
+
+	template<> struct fmt_arg_traits<char*> : fmt_scalar_arg_traits<const char*, fmt_arg_type::cstring> {};
+
+	template<> struct fmt_arg_traits<char> : fmt_codepoint_arg_traits<char> {};
+
+	template<> struct fmt_arg_traits<char32_t> : fmt_codepoint_arg_traits<char32_t> {};
+
+	template<> struct fmt_arg_traits<utf8_char> : fmt_codepoint_arg_traits<utf8_char> {};
+
+	template<> struct fmt_arg_traits<utf8_string> : fmt_address_arg_traits<utf8_string, fmt_arg_type::utf8_string> {};
+
+	template<> struct fmt_arg_traits<utf8_view> : fmt_address_arg_traits<utf8_view, fmt_arg_type::utf8_view> {};
+
+	template<typename... Args>
+	struct fmt_arg_layout
+	{
+		struct offset_table
+		{
+			uint16_t offsets[sizeof...(Args) + 1];
+		};
+
+		// The trailing element keeps the array from being empty
+		static constexpr fmt_arg_type types[]{ fmt_arg_traits<Args>::type..., fmt_arg_type::u8 };
+
+		static constexpr offset_table offsets = []()
+			{
+				constexpr uint32_t arg_bytes[]{ fmt_arg_traits<Args>::bytes..., 0 };
+
+				offset_table table{};
+
+				for (uint32_t i = 0; i != sizeof...(Args); ++i)
+					table.offsets[i + 1] = static_cast<uint16_t>(table.offsets[i] + arg_bytes[i]);
+
+				return table;
+			}();
+
+		static constexpr uint32_t bytes = offsets.offsets[sizeof...(Args)];
+	};
+
+	// Holds the values of args back to back, as described by fmt_arg_layout<Args...>
+	template<typename... Args>
+	struct packed_fmt_arg_values
+	{
+		using layout = fmt_arg_layout<Args...>;
+
+		alignas(8) uint8_t values[layout::bytes + 1]; // The trailing byte keeps the array from being empty
+
+		explicit packed_fmt_arg_values(const Args&... args) noexcept
+		{
+			pack(std::index_sequence_for<Args...>{}, args...);
+		}
+
+		[[nodiscard]] packed_fmt_args get() const noexcept
+		{
+			return { layout::types, layout::offsets.offsets, values, static_cast<uint32_t>(sizeof...(Args)) };
+		}
+
+	private:
+
+		template<size_t... Indices>
+		void pack(std::index_sequence<Indices...>, const Args&... args) noexcept
+		{
+			(fmt_arg_traits<Args>::pack(values + layout::offsets.offsets[Indices], args), ...);
+		}
+	};
+
+
+
+	// Returns the number of cunits formatted, including any that did not fit into sink
+	uint32_t vprint(const fmt_sink& sink, const stringview& format, const range<const arg_wrapper>& argv);
+
+	uint32_t vprint(const fmt_sink& sink, const char* format, const range<const compiled_placeholder>& placeholders, const range<const arg_wrapper>& argv);
+
+	uint32_t vprint(const fmt_sink& sink, const stringview& format, const packed_fmt_args& args);
+
+	uint32_t vprint(const fmt_sink& sink, const char* format, const range<const compiled_placeholder>& placeholders, const packed_fmt_args& args);
+
+	// Elements are handed to formatter by address if elements_by_address is set, and as raw bits of element_bytes, which
+	// must then be 1, 2, 4 or 8, otherwise
+	uint32_t vprint_range(const fmt_sink& sink, const stringview& spec, fmt_fn formatter, const void* elements, uint32_t element_bytes, bool elements_by_address, size_t element_cnt, const stringview& separator);
+
+	// Controls how print writes to files. buffered writes whenever fmt_file_sink_state::DEFAULT_BUFFER_CUNITS fill up, so
+	// output of concurrent prints to the same file may interleave. atomic formats each call into a growable buffer owned
+	// by the calling thread and writes it with a single call to write_to_file, keeping lines whole without any lock.
+	enum class print_mode : uint8_t
+	{
+		buffered,
+		atomic,
+	};
+
+	// May be called while other threads print. Each print uses the mode that was current when it started.
+	void set_print_mode(print_mode mode) noexcept;
+
+	print_mode get_print_mode() noexcept;
+
+	// Writes to out as selected by set_print_mode
+	uint32_t vprint(const iohandle& out, const stringview& format, const range<const arg_wrapper>& argv);
+
+	uint32_t vprint(const iohandle& out, const char* format, const range<const compiled_placeholder>& placeholders, const range<const arg_wrapper>& argv);
+
+	uint32_t vprint(const iohandle& out, const stringview& format, const packed_fmt_args& args);
+
+	uint32_t vprint(const iohandle& out, const char* format, const range<const compiled_placeholder>& placeholders, const packed_fmt_args& args);
+
+	// Appends to out, growing it only once to exactly the required size
+	uint32_t vprint(utf8_string& out, const stringview& format, const range<const arg_wrapper>& argv);
+
+	uint32_t vprint(utf8_string& out, const char* format, const range<const compiled_placeholder>& placeholders, const range<const arg_wrapper>& argv);
+
+	uint32_t vprint(utf8_string& out, const stringview& format, const packed_fmt_args& args);
+
+	uint32_t vprint(utf8_string& out, const char* format, const range<const compiled_placeholder>& placeholders, const packed_fmt_args& args);
+
+	uint32_t vprint_range(utf8_string& out, const stringview& spec, fmt_fn formatter, const void* elements, uint32_t element_bytes, bool elements_by_address, size_t element_cnt, const stringview& separator);
+
+	fmt_size vformatted_size(const stringview& format, const range<const arg_wrapper>& argv);
+
+	fmt_size vformatted_size(const char* format, const range<const compiled_placeholder>& placeholders, const range<const arg_wrapper>& argv);
+
+	fmt_size vformatted_size(const stringview& format, const packed_fmt_args& args);
+
+	fmt_size vformatted_size(const char* format, const range<const compiled_placeholder>& placeholders, const packed_fmt_args& args);
+
+	struct hexdump_options
+	{
+		uint32_t bytes_per_line = 16;
+
+		uint32_t group_bytes = 1; // Bytes between separating spaces in the hex column, or 0 for no spaces
+
+		uint64_t offset_base = 0; // Offset shown for the first byte
+
+		bool show_offset = true;
+
+		bool show_ascii = true;
+
+		bool is_upper = false;
+	};
+
+	// Writes bytes as lines of an offset column, the bytes in hex and an ASCII gutter in which unprintable bytes show
+	// up as '.', such as
+	//     00000010  48 65 6c 6c 6f 2c 20 77 6f 72 6c 64 21 0a 00 ff  |Hello, world!...|
+	// Every line, including the last one, ends with '\n'. Returns the number of cunits formatted.
+	uint32_t hexdump(const fmt_sink& sink, range<const uint8_t> bytes, const hexdump_options& options = {});
+
+	uint32_t hexdump(utf8_string& out, range<const uint8_t> bytes, const hexdump_options& options = {});
+
+	// Output functions for formatter<T>::format. fmt_put writes text as is, while fmt_put_padded also applies the width,
+	// filler and alignment of context.
+	void fmt_put(const parsed_context& context, const stringview& text) noexcept;
+
+	void fmt_put(const parsed_context& context, utf8_char c) noexcept;
+
+	void fmt_put_padded(const parsed_context& context, const stringview& text) noexcept;
+
+	// Formats argv according to format into the output of context, so that a formatter can reuse the formatting of
+	// the members of its type. Width and alignment of context are not applied.
+	void vprint_nested(const parsed_context& context, const stringview& format, const range<const arg_wrapper>& argv) noexcept;
 
-	//{[argindex] [:[width] [.precision] [rightadj] [~filler] [signmode] [format specifier]]}
+	template<typename... Args>
+	void fmt_nested(const parsed_context& context, const stringview& format, Args... args) noexcept
+	{
+		const arg_wrapper argv[]{ create_fmt_arg_wrapper(args)..., arg_wrapper{ static_cast<uint64_t>(0), nullptr } };
+
+		vprint_nested(context, format, range<const arg_wrapper>(argv, sizeof...(Args)));
+	}
+
+
+
+	template<size_t N>
+	struct fmt_literal
+	{
+		char text[N];
+
+		consteval fmt_literal(const char (&str)[N]) noexcept
+		{
+			for (size_t i = 0; i != N; ++i)
+				text[i] = str[i];
+		}
+	};
+
+	namespace fmt_compiler
+	{
+		consteval uint32_t utf8_cunits(char c) noexcept
+		{
+			const uint8_t u = static_cast<uint8_t>(c);
+
+			return u < 0xC0 ? 1 : u < 0xE0 ? 2 : u < 0xF0 ? 3 : 4;
+		}
+
+		consteval bool is_digit(char c) noexcept
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		consteval uint16_t parse_index(const char* format, uint32_t& i) noexcept
+		{
+			uint16_t val = 0;
+
+			while (is_digit(format[i]))
+				val = val * 10 + format[i++] - '0';
+
+			return val;
+		}
+
+		// Mirrors parsed_context's runtime parsing, but records offsets instead of building the context.
+		// Returns the number of entries in out (or the number required if out is nullptr) and the number of arguments referenced.
+		consteval uint32_t compile(const char* format, uint32_t format_cunits, compiled_placeholder* out, uint32_t& out_arg_cnt) noexcept
+		{
+			uint32_t entry_cnt = 0;
+
+			uint32_t arg_counter = 0;
+
+			uint32_t last_fmt_end = 0;
+
+			uint32_t i = 0;
+
+			out_arg_cnt = 0;
+
+			auto note_arg = [&](uint32_t idx) { if (idx + 1 > out_arg_cnt) out_arg_cnt = idx + 1; };
+
+			while (i < format_cunits)
+			{
+				if (format[i++] != '{')
+					continue;
+
+				compiled_placeholder p{ static_cast<uint16_t>(last_fmt_end), static_cast<uint16_t>(i - 1 - last_fmt_end), compiled_placeholder::NO_ARG, 0, 0xFFFF, compiled_placeholder::NO_OFFSET, compiled_placeholder::NO_OFFSET, compiled_placeholder::NO_OFFSET, 0 };
+
+				if (format[i] == '{')
+				{
+					// Keep the first '{' as part of the literal
+					++p.literal_cunits;
+
+					last_fmt_end = ++i;
+				}
+				else
+				{
+					p.arg_index = is_digit(format[i]) ? parse_index(format, i) : static_cast<uint16_t>(arg_counter);
+
+					++arg_counter;
+
+					note_arg(p.arg_index);
+
+					if (format[i] == ':')
+						++i;
+
+					if (format[i] == '{')
+					{
+						++i;
+
+						p.width = parse_index(format, i);
+
+						p.flags |= compiled_placeholder::WIDTH_FROM_ARG;
+
+						note_arg(p.width);
+
+						++i;
+					}
+					else
+					{
+						p.width = parse_index(format, i);
+					}
+
+					if (format[i] == '.')
+					{
+						++i;
+
+						if (format[i] == '{')
+						{
+							++i;
+
+							p.precision = parse_index(format, i);
+
+							p.flags |= compiled_placeholder::PRECISION_FROM_ARG;
+
+							note_arg(p.precision);
+
+							++i;
+						}
+						else if (is_digit(format[i]))
+						{
+							p.precision = parse_index(format, i);
+						}
+						else
+						{
+							p.precision = 0x7FFF;
+						}
+					}
+
+					if (format[i] == '>')
+					{
+						p.flags |= 4;
+
+						++i;
+					}
+					else if (format[i] == '<')
+					{
+						++i;
+					}
+
+					if (format[i] == '!')
+					{
+						p.flags |= 32;
+
+						++i;
+					}
+
+					if (format[i] == '~')
+					{
+						p.filler_offset = static_cast<uint16_t>(++i);
+
+						i += utf8_cunits(format[i]);
+					}
+
+					if (format[i] == '+')
+					{
+						p.flags |= 1;
+
+						++i;
+					}
+					else if (format[i] == '_')
+					{
+						p.flags |= 2;
+
+						++i;
+					}
+
+					if (format[i] != '}')
+					{
+						p.specifier_offset = static_cast<uint16_t>(i);
+
+						i += utf8_cunits(format[i]);
+					}
+
+					if (format[i] != '}')
+						p.raw_context_offset = static_cast<uint16_t>(i);
+
+					for (int32_t opening_bracket_cnt = 1; opening_bracket_cnt; ++i)
+						if (format[i] == '{')
+							++opening_bracket_cnt;
+						else if (format[i] == '}')
+							--opening_bracket_cnt;
+
+					last_fmt_end = i;
+				}
+
+				if (out != nullptr)
+					out[entry_cnt] = p;
+
+				++entry_cnt;
+			}
+
+			if (last_fmt_end != format_cunits)
+			{
+				if (out != nullptr)
+					out[entry_cnt] = compiled_placeholder{ static_cast<uint16_t>(last_fmt_end), static_cast<uint16_t>(format_cunits - last_fmt_end), compiled_placeholder::NO_ARG, 0, 0xFFFF, compiled_placeholder::NO_OFFSET, compiled_placeholder::NO_OFFSET, compiled_placeholder::NO_OFFSET, 0 };
+
+				++entry_cnt;
+			}
+
+			return entry_cnt;
+		}
+
+		template<uint32_t N>
+		struct compiled_format
+		{
+			compiled_placeholder placeholders[N == 0 ? 1 : N];
+
+			uint32_t arg_cnt;
+		};
+	}
+
+	// A format string that is parsed at compile time, so that formatting with it only runs the formatters and copies literals.
+	// Use as och::print(och::fmt_string<"{} of {}">{}, a, b). Passing a different number of arguments than the format
+	// string references is a compile-time error.
+	template<fmt_literal Format>
+	struct fmt_string
+	{
+		static constexpr uint32_t format_cunits = static_cast<uint32_t>(sizeof(Format.text) - 1);
+
+		static_assert(format_cunits < 0xFFFF, "Compiled format strings must be shorter than 65535 bytes");
+
+		static constexpr uint32_t placeholder_cnt = []() consteval { uint32_t arg_cnt = 0; return fmt_compiler::compile(Format.text, format_cunits, nullptr, arg_cnt); }();
+
+		static constexpr fmt_compiler::compiled_format<placeholder_cnt> compiled = []() consteval
+		{
+			fmt_compiler::compiled_format<placeholder_cnt> ret{};
+
+			fmt_compiler::compile(Format.text, format_cunits, ret.placeholders, ret.arg_cnt);
+
+			return ret;
+		}();
+
+		static constexpr uint32_t arg_cnt = compiled.arg_cnt;
+
+		[[nodiscard]] static constexpr const char* text() noexcept
+		{
+			return Format.text;
+		}
+
+		[[nodiscard]] static constexpr range<const compiled_placeholder> placeholders() noexcept
+		{
+			return range<const compiled_placeholder>(compiled.placeholders, placeholder_cnt);
+		}
+	};
+
+	//{[argindex] [:[width] [.precision] [rightadj] [!] [~filler] [signmode] [format specifier]]}
+	// '!' measures width in terminal columns rather than codepoints, so that East Asian wide characters, combining marks and emoji line up
 	template<typename... Args>
 	void print(const iohandle& out, const stringview& format, Args... args)
 	{
-		const arg_wrapper argv[]{ create_fmt_arg_wrapper(args)... };
+		const packed_fmt_arg_values<Args...> packed(args...);
 
-		vprint(reinterpret_cast<uint64_t>(out.get_()), format, och::range<const arg_wrapper>(argv));
+		vprint(out, format, packed.get());
 	}
 
 	template<typename... Args>
@@ -125,6 +851,16 @@ namespace och
 		print(out, och::stringview(format), args...);
 	}
 
+	template<fmt_literal Format, typename... Args>
+	void print(const iohandle& out, fmt_string<Format> format, Args... args)
+	{
+		static_assert(sizeof...(Args) == fmt_string<Format>::arg_cnt, "Number of arguments does not match the format string");
+
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		vprint(out, format.text(), format.placeholders(), packed.get());
+	}
+
 	template<typename... Args>
 	void print(const iohandle& out, const utf8_string& format, Args... args)
 	{
@@ -145,6 +881,12 @@ namespace och
 		print(out.get_handle_(), och::stringview(format), args...);
 	}
 
+	template<fmt_literal Format, typename... Args>
+	void print(const filehandle& out, fmt_string<Format> format, Args... args)
+	{
+		print(out.get_handle_(), format, args...);
+	}
+
 	template<typename... Args>
 	void print(const filehandle& out, const utf8_string& format, Args... args)
 	{
@@ -165,6 +907,12 @@ namespace och
 		print(och::get_stdout(), och::stringview(format), args...);
 	}
 
+	template<fmt_literal Format, typename... Args>
+	void print(fmt_string<Format> format, Args... args)
+	{
+		print(och::get_stdout(), format, args...);
+	}
+
 	template<typename... Args>
 	void print(const utf8_string& format, Args... args)
 	{
@@ -201,9 +949,14 @@ namespace och
 	template<typename... Args>
 	uint32_t sprint(range<char> buf, const stringview& format, Args... args)
 	{
-		const arg_wrapper argv[]{ create_fmt_arg_wrapper(args)... };
+		const packed_fmt_arg_values<Args...> packed(args...);
 
-		return vprint(reinterpret_cast<uint64_t>(buf.beg), format, och::range<const arg_wrapper>(argv), static_cast<uint32_t>(buf.len()));
+		fmt_buffer_sink_state state{ buf };
+
+		const uint32_t cunits = vprint(buffer_sink(state), format, packed.get());
+
+		// If the output does not fit, the required size includes the terminating '\0'
+		return cunits < buf.len() ? cunits : cunits + 1;
 	}
 
 	template<typename... Args>
@@ -212,6 +965,20 @@ namespace och
 		return sprint(buf, och::stringview(format), args...);
 	}
 
+	template<fmt_literal Format, typename... Args>
+	uint32_t sprint(range<char> buf, fmt_string<Format> format, Args... args)
+	{
+		static_assert(sizeof...(Args) == fmt_string<Format>::arg_cnt, "Number of arguments does not match the format string");
+
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		fmt_buffer_sink_state state{ buf };
+
+		const uint32_t cunits = vprint(buffer_sink(state), format.text(), format.placeholders(), packed.get());
+
+		return cunits < buf.len() ? cunits : cunits + 1;
+	}
+
 	template<typename... Args>
 	uint32_t sprint(range<char> buf, const utf8_string& format, Args... args)
 	{
@@ -231,9 +998,9 @@ namespace och
 	template<typename... Args>
 	uint32_t sprint(och::utf8_string& buf, const stringview& format, Args... args)
 	{
-		const arg_wrapper argv[]{ create_fmt_arg_wrapper(args)... };
+		const packed_fmt_arg_values<Args...> packed(args...);
 
-		return vprint(reinterpret_cast<uint64_t>(&buf), format, och::range<const arg_wrapper>(argv), 0xFFFF'FFFE);
+		return vprint(buf, format, packed.get());
 	}
 
 	template<typename... Args>
@@ -242,6 +1009,16 @@ namespace och
 		return sprint(buf, och::stringview(format), args...);
 	}
 
+	template<fmt_literal Format, typename... Args>
+	uint32_t sprint(och::utf8_string& buf, fmt_string<Format> format, Args... args)
+	{
+		static_assert(sizeof...(Args) == fmt_string<Format>::arg_cnt, "Number of arguments does not match the format string");
+
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		return vprint(buf, format.text(), format.placeholders(), packed.get());
+	}
+
 	template<typename... Args>
 	uint32_t sprint(och::utf8_string& buf, const utf8_string& format, Args... args)
 	{
@@ -255,6 +1032,222 @@ namespace och
 	uint32_t sprint(och::utf8_string& buf, const char* format);
 
 	uint32_t sprint(och::utf8_string& buf, const char* format);
+
+
+
+
+
+	// Returns the number of cunits and cpoints sprint would produce, without writing anything
+	template<typename... Args>
+	fmt_size formatted_size(const stringview& format, Args... args)
+	{
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		return vformatted_size(format, packed.get());
+	}
+
+	template<typename... Args>
+	fmt_size formatted_size(const char* format, Args... args)
+	{
+		return formatted_size(och::stringview(format), args...);
+	}
+
+	template<fmt_literal Format, typename... Args>
+	fmt_size formatted_size(fmt_string<Format> format, Args... args)
+	{
+		static_assert(sizeof...(Args) == fmt_string<Format>::arg_cnt, "Number of arguments does not match the format string");
+
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		return vformatted_size(format.text(), format.placeholders(), packed.get());
+	}
+
+	template<typename... Args>
+	fmt_size formatted_size(const utf8_string& format, Args... args)
+	{
+		return formatted_size(och::stringview(format), args...);
+	}
+
+
+
+	// Formats into an arbitrary sink, which can be used to direct output to custom destinations or to control the
+	// buffering of files
+	template<typename... Args>
+	uint32_t sprint(const fmt_sink& sink, const stringview& format, Args... args)
+	{
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		return vprint(sink, format, packed.get());
+	}
+
+	template<typename... Args>
+	uint32_t sprint(const fmt_sink& sink, const char* format, Args... args)
+	{
+		return sprint(sink, och::stringview(format), args...);
+	}
+
+	template<fmt_literal Format, typename... Args>
+	uint32_t sprint(const fmt_sink& sink, fmt_string<Format> format, Args... args)
+	{
+		static_assert(sizeof...(Args) == fmt_string<Format>::arg_cnt, "Number of arguments does not match the format string");
+
+		const packed_fmt_arg_values<Args...> packed(args...);
+
+		return vprint(sink, format.text(), format.placeholders(), packed.get());
+	}
+
+	template<typename... Args>
+	uint32_t sprint(const fmt_sink& sink, const utf8_string& format, Args... args)
+	{
+		return sprint(sink, och::stringview(format), args...);
+	}
+
+
+
+
+
+	// Formats each of values according to spec, which is a single placeholder such as "{:.3}" or "{:8>x}", and puts
+	// separator between them. The spec is only parsed once and the formatter only looked up once, making this much
+	// cheaper than calling sprint per value. Values for which fmt_wrapper_takes_address holds, such as dates, strings,
+	// vectors and matrices, are handed to their formatter by address, all other values as raw bits. Width and precision
+	// cannot be taken from arguments.
+	template<typename T>
+	uint32_t sprint_range(range<char> buf, const stringview& spec, range<const T> values, const stringview& separator = stringview(", "))
+	{
+		static_assert(fmt_wrapper_takes_address<T> || sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "sprint_range only supports elements that are passed by address or are 1, 2, 4 or 8 bytes in size");
+
+		fmt_buffer_sink_state state{ buf };
+
+		const uint32_t cunits = vprint_range(buffer_sink(state), spec, create_fmt_arg_wrapper(T{}).formatter, values.beg, static_cast<uint32_t>(sizeof(T)), fmt_wrapper_takes_address<T>, values.len(), separator);
+
+		return cunits < buf.len() ? cunits : cunits + 1;
+	}
+
+	template<typename T>
+	uint32_t sprint_range(range<char> buf, const stringview& spec, range<T> values, const stringview& separator = stringview(", "))
+	{
+		return sprint_range(buf, spec, range<const T>(values.beg, values.end), separator);
+	}
+
+	template<typename T>
+	uint32_t sprint_range(och::utf8_string& buf, const stringview& spec, range<const T> values, const stringview& separator = stringview(", "))
+	{
+		static_assert(fmt_wrapper_takes_address<T> || sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "sprint_range only supports elements that are passed by address or are 1, 2, 4 or 8 bytes in size");
+
+		return vprint_range(buf, spec, create_fmt_arg_wrapper(T{}).formatter, values.beg, static_cast<uint32_t>(sizeof(T)), fmt_wrapper_takes_address<T>, values.len(), separator);
+	}
+
+	template<typename T>
+	uint32_t sprint_range(och::utf8_string& buf, const stringview& spec, range<T> values, const stringview& separator = stringview(", "))
+	{
+		return sprint_range(buf, spec, range<const T>(values.beg, values.end), separator);
+	}
+
+	// Writes values in decimal, separated by separator, to buf and null-terminates the output if there is room.
+	// Returns the number of cunits written, excluding the terminator. If the output does not fit, only the values that
+	// fit completely are written and the required size, including the terminator, is returned, as with sprint.
+	uint32_t sprint_integers(range<char> buf, range<const uint64_t> values, char separator = ',');
+
+	uint32_t sprint_integers(range<char> buf, range<const int64_t> values, char separator = ',');
+
+	uint32_t sprint_integers(range<char> buf, range<const uint32_t> values, char separator = ',');
+
+	uint32_t sprint_integers(range<char> buf, range<const int32_t> values, char separator = ',');
+
+	// Units of byte sizes and rates, as written by the integer specifiers given in the comments. Values are scaled to
+	// the largest unit they reach after rounding to precision (default 1, at most 3) decimals, e.g. 1.5 KiB, 12.0 Mops/s
+	// or 1.000 MiB for 1048575 with three decimals.
+	enum class quantity : uint8_t
+	{
+		iec_bytes,     // i: B, KiB, MiB, GiB, ...
+		si_bytes,      // k: B, kB, MB, GB, ...
+		iec_byte_rate, // I: B/s, KiB/s, MiB/s, ...
+		si_byte_rate,  // K: B/s, kB/s, MB/s, ...
+		op_rate,       // r: ops/s, kops/s, Mops/s, ...
+	};
+
+	// Writes values as quantities of the given kind, but scales all of them to the unit of the largest one and
+	// right-aligns them to a common width, so that they line up as a table column. Otherwise the same as
+	// sprint_integers.
+	uint32_t sprint_quantities(range<char> buf, range<const uint64_t> values, quantity kind, uint32_t precision = 1, char separator = '\n');
+
+	uint32_t sprint_quantities(range<char> buf, range<const uint32_t> values, quantity kind, uint32_t precision = 1, char separator = '\n');
+
+
+
+
+
+	// Parses a value from the start of text and advances text.beg past it. Integers are read in base 10, 16 or 2, as
+	// written by the default, x and b specifiers, and may be preceded by a sign. Floating-point values are read in
+	// fixed or scientific notation, as well as inf and nan. Fails with argument_invalid if text does not start with a
+	// value and with argument_too_large if the value is out of range for out_value. On failure, neither out_value
+	// nor text is modified.
+	[[nodiscard]] status parse(uint64_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(uint32_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(uint16_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(uint8_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(int64_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(int32_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(int16_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(int8_t& out_value, range<const char>& text, uint32_t base = 10) noexcept;
+
+	[[nodiscard]] status parse(double& out_value, range<const char>& text) noexcept;
+
+	[[nodiscard]] status parse(float& out_value, range<const char>& text) noexcept;
+
+	// Same as above, but fails with argument_invalid unless all of text is consumed
+	template<typename T, typename... Options>
+	[[nodiscard]] status parse(T& out_value, const utf8_view& text, Options... options) noexcept
+	{
+		range<const char> rest(text.raw_cbegin(), text.raw_cend());
+
+		T value;
+
+		check(parse(value, rest, options...));
+
+		if (rest.len() != 0)
+			return to_status(error::argument_invalid);
+
+		out_value = value;
+
+		return {};
+	}
+
+	// Matches text against format, which consists of literal text and placeholders of the form {[argindex][:specifier]}.
+	// Literal text must match exactly, with {{ standing for {. Each placeholder parses one value into the referenced
+	// argument, where the specifiers x, X and b select base 16 and 2 for integers. text.beg is advanced past the
+	// consumed characters on success. On failure, arguments preceding the mismatch may already have been written.
+	[[nodiscard]] status vscan(range<const char>& text, const stringview& format, const range<const scan_arg>& argv) noexcept;
+
+	template<typename... Args>
+	[[nodiscard]] status scan(range<const char>& text, const stringview& format, Args&... out_values) noexcept
+	{
+		// The trailing element keeps the array from being empty
+		const scan_arg argv[]{ create_scan_arg(out_values)..., scan_arg{ nullptr, nullptr } };
+
+		return vscan(text, format, range<const scan_arg>(argv, sizeof...(Args)));
+	}
+
+	// Same as above, but fails with argument_invalid unless all of text is consumed
+	template<typename... Args>
+	[[nodiscard]] status scan(const utf8_view& text, const stringview& format, Args&... out_values) noexcept
+	{
+		range<const char> rest(text.raw_cbegin(), text.raw_cend());
+
+		check(scan(rest, format, out_values...));
+
+		if (rest.len() != 0)
+			return to_status(error::argument_invalid);
+
+		return {};
+	}
 }
 
 #endif // !OCH_FMT_INCLUDE_GUARD
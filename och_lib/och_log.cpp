@@ -0,0 +1,1353 @@
+#include "och_log.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "och_fmt.h"
+
+namespace och
+{
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////print///////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void print(rotating_log_writer& out, const stringview& format)
+	{
+		ignore_status(out.write(range<const char>(format.raw_cbegin(), format.raw_cend())));
+	}
+
+	void print(rotating_log_writer& out, const char* format)
+	{
+		print(out, och::stringview(format));
+	}
+
+	void print(rotating_log_writer& out, const utf8_string& format)
+	{
+		print(out, och::stringview(format));
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////deferred_log_format////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	// A binary log starts with deferred_log_magic, followed by a sequence of records. A definition record consists of
+	// deferred_definition_tag, the format's id, its uint16_t argument count and uint16_t text length, one arg_type per
+	// argument and finally the text. Ids are assigned consecutively, starting at 0. A message record consists of the
+	// id of a previously defined format and one uint64_t per argument. All values are little-endian.
+	static constexpr char deferred_log_magic[8]{ 'O', 'C', 'H', 'D', 'L', 'O', 'G', '1' };
+
+	static constexpr uint32_t deferred_definition_tag = 0xFFFF'FFFF;
+
+	static constexpr uint32_t deferred_definition_header_bytes = 12;
+
+	[[nodiscard]] static fmt_fn deferred_formatter(deferred::arg_type type) noexcept
+	{
+		switch (type)
+		{
+		case deferred::arg_type::u8: return create_fmt_arg_wrapper(static_cast<uint8_t>(0)).formatter;
+		case deferred::arg_type::u16: return create_fmt_arg_wrapper(static_cast<uint16_t>(0)).formatter;
+		case deferred::arg_type::u32: return create_fmt_arg_wrapper(static_cast<uint32_t>(0)).formatter;
+		case deferred::arg_type::u64: return create_fmt_arg_wrapper(static_cast<uint64_t>(0)).formatter;
+		case deferred::arg_type::i8: return create_fmt_arg_wrapper(static_cast<int8_t>(0)).formatter;
+		case deferred::arg_type::i16: return create_fmt_arg_wrapper(static_cast<int16_t>(0)).formatter;
+		case deferred::arg_type::i32: return create_fmt_arg_wrapper(static_cast<int32_t>(0)).formatter;
+		case deferred::arg_type::i64: return create_fmt_arg_wrapper(static_cast<int64_t>(0)).formatter;
+		case deferred::arg_type::f32: return create_fmt_arg_wrapper(0.0F).formatter;
+		case deferred::arg_type::f64: return create_fmt_arg_wrapper(0.0).formatter;
+		case deferred::arg_type::codepoint: return create_fmt_arg_wrapper(U'\0').formatter;
+		case deferred::arg_type::timespan: return create_fmt_arg_wrapper(timespan{ 0 }).formatter;
+		default: return nullptr;
+		}
+	}
+
+	// Writes data to a sink through its reserve and commit hooks, dropping whatever it has no space for
+	static void sink_write(const fmt_sink& sink, const char* data, uint32_t cunits) noexcept
+	{
+		while (cunits != 0)
+		{
+			const range<char> window = sink.reserve(sink.userdata, 1);
+
+			if (window.len() == 0)
+				return;
+
+			const uint32_t part = window.len() < cunits ? static_cast<uint32_t>(window.len()) : cunits;
+
+			memcpy(window.beg, data, part);
+
+			sink.commit(sink.userdata, range<char>(window.beg, part));
+
+			data += part;
+
+			cunits -= part;
+		}
+	}
+
+	struct deferred_definition
+	{
+		const char* text;
+
+		uint32_t text_cunits;
+
+		uint32_t text_cpoints;
+
+		const uint8_t* arg_types;
+
+		uint32_t arg_cnt;
+	};
+
+	[[nodiscard]] status decode_deferred_log(range<const uint8_t> binary_log, const fmt_sink& out) noexcept
+	{
+		if (binary_log.len() < sizeof(deferred_log_magic) || memcmp(binary_log.beg, deferred_log_magic, sizeof(deferred_log_magic)) != 0)
+			return to_status(error::argument_invalid);
+
+		const uint8_t* curr = binary_log.beg + sizeof(deferred_log_magic);
+
+		deferred_definition* definitions = nullptr;
+
+		uint32_t definition_cnt = 0;
+
+		uint32_t definition_cap = 0;
+
+		status rst{};
+
+		while (curr != binary_log.end)
+		{
+			if (binary_log.end - curr < 4)
+			{
+				rst = to_status(error::argument_invalid);
+
+				break;
+			}
+
+			uint32_t id;
+
+			memcpy(&id, curr, 4);
+
+			if (id == deferred_definition_tag)
+			{
+				if (binary_log.end - curr < deferred_definition_header_bytes)
+				{
+					rst = to_status(error::argument_invalid);
+
+					break;
+				}
+
+				uint32_t defined_id;
+
+				uint16_t arg_cnt, text_cunits;
+
+				memcpy(&defined_id, curr + 4, 4);
+
+				memcpy(&arg_cnt, curr + 8, 2);
+
+				memcpy(&text_cunits, curr + 10, 2);
+
+				curr += deferred_definition_header_bytes;
+
+				if (defined_id != definition_cnt || arg_cnt > deferred::MAX_ARGS || static_cast<size_t>(binary_log.end - curr) < static_cast<size_t>(arg_cnt) + text_cunits)
+				{
+					rst = to_status(error::argument_invalid);
+
+					break;
+				}
+
+				bool are_types_valid = true;
+
+				for (uint32_t i = 0; i != arg_cnt; ++i)
+					if (deferred_formatter(static_cast<deferred::arg_type>(curr[i])) == nullptr)
+						are_types_valid = false;
+
+				if (!are_types_valid)
+				{
+					rst = to_status(error::argument_invalid);
+
+					break;
+				}
+
+				if (definition_cnt == definition_cap)
+				{
+					const uint32_t new_cap = definition_cap == 0 ? 64 : definition_cap * 2;
+
+					deferred_definition* new_definitions = static_cast<deferred_definition*>(realloc(definitions, new_cap * sizeof(deferred_definition)));
+
+					if (new_definitions == nullptr)
+					{
+						rst = to_status(error::no_memory);
+
+						break;
+					}
+
+					definitions = new_definitions;
+
+					definition_cap = new_cap;
+				}
+
+				deferred_definition& def = definitions[definition_cnt++];
+
+				def.arg_types = curr;
+
+				def.arg_cnt = arg_cnt;
+
+				def.text = reinterpret_cast<const char*>(curr + arg_cnt);
+
+				def.text_cunits = text_cunits;
+
+				def.text_cpoints = 0;
+
+				for (uint32_t i = 0; i != text_cunits; ++i)
+					def.text_cpoints += (def.text[i] & 0xC0) != 0x80;
+
+				curr += arg_cnt + text_cunits;
+			}
+			else
+			{
+				if (id >= definition_cnt)
+				{
+					rst = to_status(error::argument_invalid);
+
+					break;
+				}
+
+				const deferred_definition& def = definitions[id];
+
+				if (static_cast<size_t>(binary_log.end - curr - 4) < def.arg_cnt * sizeof(uint64_t))
+				{
+					rst = to_status(error::argument_invalid);
+
+					break;
+				}
+
+				curr += 4;
+
+				arg_wrapper argv[deferred::MAX_ARGS + 1];
+
+				for (uint32_t i = 0; i != def.arg_cnt; ++i)
+				{
+					uint64_t bits;
+
+					memcpy(&bits, curr + i * sizeof(uint64_t), sizeof(uint64_t));
+
+					argv[i] = arg_wrapper{ type_union(bits), deferred_formatter(static_cast<deferred::arg_type>(def.arg_types[i])) };
+				}
+
+				vprint(out, stringview(def.text, def.text_cunits, def.text_cpoints), range<const arg_wrapper>(argv, def.arg_cnt));
+
+				curr += def.arg_cnt * sizeof(uint64_t);
+			}
+		}
+
+		free(definitions);
+
+		if (rst)
+			return to_status(rst);
+
+		return {};
+	}
+}
+
+#if defined(_WIN32)
+
+#include <Windows.h>
+
+#include "och_err.h"
+
+namespace och
+{
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*//////////////////////////////////////////////////helpers//////////////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	// rotating_log_writer stores these as opaque pointers to keep Windows.h out of the header
+	static_assert(sizeof(SRWLOCK) == sizeof(void*) && sizeof(CONDITION_VARIABLE) == sizeof(void*));
+
+	static constexpr int64_t HOUR_100NS = 60 * 600000000ll;
+
+	[[nodiscard]] static utf8_string segment_path(const utf8_string& base_path, const char* suffix) noexcept
+	{
+		utf8_string path = base_path;
+
+		path += suffix;
+
+		return path;
+	}
+
+	// Returns the first boundary after now, both in UTC 100ns ticks. For local boundaries, the current timezone bias is
+	// applied, so boundaries shift along with daylight saving changes only once the next boundary has been computed.
+	[[nodiscard]] static uint64_t next_boundary_after(uint64_t now, logfile::boundary boundary, bool is_utc) noexcept
+	{
+		if (boundary == logfile::boundary::none)
+			return ~0ull;
+
+		const int64_t bias = is_utc ? 0 : timezone_bias().val;
+
+		date d(time(now - bias));
+
+		d.m_minute = 0;
+
+		d.m_second = 0;
+
+		d.m_millisecond = 0;
+
+		int64_t step = 0;
+
+		if (boundary == logfile::boundary::hour)
+		{
+			step = HOUR_100NS;
+		}
+		else if (boundary == logfile::boundary::day)
+		{
+			d.m_hour = 0;
+
+			step = 24 * HOUR_100NS;
+		}
+		else
+		{
+			d.m_hour = 0;
+
+			d.m_monthday = 1;
+
+			if (++d.m_month == 13)
+			{
+				d.m_month = 1;
+
+				++d.m_year;
+			}
+		}
+
+		return time(d).val + step + bias;
+	}
+
+	[[nodiscard]] static status create_segment(iohandle& out_segment, const utf8_string& path, uint64_t preallocated_bytes) noexcept
+	{
+		// Segments must be shareable for deletion, as they are renamed by the background thread while still being written
+		check(open_file(out_segment, path.raw_cbegin(), fio::access::write, fio::open::truncate, fio::open::normal, fio::share::read_remove));
+
+		// Preallocation merely avoids fragmentation and metadata updates while writing, so failing it is not an error
+		FILE_ALLOCATION_INFO allocation_info;
+
+		allocation_info.AllocationSize.QuadPart = static_cast<LONGLONG>(preallocated_bytes);
+
+		SetFileInformationByHandle(out_segment.get_(), FileAllocationInfo, &allocation_info, sizeof(allocation_info));
+
+		return {};
+	}
+
+	[[nodiscard]] static status compress_segment(const utf8_string& path) noexcept
+	{
+		iohandle segment;
+
+		check(open_file(segment, path.raw_cbegin(), fio::access::read_write, fio::open::normal, fio::open::fail, fio::share::read));
+
+		USHORT compression_format = COMPRESSION_FORMAT_DEFAULT;
+
+		DWORD bytes_returned;
+
+		const BOOL compressed = DeviceIoControl(segment.get_(), FSCTL_SET_COMPRESSION, &compression_format, sizeof(compression_format), nullptr, 0, &bytes_returned, nullptr);
+
+		const DWORD compress_error = GetLastError();
+
+		ignore_status(close_file(segment));
+
+		if (!compressed)
+			return to_status(HRESULT_FROM_WIN32(compress_error));
+
+		return {};
+	}
+
+	static DWORD WINAPI log_worker_proc(void* param) noexcept
+	{
+		static_cast<rotating_log_writer*>(param)->run_worker_();
+
+		return 0;
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////rotating_log_writer///////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	// Must be called with m_lock held and m_next_ready set
+	void rotating_log_writer::rotate_() noexcept
+	{
+		m_retired_segment = m_segment;
+
+		m_segment = m_next_segment;
+
+		m_next_segment.invalidate_();
+
+		m_segment_bytes = 0;
+
+		m_next_ready = false;
+
+		m_retire_pending = true;
+
+		WakeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake));
+	}
+
+	[[nodiscard]] status rotating_log_writer::retire_(iohandle& segment) noexcept
+	{
+		check(close_file(segment));
+
+		const date now = (m_flags & logfile::flag::utc) == logfile::flag::utc ? date::utc_now() : date::local_now();
+
+		const utf8_string active_path = segment_path(m_base_path, ".log");
+
+		utf8_string archive_path;
+
+		// m_archive_cnt restarts at 0 with every create, so an archive from an earlier run within the same second may
+		// already have taken the name. In that case, the next free index is used.
+		while (true)
+		{
+			archive_path.clear();
+
+			sprint(archive_path, "{}.{:4>~0}-{:2>~0}-{:2>~0}_{:2>~0}-{:2>~0}-{:2>~0}.{}.log", m_base_path, now.year(), now.month(), now.monthday(), now.hour(), now.minute(), now.second(), m_archive_cnt++);
+
+			const status rst = rename_file(active_path.raw_cbegin(), archive_path.raw_cbegin());
+
+			if (!rst)
+				break;
+
+			if (rst.errcode() != static_cast<uint32_t>(HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS)) && rst.errcode() != static_cast<uint32_t>(HRESULT_FROM_WIN32(ERROR_FILE_EXISTS)))
+				return to_status(rst);
+		}
+
+		// The new active segment is still open under its pending name, which is fine since it shares deletion
+		check(rename_file(segment_path(m_base_path, ".next.log").raw_cbegin(), active_path.raw_cbegin()));
+
+		if ((m_flags & logfile::flag::compress) == logfile::flag::compress)
+			check(compress_segment(archive_path));
+
+		return {};
+	}
+
+	void rotating_log_writer::run_worker_() noexcept
+	{
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		CONDITION_VARIABLE* worker_wake = reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake);
+
+		CONDITION_VARIABLE* writer_wake = reinterpret_cast<CONDITION_VARIABLE*>(&m_writer_wake);
+
+		const utf8_string next_path = segment_path(m_base_path, ".next.log");
+
+		AcquireSRWLockExclusive(lock);
+
+		while (true)
+		{
+			while (!m_stop_requested && !m_retire_pending && (m_next_ready || m_background_error))
+				SleepConditionVariableSRW(worker_wake, lock, INFINITE, 0);
+
+			// Retiring comes first, since the next segment is created under the name the retired one's successor still has
+			if (m_retire_pending)
+			{
+				iohandle retired = m_retired_segment;
+
+				m_retired_segment.invalidate_();
+
+				m_retire_pending = false;
+
+				ReleaseSRWLockExclusive(lock);
+
+				status rst = retire_(retired);
+
+				AcquireSRWLockExclusive(lock);
+
+				if (rst && !m_background_error)
+				{
+					m_background_error = rst;
+
+					WakeAllConditionVariable(writer_wake);
+				}
+
+				continue;
+			}
+
+			if (m_stop_requested)
+				break;
+
+			ReleaseSRWLockExclusive(lock);
+
+			iohandle next;
+
+			status rst = create_segment(next, next_path, m_max_segment_bytes);
+
+			AcquireSRWLockExclusive(lock);
+
+			if (rst)
+			{
+				if (!m_background_error)
+					m_background_error = rst;
+			}
+			else
+			{
+				m_next_segment = next;
+
+				m_next_ready = true;
+			}
+
+			WakeAllConditionVariable(writer_wake);
+		}
+
+		ReleaseSRWLockExclusive(lock);
+	}
+
+	[[nodiscard]] status rotating_log_writer::create(const char* base_path, uint64_t max_segment_bytes, logfile::boundary boundary, logfile::flag flags) noexcept
+	{
+		check(close());
+
+		if (max_segment_bytes == 0)
+			return to_status(error::argument_invalid);
+
+		m_base_path = base_path;
+
+		m_max_segment_bytes = max_segment_bytes;
+
+		m_boundary = boundary;
+
+		m_flags = flags;
+
+		m_archive_cnt = 0;
+
+		m_next_ready = false;
+
+		m_retire_pending = false;
+
+		m_stop_requested = false;
+
+		m_background_error = status{};
+
+		InitializeSRWLock(reinterpret_cast<SRWLOCK*>(&m_lock));
+
+		InitializeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake));
+
+		InitializeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_writer_wake));
+
+		check(open_file(m_segment, segment_path(m_base_path, ".log").raw_cbegin(), fio::access::write, fio::open::append, fio::open::normal, fio::share::read_remove));
+
+		status rst = file_seek(m_segment, 0, fio::setptr::end);
+
+		if (!rst)
+			rst = get_filesize(m_segment_bytes, m_segment);
+
+		if (!rst)
+		{
+			m_next_boundary = next_boundary_after(time::now().val, m_boundary, (m_flags & logfile::flag::utc) == logfile::flag::utc);
+
+			m_worker = CreateThread(nullptr, 0, log_worker_proc, this, 0, nullptr);
+
+			if (m_worker == nullptr)
+				rst = status_from_lasterr;
+		}
+
+		if (rst)
+		{
+			ignore_status(close_file(m_segment));
+
+			return to_status(rst);
+		}
+
+		return {};
+	}
+
+	[[nodiscard]] status rotating_log_writer::write(range<const char> text) noexcept
+	{
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockExclusive(lock);
+
+		if (!m_segment)
+		{
+			ReleaseSRWLockExclusive(lock);
+
+			return to_status(error::argument_invalid);
+		}
+
+		while (!m_background_error)
+		{
+			const uint64_t now = time::now().val;
+
+			const bool is_past_boundary = m_next_boundary != ~0ull && now >= m_next_boundary;
+
+			if (is_past_boundary && m_segment_bytes == 0)
+			{
+				m_next_boundary = next_boundary_after(now, m_boundary, (m_flags & logfile::flag::utc) == logfile::flag::utc);
+
+				continue;
+			}
+
+			if (!is_past_boundary && (m_segment_bytes == 0 || m_segment_bytes + text.len() <= m_max_segment_bytes))
+				break;
+
+			// Waiting releases the lock, so another writer may have rotated in the meantime. The conditions are therefore
+			// checked again afterwards, instead of rotating away the other writer's barely used segment.
+			if (!m_next_ready)
+			{
+				SleepConditionVariableSRW(reinterpret_cast<CONDITION_VARIABLE*>(&m_writer_wake), lock, INFINITE, 0);
+
+				continue;
+			}
+
+			if (is_past_boundary)
+				m_next_boundary = next_boundary_after(now, m_boundary, (m_flags & logfile::flag::utc) == logfile::flag::utc);
+
+			rotate_();
+		}
+
+		uint32_t written = 0;
+
+		status rst = write_to_file(written, m_segment, range<const uint8_t>(reinterpret_cast<const uint8_t*>(text.beg), reinterpret_cast<const uint8_t*>(text.end)));
+
+		m_segment_bytes += written;
+
+		if (!rst && m_background_error)
+			rst = m_background_error;
+
+		ReleaseSRWLockExclusive(lock);
+
+		if (rst)
+			return to_status(rst);
+
+		return {};
+	}
+
+	[[nodiscard]] status rotating_log_writer::flush() noexcept
+	{
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockExclusive(lock);
+
+		status rst = m_background_error;
+
+		if (!m_segment)
+			rst = to_status(error::argument_invalid);
+		else if (!FlushFileBuffers(m_segment.get_()) && !rst)
+			rst = status_from_lasterr;
+
+		ReleaseSRWLockExclusive(lock);
+
+		if (rst)
+			return to_status(rst);
+
+		return {};
+	}
+
+	[[nodiscard]] status rotating_log_writer::close() noexcept
+	{
+		if (m_worker == nullptr)
+			return {};
+
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockExclusive(lock);
+
+		m_stop_requested = true;
+
+		WakeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake));
+
+		ReleaseSRWLockExclusive(lock);
+
+		// The worker finishes retiring the previous segment before it exits
+		WaitForSingleObject(m_worker, INFINITE);
+
+		CloseHandle(m_worker);
+
+		m_worker = nullptr;
+
+		status rst = m_background_error;
+
+		if (m_next_segment)
+		{
+			ignore_status(close_file(m_next_segment));
+
+			ignore_status(delete_file(segment_path(m_base_path, ".next.log").raw_cbegin()));
+		}
+
+		if (status close_rst = close_file(m_segment))
+			if (!rst)
+				rst = close_rst;
+
+		m_segment.invalidate_();
+
+		if (rst)
+			return to_status(rst);
+
+		return {};
+	}
+
+	rotating_log_writer::~rotating_log_writer() noexcept
+	{
+		ignore_status(close());
+	}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////deferred_log_writer///////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	static constexpr uint32_t DEFERRED_MIN_QUEUE_WORDS = 512;
+
+	static constexpr uint32_t DEFERRED_BATCH_CUNITS = 65536;
+
+	// Single-producer single-consumer ring of uint64_t words. Messages are never split across the end of the ring; a word
+	// of 0, which is never a valid format_info address, tells the consumer to continue at the start instead.
+	// head and tail count words written and consumed since creation. Only the producer writes head and dropped_cnt
+	// and only the consumer writes tail. Publishing head with release and reading it with acquire makes the words of a
+	// message visible before the consumer sees it, and the same pairing on tail keeps the producer from overwriting
+	// words that are still being read.
+	struct deferred_queue
+	{
+		deferred_queue* next;
+
+		DWORD thread_id;
+
+		uint32_t word_mask;
+
+		uint64_t* words;
+
+		alignas(64) std::atomic<uint64_t> head;
+
+		uint64_t cached_tail;
+
+		std::atomic<uint64_t> dropped_cnt;
+
+		alignas(64) std::atomic<uint64_t> tail;
+	};
+
+	struct deferred_format_slot
+	{
+		const deferred::format_info* format;
+
+		uint32_t id;
+	};
+
+	// State only touched by the background thread. Output is collected in batch before being handed to the sink, and
+	// format ids for binary logs are kept in an open-addressed table keyed by format_info address.
+	struct deferred_background
+	{
+		fmt_sink out;
+
+		uint32_t batch_used;
+
+		uint32_t format_cnt;
+
+		uint32_t format_slot_mask;
+
+		deferred_format_slot* format_slots;
+
+		char batch[DEFERRED_BATCH_CUNITS];
+	};
+
+	static volatile LONG64 deferred_instance_cnt = 0;
+
+	static constexpr uint32_t DEFERRED_THREAD_CACHE_SLOTS = 8;
+
+	// Per-thread cache of the queues this thread owns, keyed by writer instance id. Instance ids are never reused, so
+	// slots left behind by closed writers simply stop matching. Threads feeding more writers than there are slots fall
+	// back to the locked lookup in queue_ for the evicted ones.
+	struct deferred_thread_cache_slot
+	{
+		uint64_t owner;
+
+		deferred_queue* queue;
+	};
+
+	static thread_local deferred_thread_cache_slot deferred_thread_cache[DEFERRED_THREAD_CACHE_SLOTS]{};
+
+	static thread_local uint32_t deferred_thread_cache_next = 0;
+
+	static void deferred_batch_forward(deferred_background& bg) noexcept
+	{
+		sink_write(bg.out, bg.batch, bg.batch_used);
+
+		bg.batch_used = 0;
+	}
+
+	static range<char> deferred_batch_reserve(void* userdata, uint32_t min_cunits) noexcept
+	{
+		deferred_background& bg = *static_cast<deferred_background*>(userdata);
+
+		if (DEFERRED_BATCH_CUNITS - bg.batch_used < min_cunits)
+			deferred_batch_forward(bg);
+
+		return range<char>(bg.batch + bg.batch_used, bg.batch + DEFERRED_BATCH_CUNITS);
+	}
+
+	static void deferred_batch_commit(void* userdata, range<char> written) noexcept
+	{
+		static_cast<deferred_background*>(userdata)->batch_used += static_cast<uint32_t>(written.len());
+	}
+
+	static void deferred_batch_put(deferred_background& bg, const void* data, uint32_t bytes) noexcept
+	{
+		if (DEFERRED_BATCH_CUNITS - bg.batch_used < bytes)
+			deferred_batch_forward(bg);
+
+		if (bytes > DEFERRED_BATCH_CUNITS)
+		{
+			sink_write(bg.out, static_cast<const char*>(data), bytes);
+
+			return;
+		}
+
+		memcpy(bg.batch + bg.batch_used, data, bytes);
+
+		bg.batch_used += bytes;
+	}
+
+	// Returns the id of format, writing its definition first if it has not been seen before, or ~0u if memory ran out
+	[[nodiscard]] static uint32_t deferred_format_id(deferred_background& bg, const deferred::format_info* format) noexcept
+	{
+		uint32_t slot = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(format) >> 3) & bg.format_slot_mask;
+
+		while (bg.format_slots[slot].format != nullptr)
+		{
+			if (bg.format_slots[slot].format == format)
+				return bg.format_slots[slot].id;
+
+			slot = (slot + 1) & bg.format_slot_mask;
+		}
+
+		// Keep the table at most half full
+		if ((bg.format_cnt + 1) * 2 > bg.format_slot_mask + 1)
+		{
+			const uint32_t new_mask = bg.format_slot_mask * 2 + 1;
+
+			deferred_format_slot* new_slots = static_cast<deferred_format_slot*>(calloc(new_mask + 1, sizeof(deferred_format_slot)));
+
+			if (new_slots == nullptr)
+				return ~0u;
+
+			for (uint32_t i = 0; i != bg.format_slot_mask + 1; ++i)
+			{
+				if (bg.format_slots[i].format == nullptr)
+					continue;
+
+				uint32_t new_slot = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(bg.format_slots[i].format) >> 3) & new_mask;
+
+				while (new_slots[new_slot].format != nullptr)
+					new_slot = (new_slot + 1) & new_mask;
+
+				new_slots[new_slot] = bg.format_slots[i];
+			}
+
+			free(bg.format_slots);
+
+			bg.format_slots = new_slots;
+
+			bg.format_slot_mask = new_mask;
+
+			slot = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(format) >> 3) & new_mask;
+
+			while (new_slots[slot].format != nullptr)
+				slot = (slot + 1) & new_mask;
+		}
+
+		const uint32_t id = bg.format_cnt++;
+
+		bg.format_slots[slot] = { format, id };
+
+		const uint16_t arg_cnt = static_cast<uint16_t>(format->arg_cnt);
+
+		const uint16_t text_cunits = static_cast<uint16_t>(strlen(format->text));
+
+		deferred_batch_put(bg, &deferred_definition_tag, 4);
+
+		deferred_batch_put(bg, &id, 4);
+
+		deferred_batch_put(bg, &arg_cnt, 2);
+
+		deferred_batch_put(bg, &text_cunits, 2);
+
+		deferred_batch_put(bg, format->arg_types, arg_cnt);
+
+		deferred_batch_put(bg, format->text, text_cunits);
+
+		return id;
+	}
+
+	static void deferred_write_message(deferred_background& bg, deferred::mode mode, const deferred::format_info* format, const uint64_t* values) noexcept
+	{
+		if (mode == deferred::mode::binary)
+		{
+			const uint32_t id = deferred_format_id(bg, format);
+
+			if (id == ~0u)
+				return;
+
+			deferred_batch_put(bg, &id, 4);
+
+			deferred_batch_put(bg, values, format->arg_cnt * static_cast<uint32_t>(sizeof(uint64_t)));
+
+			return;
+		}
+
+		arg_wrapper argv[deferred::MAX_ARGS + 1];
+
+		for (uint32_t i = 0; i != format->arg_cnt; ++i)
+			argv[i] = arg_wrapper{ type_union(values[i]), deferred_formatter(format->arg_types[i]) };
+
+		const fmt_sink batch_sink{ deferred_batch_reserve, deferred_batch_commit, nullptr, &bg };
+
+		vprint(batch_sink, format->text, range<const compiled_placeholder>(format->placeholders, format->placeholder_cnt), range<const arg_wrapper>(argv, format->arg_cnt));
+	}
+
+	// Writes out everything that was in q when called. Returns whether there was anything.
+	static bool deferred_drain(deferred_background& bg, deferred::mode mode, deferred_queue& q) noexcept
+	{
+		uint64_t tail = q.tail.load(std::memory_order_relaxed);
+
+		const uint64_t head = q.head.load(std::memory_order_acquire);
+
+		if (tail == head)
+			return false;
+
+		while (tail != head)
+		{
+			const uint32_t index = static_cast<uint32_t>(tail) & q.word_mask;
+
+			if (q.words[index] == 0)
+			{
+				tail += q.word_mask + 1 - index;
+
+				continue;
+			}
+
+			const deferred::format_info* format = reinterpret_cast<const deferred::format_info*>(q.words[index]);
+
+			deferred_write_message(bg, mode, format, q.words + index + 1);
+
+			tail += format->arg_cnt + 1;
+		}
+
+		q.tail.store(tail, std::memory_order_release);
+
+		return true;
+	}
+
+	static DWORD WINAPI deferred_worker_proc(void* param) noexcept
+	{
+		static_cast<deferred_log_writer*>(param)->run_worker_();
+
+		return 0;
+	}
+
+	void* deferred_log_writer::queue_() noexcept
+	{
+		for (const deferred_thread_cache_slot& slot : deferred_thread_cache)
+			if (slot.owner == m_instance_id)
+				return slot.queue;
+
+		const DWORD thread_id = GetCurrentThreadId();
+
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockExclusive(lock);
+
+		deferred_queue* q = static_cast<deferred_queue*>(m_queues);
+
+		while (q != nullptr && q->thread_id != thread_id)
+			q = q->next;
+
+		// Queues are only freed by close, so a thread that exited leaves its queue to a later thread with the same id
+		if (q == nullptr)
+		{
+			q = static_cast<deferred_queue*>(_aligned_malloc(sizeof(deferred_queue), alignof(deferred_queue)));
+
+			uint64_t* words = static_cast<uint64_t*>(malloc(static_cast<size_t>(m_queue_words) * sizeof(uint64_t)));
+
+			if (q == nullptr || words == nullptr)
+			{
+				_aligned_free(q);
+
+				free(words);
+
+				++m_unqueued_dropped_cnt;
+
+				ReleaseSRWLockExclusive(lock);
+
+				return nullptr;
+			}
+
+			new (q) deferred_queue{};
+
+			q->thread_id = thread_id;
+
+			q->word_mask = m_queue_words - 1;
+
+			q->words = words;
+
+			q->next = static_cast<deferred_queue*>(m_queues);
+
+			m_queues = q;
+		}
+
+		ReleaseSRWLockExclusive(lock);
+
+		deferred_thread_cache_slot& slot = deferred_thread_cache[deferred_thread_cache_next];
+
+		deferred_thread_cache_next = (deferred_thread_cache_next + 1) % DEFERRED_THREAD_CACHE_SLOTS;
+
+		slot.owner = m_instance_id;
+
+		slot.queue = q;
+
+		return q;
+	}
+
+	void deferred_log_writer::push_(const uint64_t* words, uint32_t word_cnt) noexcept
+	{
+		if (m_worker == nullptr)
+			return;
+
+		deferred_queue* q = static_cast<deferred_queue*>(queue_());
+
+		if (q == nullptr)
+			return;
+
+		uint64_t head = q->head.load(std::memory_order_relaxed);
+
+		const uint32_t index = static_cast<uint32_t>(head) & q->word_mask;
+
+		const uint32_t contiguous = q->word_mask + 1 - index;
+
+		const uint32_t needed = contiguous < word_cnt ? contiguous + word_cnt : word_cnt;
+
+		if (head + needed - q->cached_tail > q->word_mask + 1)
+		{
+			q->cached_tail = q->tail.load(std::memory_order_acquire);
+
+			if (head + needed - q->cached_tail > q->word_mask + 1)
+			{
+				q->dropped_cnt.store(q->dropped_cnt.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+				return;
+			}
+		}
+
+		if (contiguous < word_cnt)
+		{
+			q->words[index] = 0;
+
+			head += contiguous;
+		}
+
+		memcpy(q->words + (static_cast<uint32_t>(head) & q->word_mask), words, word_cnt * sizeof(uint64_t));
+
+		q->head.store(head + word_cnt, std::memory_order_release);
+	}
+
+	void deferred_log_writer::run_worker_() noexcept
+	{
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		deferred_background& bg = *static_cast<deferred_background*>(m_background);
+
+		AcquireSRWLockExclusive(lock);
+
+		while (true)
+		{
+			// Everything read here is from before the pass, so a stop or flush request is only acknowledged after a pass
+			// that started after it was made
+			const uint64_t flush_target = m_flush_requested;
+
+			const bool is_stopping = m_stop_requested;
+
+			deferred_queue* const queues = static_cast<deferred_queue*>(m_queues);
+
+			ReleaseSRWLockExclusive(lock);
+
+			bool has_drained = false;
+
+			for (deferred_queue* q = queues; q != nullptr; q = q->next)
+				has_drained |= deferred_drain(bg, m_mode, *q);
+
+			if (bg.batch_used != 0)
+				deferred_batch_forward(bg);
+
+			if (has_drained && bg.out.flush != nullptr)
+				bg.out.flush(bg.out.userdata);
+
+			AcquireSRWLockExclusive(lock);
+
+			if (m_flush_completed != flush_target)
+			{
+				m_flush_completed = flush_target;
+
+				WakeAllConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_flush_done));
+			}
+
+			if (is_stopping)
+				break;
+
+			if (!has_drained && !m_stop_requested && m_flush_requested == flush_target)
+				SleepConditionVariableSRW(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake), lock, m_poll_interval_ms, 0);
+		}
+
+		ReleaseSRWLockExclusive(lock);
+	}
+
+	[[nodiscard]] status deferred_log_writer::create(const fmt_sink& out, deferred::mode mode, uint32_t queue_bytes, uint32_t poll_interval_ms) noexcept
+	{
+		check(close());
+
+		if (out.reserve == nullptr || out.commit == nullptr || (mode != deferred::mode::text && mode != deferred::mode::binary))
+			return to_status(error::argument_invalid);
+
+		uint32_t queue_words = DEFERRED_MIN_QUEUE_WORDS;
+
+		while (queue_words < queue_bytes / sizeof(uint64_t))
+		{
+			if (queue_words == 0x8000'0000)
+				return to_status(error::argument_too_large);
+
+			queue_words *= 2;
+		}
+
+		deferred_background* bg = static_cast<deferred_background*>(malloc(sizeof(deferred_background)));
+
+		deferred_format_slot* format_slots = static_cast<deferred_format_slot*>(calloc(64, sizeof(deferred_format_slot)));
+
+		if (bg == nullptr || format_slots == nullptr)
+		{
+			free(bg);
+
+			free(format_slots);
+
+			return to_status(error::no_memory);
+		}
+
+		bg->out = out;
+
+		bg->batch_used = 0;
+
+		bg->format_cnt = 0;
+
+		bg->format_slot_mask = 63;
+
+		bg->format_slots = format_slots;
+
+		if (mode == deferred::mode::binary)
+			deferred_batch_put(*bg, deferred_log_magic, sizeof(deferred_log_magic));
+
+		m_mode = mode;
+
+		m_queue_words = queue_words;
+
+		m_poll_interval_ms = poll_interval_ms;
+
+		m_instance_id = static_cast<uint64_t>(InterlockedIncrement64(&deferred_instance_cnt));
+
+		m_flush_requested = 0;
+
+		m_flush_completed = 0;
+
+		m_queues = nullptr;
+
+		m_unqueued_dropped_cnt = 0;
+
+		m_background = bg;
+
+		m_stop_requested = false;
+
+		InitializeSRWLock(reinterpret_cast<SRWLOCK*>(&m_lock));
+
+		InitializeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake));
+
+		InitializeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_flush_done));
+
+		m_worker = CreateThread(nullptr, 0, deferred_worker_proc, this, 0, nullptr);
+
+		if (m_worker == nullptr)
+		{
+			const status rst = status_from_lasterr;
+
+			free(format_slots);
+
+			free(bg);
+
+			m_background = nullptr;
+
+			return to_status(rst);
+		}
+
+		return {};
+	}
+
+	[[nodiscard]] status deferred_log_writer::flush() noexcept
+	{
+		if (m_worker == nullptr)
+			return to_status(error::argument_invalid);
+
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockExclusive(lock);
+
+		const uint64_t target = ++m_flush_requested;
+
+		WakeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake));
+
+		while (m_flush_completed < target)
+			SleepConditionVariableSRW(reinterpret_cast<CONDITION_VARIABLE*>(&m_flush_done), lock, INFINITE, 0);
+
+		ReleaseSRWLockExclusive(lock);
+
+		return {};
+	}
+
+	[[nodiscard]] status deferred_log_writer::close() noexcept
+	{
+		if (m_worker == nullptr)
+			return {};
+
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockExclusive(lock);
+
+		m_stop_requested = true;
+
+		WakeConditionVariable(reinterpret_cast<CONDITION_VARIABLE*>(&m_worker_wake));
+
+		ReleaseSRWLockExclusive(lock);
+
+		// The worker makes one last pass over all queues before it exits
+		WaitForSingleObject(m_worker, INFINITE);
+
+		CloseHandle(m_worker);
+
+		m_worker = nullptr;
+
+		deferred_queue* q = static_cast<deferred_queue*>(m_queues);
+
+		while (q != nullptr)
+		{
+			deferred_queue* next = q->next;
+
+			free(q->words);
+
+			_aligned_free(q);
+
+			q = next;
+		}
+
+		m_queues = nullptr;
+
+		deferred_background* bg = static_cast<deferred_background*>(m_background);
+
+		free(bg->format_slots);
+
+		free(bg);
+
+		m_background = nullptr;
+
+		return {};
+	}
+
+	[[nodiscard]] uint64_t deferred_log_writer::dropped_messages() noexcept
+	{
+		if (m_worker == nullptr)
+			return 0;
+
+		SRWLOCK* lock = reinterpret_cast<SRWLOCK*>(&m_lock);
+
+		AcquireSRWLockShared(lock);
+
+		uint64_t dropped_cnt = m_unqueued_dropped_cnt;
+
+		for (const deferred_queue* q = static_cast<const deferred_queue*>(m_queues); q != nullptr; q = q->next)
+			dropped_cnt += q->dropped_cnt.load(std::memory_order_relaxed);
+
+		ReleaseSRWLockShared(lock);
+
+		return dropped_cnt;
+	}
+
+	deferred_log_writer::~deferred_log_writer() noexcept
+	{
+		ignore_status(close());
+	}
+}
+
+#elif defined(__linux__)
+
+namespace och
+{
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////rotating_log_writer///////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void rotating_log_writer::rotate_() noexcept {}
+
+	[[nodiscard]] status rotating_log_writer::retire_(iohandle& segment) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	void rotating_log_writer::run_worker_() noexcept {}
+
+	[[nodiscard]] status rotating_log_writer::create(const char* base_path, uint64_t max_segment_bytes, logfile::boundary boundary, logfile::flag flags) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status rotating_log_writer::write(range<const char> text) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status rotating_log_writer::flush() noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status rotating_log_writer::close() noexcept
+	{
+		return {};
+	}
+
+	rotating_log_writer::~rotating_log_writer() noexcept {}
+
+
+
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+	/*/////////////////////////////////////////////deferred_log_writer///////////////////////////////////////////////////////*/
+	/*///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////*/
+
+	void* deferred_log_writer::queue_() noexcept
+	{
+		return nullptr;
+	}
+
+	void deferred_log_writer::push_(const uint64_t* words, uint32_t word_cnt) noexcept {}
+
+	void deferred_log_writer::run_worker_() noexcept {}
+
+	[[nodiscard]] status deferred_log_writer::create(const fmt_sink& out, deferred::mode mode, uint32_t queue_bytes, uint32_t poll_interval_ms) noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status deferred_log_writer::flush() noexcept
+	{
+		return to_status(error::function_unavailable);
+	}
+
+	[[nodiscard]] status deferred_log_writer::close() noexcept
+	{
+		return {};
+	}
+
+	[[nodiscard]] uint64_t deferred_log_writer::dropped_messages() noexcept
+	{
+		return 0;
+	}
+
+	deferred_log_writer::~deferred_log_writer() noexcept {}
+}
+
+#endif // OS-Selection
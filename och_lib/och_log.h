@@ -0,0 +1,370 @@
+#define OCH_LOG_PRESENT
+
+#ifndef OCH_LOG_INCLUDE_GUARD
+#define OCH_LOG_INCLUDE_GUARD
+
+#include <cstdint>
+#include <type_traits>
+
+#include "och_range.h"
+#include "och_time.h"
+#include "och_utf8.h"
+#include "och_err.h"
+#include "och_fio.h"
+#include "och_fmt.h"
+
+namespace och
+{
+	namespace logfile
+	{
+		enum class boundary : uint32_t
+		{
+			none = 0,
+			hour = 1,
+			day = 2,
+			month = 3,
+		};
+
+		enum class flag : uint32_t
+		{
+			normal = 0,
+			compress = 1, // Compress retired segments using the filesystem's transparent compression
+			utc = 2, // Place date boundaries and archive timestamps in UTC instead of local time
+		};
+
+		constexpr flag operator|(flag l, flag r) noexcept
+		{
+			return static_cast<flag>(static_cast<uint32_t>(l) | static_cast<uint32_t>(r));
+		}
+
+		constexpr flag operator&(flag l, flag r) noexcept
+		{
+			return static_cast<flag>(static_cast<uint32_t>(l) & static_cast<uint32_t>(r));
+		}
+	}
+
+	// Appends to <base_path>.log, switching to a fresh segment once the current one would exceed max_segment_bytes or a
+	// date boundary has passed. The next segment is created and preallocated by a background thread ahead of time, so
+	// rotating only swaps handles on the writing thread. Retired segments are renamed to
+	// <base_path>.<yyyy-mm-dd_hh-mm-ss>.<n>.log and optionally compressed by the same background thread.
+	// All member functions may be called concurrently. Once an error is encountered in the background, it is returned by
+	// every subsequent call to write, flush and close, and writes continue into the current segment without rotating.
+	struct rotating_log_writer
+	{
+		static constexpr uint32_t INLINE_MESSAGE_CUNITS = 1024;
+
+	private:
+
+		utf8_string m_base_path;
+
+		uint64_t m_max_segment_bytes = 0;
+
+		uint64_t m_segment_bytes = 0;
+
+		uint64_t m_next_boundary = ~0ull;
+
+		logfile::boundary m_boundary = logfile::boundary::none;
+
+		logfile::flag m_flags = logfile::flag::normal;
+
+		uint32_t m_archive_cnt = 0; // Only used by the worker once created
+
+		iohandle m_segment;
+
+		iohandle m_next_segment;
+
+		iohandle m_retired_segment;
+
+		void* m_worker = nullptr;
+
+		void* m_lock = nullptr;
+
+		void* m_worker_wake = nullptr;
+
+		void* m_writer_wake = nullptr;
+
+		bool m_next_ready = false;
+
+		bool m_retire_pending = false;
+
+		bool m_stop_requested = false;
+
+		status m_background_error;
+
+		void rotate_() noexcept;
+
+		[[nodiscard]] status retire_(iohandle& segment) noexcept;
+
+	public:
+
+		rotating_log_writer() noexcept = default;
+
+		rotating_log_writer(const rotating_log_writer&) = delete;
+
+		rotating_log_writer(rotating_log_writer&&) = delete;
+
+		[[nodiscard]] status create(const char* base_path, uint64_t max_segment_bytes, logfile::boundary boundary = logfile::boundary::none, logfile::flag flags = logfile::flag::normal) noexcept;
+
+		[[nodiscard]] status write(range<const char> text) noexcept;
+
+		[[nodiscard]] status flush() noexcept;
+
+		[[nodiscard]] status close() noexcept;
+
+		~rotating_log_writer() noexcept;
+
+		// Only for use by the background thread
+		void run_worker_() noexcept;
+	};
+
+
+
+	template<typename... Args>
+	void print(rotating_log_writer& out, const stringview& format, Args... args)
+	{
+		// Messages are formatted in full before being written, so that a message never straddles two segments
+		char buf[rotating_log_writer::INLINE_MESSAGE_CUNITS];
+
+		const uint32_t cunits = sprint(range<char>(buf), format, args...);
+
+		if (cunits < sizeof(buf))
+		{
+			ignore_status(out.write(range<const char>(buf, cunits)));
+
+			return;
+		}
+
+		utf8_string long_message;
+
+		sprint(long_message, format, args...);
+
+		ignore_status(out.write(range<const char>(long_message.raw_cbegin(), long_message.get_codeunits())));
+	}
+
+	template<typename... Args>
+	void print(rotating_log_writer& out, const char* format, Args... args)
+	{
+		print(out, och::stringview(format), args...);
+	}
+
+	template<fmt_literal Format, typename... Args>
+	void print(rotating_log_writer& out, fmt_string<Format> format, Args... args)
+	{
+		char buf[rotating_log_writer::INLINE_MESSAGE_CUNITS];
+
+		const uint32_t cunits = sprint(range<char>(buf), format, args...);
+
+		if (cunits < sizeof(buf))
+		{
+			ignore_status(out.write(range<const char>(buf, cunits)));
+
+			return;
+		}
+
+		utf8_string long_message;
+
+		sprint(long_message, format, args...);
+
+		ignore_status(out.write(range<const char>(long_message.raw_cbegin(), long_message.get_codeunits())));
+	}
+
+	template<typename... Args>
+	void print(rotating_log_writer& out, const utf8_string& format, Args... args)
+	{
+		print(out, och::stringview(format), args...);
+	}
+
+
+
+	void print(rotating_log_writer& out, const stringview& format);
+
+	void print(rotating_log_writer& out, const char* format);
+
+	void print(rotating_log_writer& out, const utf8_string& format);
+
+
+
+	namespace deferred
+	{
+		// Type of an argument stored in a deferred message. The values are part of the binary log format.
+		enum class arg_type : uint8_t
+		{
+			u8 = 0,
+			u16 = 1,
+			u32 = 2,
+			u64 = 3,
+			i8 = 4,
+			i16 = 5,
+			i32 = 6,
+			i64 = 7,
+			f32 = 8,
+			f64 = 9,
+			codepoint = 10,
+			timespan = 11,
+			highres_timespan = 12, // Reserved; arg_traits rejects highres_timespan until fmt_highres_timespan is implemented
+		};
+
+		enum class mode : uint32_t
+		{
+			text = 0, // Messages are formatted by the background thread and written out as text
+			binary = 1, // Format strings are written once and messages as raw argument values, for decode_deferred_log
+		};
+
+		static constexpr uint32_t MAX_ARGS = 32;
+
+		// Only arguments that are fully captured by their value can be deferred. Strings and other arguments passed by
+		// reference may already be gone by the time the background thread gets to them.
+		template<typename T>
+		struct arg_traits
+		{
+			static_assert(!std::is_same_v<T, highres_timespan>, "Deferred messages do not support highres_timespan yet, since fmt_highres_timespan is not implemented");
+
+			static_assert(std::is_same_v<T, highres_timespan> || sizeof(T) == 0, "Deferred messages only support integer, floating-point, character and timespan arguments");
+		};
+
+		template<> struct arg_traits<uint8_t> { static constexpr arg_type type = arg_type::u8; static uint64_t bits(uint8_t v) noexcept { return v; } };
+
+		template<> struct arg_traits<uint16_t> { static constexpr arg_type type = arg_type::u16; static uint64_t bits(uint16_t v) noexcept { return v; } };
+
+		template<> struct arg_traits<uint32_t> { static constexpr arg_type type = arg_type::u32; static uint64_t bits(uint32_t v) noexcept { return v; } };
+
+		template<> struct arg_traits<uint64_t> { static constexpr arg_type type = arg_type::u64; static uint64_t bits(uint64_t v) noexcept { return v; } };
+
+		template<> struct arg_traits<int8_t> { static constexpr arg_type type = arg_type::i8; static uint64_t bits(int8_t v) noexcept { return static_cast<uint8_t>(v); } };
+
+		template<> struct arg_traits<int16_t> { static constexpr arg_type type = arg_type::i16; static uint64_t bits(int16_t v) noexcept { return static_cast<uint16_t>(v); } };
+
+		template<> struct arg_traits<int32_t> { static constexpr arg_type type = arg_type::i32; static uint64_t bits(int32_t v) noexcept { return static_cast<uint32_t>(v); } };
+
+		template<> struct arg_traits<int64_t> { static constexpr arg_type type = arg_type::i64; static uint64_t bits(int64_t v) noexcept { return static_cast<uint64_t>(v); } };
+
+		template<> struct arg_traits<float> { static constexpr arg_type type = arg_type::f32; static uint64_t bits(float v) noexcept { type_union u(static_cast<uint64_t>(0)); u.f32 = v; return u.u64; } };
+
+		template<> struct arg_traits<double> { static constexpr arg_type type = arg_type::f64; static uint64_t bits(double v) noexcept { return type_union(v).u64; } };
+
+		template<> struct arg_traits<char> { static constexpr arg_type type = arg_type::codepoint; static uint64_t bits(char v) noexcept { return utf8_char(v).intval(); } };
+
+		template<> struct arg_traits<char32_t> { static constexpr arg_type type = arg_type::codepoint; static uint64_t bits(char32_t v) noexcept { return utf8_char(v).intval(); } };
+
+		template<> struct arg_traits<utf8_char> { static constexpr arg_type type = arg_type::codepoint; static uint64_t bits(utf8_char v) noexcept { return v.intval(); } };
+
+		template<> struct arg_traits<timespan> { static constexpr arg_type type = arg_type::timespan; static uint64_t bits(timespan v) noexcept { return static_cast<uint64_t>(v.val); } };
+
+		// Everything the background thread needs to know about a message besides its argument values. There is exactly
+		// one per combination of format string and argument types, and its address identifies it in the message queues.
+		struct format_info
+		{
+			const char* text;
+
+			const compiled_placeholder* placeholders;
+
+			uint32_t placeholder_cnt;
+
+			uint32_t arg_cnt;
+
+			const arg_type* arg_types;
+		};
+
+		template<fmt_literal Format, typename... Args>
+		struct format_for
+		{
+			// The trailing element keeps the array from being empty
+			static constexpr arg_type arg_types[]{ arg_traits<Args>::type..., arg_type::u8 };
+
+			static constexpr format_info info{ fmt_string<Format>::text(), fmt_string<Format>::placeholders().beg, fmt_string<Format>::placeholder_cnt, static_cast<uint32_t>(sizeof...(Args)), arg_types };
+		};
+	}
+
+	// Moves formatting off latency-critical threads. Logging a message only copies the address of its format_info and
+	// the raw argument values into a lock-free queue owned by the calling thread. A background thread polls all queues,
+	// runs the formatters and writes the result to out, or in binary mode writes the raw values for decoding later.
+	// If a thread's queue is full, its messages are dropped and counted instead of blocking the caller. out is only used
+	// by the background thread and must remain valid until close.
+	struct deferred_log_writer
+	{
+		static constexpr uint32_t DEFAULT_QUEUE_BYTES = 65536;
+
+		static constexpr uint32_t DEFAULT_POLL_INTERVAL_MS = 1;
+
+	private:
+
+		deferred::mode m_mode = deferred::mode::text;
+
+		uint32_t m_queue_words = 0;
+
+		uint32_t m_poll_interval_ms = 0;
+
+		uint64_t m_instance_id = 0;
+
+		uint64_t m_flush_requested = 0;
+
+		uint64_t m_flush_completed = 0;
+
+		void* m_queues = nullptr;
+
+		// Messages dropped because no queue could be allocated for the logging thread. Guarded by m_lock.
+		uint64_t m_unqueued_dropped_cnt = 0;
+
+		void* m_background = nullptr;
+
+		void* m_worker = nullptr;
+
+		void* m_lock = nullptr;
+
+		void* m_worker_wake = nullptr;
+
+		void* m_flush_done = nullptr;
+
+		bool m_stop_requested = false;
+
+		void* queue_() noexcept;
+
+		void push_(const uint64_t* words, uint32_t word_cnt) noexcept;
+
+	public:
+
+		deferred_log_writer() noexcept = default;
+
+		deferred_log_writer(const deferred_log_writer&) = delete;
+
+		deferred_log_writer(deferred_log_writer&&) = delete;
+
+		[[nodiscard]] status create(const fmt_sink& out, deferred::mode mode = deferred::mode::text, uint32_t queue_bytes = DEFAULT_QUEUE_BYTES, uint32_t poll_interval_ms = DEFAULT_POLL_INTERVAL_MS) noexcept;
+
+		template<fmt_literal Format, typename... Args>
+		void log(fmt_string<Format> format, Args... args) noexcept
+		{
+			static_assert(sizeof...(Args) == fmt_string<Format>::arg_cnt, "Number of arguments does not match the format string");
+
+			static_assert(sizeof...(Args) <= deferred::MAX_ARGS, "Too many arguments for a deferred message");
+
+			const uint64_t record[]{ reinterpret_cast<uint64_t>(&deferred::format_for<Format, Args...>::info), deferred::arg_traits<Args>::bits(args)... };
+
+			push_(record, static_cast<uint32_t>(sizeof...(Args) + 1));
+		}
+
+		// Blocks until all messages logged before the call have been handed to out
+		[[nodiscard]] status flush() noexcept;
+
+		[[nodiscard]] status close() noexcept;
+
+		[[nodiscard]] uint64_t dropped_messages() noexcept;
+
+		~deferred_log_writer() noexcept;
+
+		// Only for use by the background thread
+		void run_worker_() noexcept;
+	};
+
+	template<fmt_literal Format, typename... Args>
+	void print(deferred_log_writer& out, fmt_string<Format> format, Args... args)
+	{
+		out.log(format, args...);
+	}
+
+	// Formats a log written by a deferred_log_writer in deferred::mode::binary. Fails with argument_invalid if
+	// binary_log is malformed or ends in an incomplete message, after writing out all messages preceding the defect.
+	[[nodiscard]] status decode_deferred_log(range<const uint8_t> binary_log, const fmt_sink& out) noexcept;
+}
+
+#endif // !OCH_LOG_INCLUDE_GUARD
@@ -4,12 +4,31 @@
 #define OCH_UTF8_INCLUDE_GUARD
 
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "och_range.h"
 
 namespace och
 {
 	struct utf8_string;
 
-	void _utf8_len(const char* cstring, uint32_t& cunits, uint32_t& cpoints, uint32_t max_cunits = ~0) noexcept;
+	// Advances cunits over cstring until its terminator or until cpoints reaches max_cpoints, adding the codepoints passed
+	// to cpoints. Both start out at the position to continue from, usually 0.
+	void _utf8_len(const char* cstring, uint32_t& cunits, uint32_t& cpoints, uint32_t max_cpoints = ~0) noexcept;
+
+	// Number of codepoints in the first cunits code units of cstring, which need not be null-terminated
+	uint32_t _utf8_count_codepoints(const char* cstring, uint32_t cunits) noexcept;
+
+	// Number of terminal columns taken up by cpoint; 0 for combining marks and other zero-width codepoints, 2 for East Asian Wide and Fullwidth ones
+	uint32_t _codepoint_display_width(char32_t cpoint) noexcept;
+
+	// Sum of _codepoint_display_width over the first cunits code units of cstring
+	uint32_t _utf8_display_width(const char* cstring, uint32_t cunits) noexcept;
+
+	// Returns whether text is well-formed UTF-8, i.e. free of stray continuation bytes, truncated and overlong sequences,
+	// surrogates and codepoints above U+10FFFF. Uses AVX2 or SSSE3 if the CPU supports them.
+	bool validate_utf8(range<const char> text) noexcept;
 
 	constexpr uint32_t _utf8_from_codepoint(char* out, char32_t cpoint) noexcept
 	{
@@ -245,10 +264,24 @@ namespace och
 
 	public:
 
-		constexpr utf8_view(const char* cstring) noexcept :
-			m_ptr{ cstring },
-			m_codeunits{ _init_codeunits(cstring) },
-			m_codepoints{ _init_codepoints(cstring) } {}
+		// Empty, but still refers to a null-terminated string
+		constexpr utf8_view() noexcept : m_ptr{ "" }, m_codeunits{ 0 }, m_codepoints{ 0 } {}
+
+		constexpr utf8_view(const char* cstring) noexcept : m_ptr{ cstring }, m_codeunits{ 0 }, m_codepoints{ 0 }
+		{
+			if (std::is_constant_evaluated())
+			{
+				m_codeunits = _init_codeunits(cstring);
+
+				m_codepoints = _init_codepoints(cstring);
+			}
+			else
+			{
+				m_codeunits = static_cast<uint32_t>(strlen(cstring));
+
+				m_codepoints = _utf8_count_codepoints(cstring, m_codeunits);
+			}
+		}
 
 		constexpr utf8_view(const char* cstring, uint32_t codeunits, uint32_t codepoints) noexcept : m_ptr{ cstring }, m_codeunits{ codeunits }, m_codepoints{ codepoints } {}
 
@@ -256,6 +289,9 @@ namespace och
 
 		utf8_view(const utf8_string& string) noexcept;
 
+		// Sets out to text and returns true if text passes validate_utf8. Otherwise returns false and leaves out unchanged.
+		[[nodiscard]] static bool create_validated(utf8_view& out, range<const char> text) noexcept;
+
 		utf8_view subview(uint32_t pos, uint32_t len = ~0) const noexcept;
 
 		uint32_t get_codepoints() const noexcept;
@@ -321,6 +357,10 @@ namespace och
 
 		utf8_string(const char* cstr) noexcept;
 
+		// Sets out to a copy of text and returns true if text passes validate_utf8. Otherwise returns false and leaves
+		// out unchanged.
+		[[nodiscard]] static bool create_validated(utf8_string& out, range<const char> text) noexcept;
+
 		~utf8_string() noexcept;
 
 		///////////////////////////////////////////////////Iterators///////////////////////////////////////////////////////////////
@@ -415,7 +455,8 @@ namespace och
 
 		utf8_string substr(uint32_t pos, uint32_t len = ~0) const noexcept;
 
-		void fmt_prepare_for_raw_write(uint32_t n) noexcept;
+		// Accounts for cunits written directly after raw_end(), within the current capacity, and terminates the string
+		void fmt_commit_raw_write(uint32_t cunits, uint32_t cpoints) noexcept;
 
 		void recount_codepoints_and_codeunits() noexcept;
 